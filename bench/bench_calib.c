@@ -0,0 +1,176 @@
+/**
+ * @file bench_calib.c
+ * @brief Time what calibration curves add to writing the pwms, against
+ * the uncalibrated path. The pwms are stubbed out so only the mapping
+ * is measured.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "calib.h"
+#include "errors.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define BENCH_DEFAULT_ITERATIONS 10000000UL
+
+/** Powers to sweep through, in tenths of a percent. **/
+#define BENCH_POWER_STEPS 1001
+
+static lb_power_t bench_powers[BENCH_POWER_STEPS];
+
+static int
+bench_null_generic(struct lb_throttle_t *throttle)
+{
+  (void)throttle;
+  return LB_OK;
+}
+
+static int
+bench_null_channel(struct lb_throttle_t *throttle, int channel)
+{
+  (void)throttle;
+  (void)channel;
+  return LB_OK;
+}
+
+static int
+bench_null_set(struct lb_throttle_t *throttle, int channel, lb_power_t duty)
+{
+  (void)throttle;
+  (void)channel;
+  (void)duty;
+  return LB_OK;
+}
+
+static int
+bench_null_get(struct lb_throttle_t *throttle, int channel,
+               lb_power_t *out_duty)
+{
+  *out_duty = throttle->lbt_written[channel];
+  return LB_OK;
+}
+
+static const struct lb_pwm_ops_t bench_null_ops = {
+  .lbp_open_func = bench_null_generic,
+  .lbp_deinit_func = bench_null_generic,
+  .lbp_enable_func = bench_null_channel,
+  .lbp_disable_func = bench_null_channel,
+  .lbp_set_func = bench_null_set,
+  .lbp_get_func = bench_null_get,
+};
+
+static uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Time mapping a power per channel through some curves.
+ *
+ * @return The nanoseconds per call.
+ */
+static double
+bench_apply(const struct lb_calib_t *calibs, unsigned long iterations)
+{
+  unsigned long i;
+  uint64_t start;
+  lb_power_t powers[LB_THROTTLE_CHANNELS];
+  volatile lb_power_t sink;
+
+  start = bench_now_ns();
+  for (i = 0; i < iterations; i++) {
+    powers[LB_THROTTLE_LEFT] = bench_powers[i % BENCH_POWER_STEPS];
+    powers[LB_THROTTLE_RIGHT] = bench_powers[(i * 7) % BENCH_POWER_STEPS];
+    lb_calib_apply(calibs, powers, LB_THROTTLE_CHANNELS);
+    sink = powers[LB_THROTTLE_LEFT] + powers[LB_THROTTLE_RIGHT];
+  }
+  (void)sink;
+
+  return (double)(bench_now_ns() - start) / (double)iterations;
+}
+
+/**
+ * @brief Time the whole write path a tick takes, trims and all.
+ *
+ * @return The nanoseconds per call.
+ */
+static double
+bench_channels_set(struct lb_throttle_t *throttle, unsigned long iterations)
+{
+  unsigned long i;
+  uint64_t start;
+
+  start = bench_now_ns();
+  for (i = 0; i < iterations; i++) {
+    lb_throttle_channels_set(throttle, bench_powers[i % BENCH_POWER_STEPS],
+                             NULL, NULL);
+  }
+
+  return (double)(bench_now_ns() - start) / (double)iterations;
+}
+
+int
+main(int argc, char **argv)
+{
+  int i;
+  unsigned long iterations = BENCH_DEFAULT_ITERATIONS;
+  double linear_apply, curve_apply, linear_set, curve_set;
+  struct lb_calib_params_t params;
+  struct lb_throttle_config_t config;
+  struct lb_throttle_t throttle;
+
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 10);
+  }
+  if (iterations == 0) {
+    fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 0; i < BENCH_POWER_STEPS; i++)
+    bench_powers[i] = lb_power_scale(LB_POWER_C(100), (uint64_t)i,
+                                     BENCH_POWER_STEPS - 1);
+
+  lb_throttle_backend_init(&throttle, &bench_null_ops, NULL);
+  lb_throttle_config_default(&config);
+  lb_throttle_config_set(&throttle, &config);
+
+  linear_apply = bench_apply(config.lbtc_calib, iterations);
+  linear_set = bench_channels_set(&throttle, iterations);
+
+  /* Channels that differ, like a pair of mismatched ESCs would. */
+  lb_calib_params_default(&params);
+  params.lbcp_dead_zone = LB_POWER_C(8);
+  params.lbcp_expo = LB_POWER_C(0.3);
+  lb_calib_curve(&(config.lbtc_calib[LB_THROTTLE_LEFT]), &params);
+  params.lbcp_dead_zone = LB_POWER_C(11);
+  params.lbcp_duty_max = LB_POWER_C(95);
+  lb_calib_curve(&(config.lbtc_calib[LB_THROTTLE_RIGHT]), &params);
+  if (lb_throttle_config_set(&throttle, &config) != LB_OK) {
+    fprintf(stderr, "Failed to set the calibrated config.\n");
+    return 1;
+  }
+
+  curve_apply = bench_apply(config.lbtc_calib, iterations);
+  curve_set = bench_channels_set(&throttle, iterations);
+
+  printf("iterations:            %lu\n", iterations);
+  printf("apply, uncalibrated:   %.2f ns\n", linear_apply);
+  printf("apply, calibrated:     %.2f ns\n", curve_apply);
+  printf("write, uncalibrated:   %.2f ns\n", linear_set);
+  printf("write, calibrated:     %.2f ns\n", curve_set);
+  printf("calibration adds:      %.2f ns per write\n", curve_set - linear_set);
+
+  lb_throttle_deinit(&throttle);
+  return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file bench_cxx_ramp.cpp
+ * @brief Compare the compile time specialized C++ ramp against the
+ * generic C ramp over the same workload.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "throttle.hpp"
+#include "throttle_internal.h"
+
+namespace {
+
+constexpr unsigned long bench_default_ticks = 10000000UL;
+
+std::uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (std::uint64_t)ts.tv_sec * 1000000000ULL + (std::uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief The target for a channel on a tick, changing every 32 ticks.
+ */
+lb_power_t
+bench_target(unsigned long tick, std::size_t channel)
+{
+  static const lb_power_t targets[] = {
+    LB_POWER_C(0), LB_POWER_C(100), LB_POWER_C(35.5), LB_POWER_C(70),
+    LB_POWER_C(10), LB_POWER_C(90), LB_POWER_C(50), LB_POWER_C(0)
+  };
+  return targets[((tick / 32) + channel) % 8];
+}
+
+template <std::size_t Channels>
+void
+bench_channels(unsigned long ticks)
+{
+  using config = lb::throttle_config<Channels, LB_THROTTLE_NSEC_SLEEP, 20>;
+  lb::ramp<config> cxx_ramp;
+  std::array<lb_power_t, Channels> target{};
+  std::array<lb_power_t, Channels> c_current{};
+  volatile lb_power_t sink;
+  std::uint64_t start, c_ns, cxx_ns;
+
+  start = bench_now_ns();
+  for (unsigned long t = 0; t < ticks; t++) {
+    if (t % 32 == 0) {
+      for (std::size_t i = 0; i < Channels; i++)
+        target[i] = bench_target(t, i);
+    }
+    for (std::size_t i = 0; i < Channels; i++) {
+      c_current[i] = lb_throttle_ramp(c_current[i], target[i],
+                                      LB_THROTTLE_MAX_ACCEL);
+    }
+    sink = c_current[0];
+  }
+  c_ns = bench_now_ns() - start;
+
+  start = bench_now_ns();
+  for (unsigned long t = 0; t < ticks; t++) {
+    if (t % 32 == 0) {
+      for (std::size_t i = 0; i < Channels; i++)
+        target[i] = bench_target(t, i);
+    }
+    cxx_ramp.tick(target);
+    sink = cxx_ramp.current()[0];
+  }
+  cxx_ns = bench_now_ns() - start;
+  (void)sink;
+
+  if (c_current != cxx_ramp.current()) {
+    std::printf("channels %zu: results differ!\n", Channels);
+  }
+
+  std::printf("channels %2zu: C %.2f ns/tick, C++ %.2f ns/tick\n", Channels,
+              (double)c_ns / ticks, (double)cxx_ns / ticks);
+}
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+  unsigned long ticks = bench_default_ticks;
+
+  if (argc > 1) {
+    ticks = std::strtoul(argv[1], nullptr, 10);
+  }
+
+  std::printf("ticks: %lu\n", ticks);
+  bench_channels<2>(ticks);
+  bench_channels<4>(ticks);
+  bench_channels<8>(ticks);
+  return 0;
+}
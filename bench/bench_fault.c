@@ -0,0 +1,254 @@
+/**
+ * @file bench_fault.c
+ * @brief Inject pwm faults into a simulated throttle and measure how
+ * quickly it recovers, against a fault free twin fed the same requests.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "errors.h"
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define BENCH_DEFAULT_TICKS 100000
+#define BENCH_DEFAULT_RATE 0.01
+#define BENCH_DEFAULT_BURST 20
+#define BENCH_DEFAULT_PERSISTENT 0.5
+#define BENCH_DEFAULT_SEED 1
+
+/** Ticks between changes of the requested power. **/
+#define BENCH_SEGMENT_TICKS 200
+
+/** How far the faulted throttle may trail its twin and still count. **/
+#define BENCH_LOST_POWER 1.0
+
+enum bench_mode_t { BENCH_RANDOM, BENCH_BURST };
+
+/**
+ * @brief The fault injector, wrapped around the simulator's pwms.
+ */
+struct bench_injector_t {
+  const struct lb_pwm_ops_t *bi_ops;
+  enum bench_mode_t bi_mode;
+  double bi_rate;
+  unsigned int bi_burst;
+  double bi_persistent;
+
+  /** Writes left to fail in the current burst, and how. **/
+  unsigned int bi_failing;
+  int bi_rc;
+  uint64_t bi_injected;
+};
+
+static struct bench_injector_t bench_injector;
+
+static double
+bench_random()
+{
+  return (double)rand() / ((double)RAND_MAX + 1.0);
+}
+
+static int
+bench_faulty_set(struct lb_throttle_t *throttle, int channel, lb_power_t duty)
+{
+  struct bench_injector_t *inj = &bench_injector;
+  double rate = inj->bi_rate;
+
+  if (inj->bi_failing == 0) {
+    /* Bursts start less often, so both modes fail as many writes. */
+    if (inj->bi_mode == BENCH_BURST)
+      rate /= inj->bi_burst;
+
+    if (bench_random() < rate) {
+      inj->bi_failing = inj->bi_mode == BENCH_BURST ? inj->bi_burst : 1;
+      inj->bi_rc = bench_random() < inj->bi_persistent ?
+          LB_PWM_ERROR : LB_RETRY;
+    }
+  }
+
+  if (inj->bi_failing > 0) {
+    inj->bi_failing--;
+    inj->bi_injected++;
+    return inj->bi_rc;
+  }
+
+  return inj->bi_ops->lbp_set_func(throttle, channel, duty);
+}
+
+static struct lb_pwm_ops_t bench_faulty_ops;
+
+static int
+bench_compare_u64(const void *a, const void *b)
+{
+  uint64_t lhs = *(const uint64_t *)a, rhs = *(const uint64_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void
+bench_usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [-m random|burst] [-n ticks] [-r rate] [-b burst]\n"
+          "          [-p persistent] [-s seed]\n"
+          "  -m  Fail writes one at a time, or in bursts (default random).\n"
+          "  -n  Ticks to run (default %d).\n"
+          "  -r  Share of writes that fail (default %.2f).\n"
+          "  -b  Writes per burst (default %d).\n"
+          "  -p  Share of faults that are persistent (default %.2f).\n"
+          "  -s  Random seed (default %d).\n",
+          name, BENCH_DEFAULT_TICKS, BENCH_DEFAULT_RATE, BENCH_DEFAULT_BURST,
+          BENCH_DEFAULT_PERSISTENT, BENCH_DEFAULT_SEED);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt;
+  unsigned int seed = BENCH_DEFAULT_SEED;
+  uint64_t ticks = BENCH_DEFAULT_TICKS, tick, tick_ns;
+  uint64_t fault_start = 0, lost = 0, *recover, recover_count = 0;
+  bool faulted = false;
+  double diff;
+  lb_power_t target;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim, *twin_sim;
+  struct lb_throttle_t *throttle, *twin;
+  struct lb_throttle_fault_t fault;
+
+  memset(&bench_injector, 0, sizeof(bench_injector));
+  bench_injector.bi_mode = BENCH_RANDOM;
+  bench_injector.bi_rate = BENCH_DEFAULT_RATE;
+  bench_injector.bi_burst = BENCH_DEFAULT_BURST;
+  bench_injector.bi_persistent = BENCH_DEFAULT_PERSISTENT;
+
+  while ((opt = getopt(argc, argv, "m:n:r:b:p:s:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      if (strcmp(optarg, "burst") == 0) {
+        bench_injector.bi_mode = BENCH_BURST;
+      } else if (strcmp(optarg, "random") != 0) {
+        bench_usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'n':
+      ticks = strtoull(optarg, NULL, 10);
+      break;
+    case 'r':
+      bench_injector.bi_rate = atof(optarg);
+      break;
+    case 'b':
+      bench_injector.bi_burst = (unsigned int)strtoul(optarg, NULL, 10);
+      break;
+    case 'p':
+      bench_injector.bi_persistent = atof(optarg);
+      break;
+    case 's':
+      seed = (unsigned int)strtoul(optarg, NULL, 10);
+      break;
+    default:
+      bench_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (bench_injector.bi_burst == 0 || ticks == 0) {
+    bench_usage(argv[0]);
+    return 1;
+  }
+
+  /* Every tick can start at most one recovery. */
+  recover = calloc(ticks, sizeof(uint64_t));
+  if (recover == NULL) {
+    return 1;
+  }
+  srand(seed);
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  twin_sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  twin = lb_throttle_sim_new(twin_sim);
+
+  bench_injector.bi_ops = throttle->lbt_pwm_ops;
+  bench_faulty_ops = *throttle->lbt_pwm_ops;
+  bench_faulty_ops.lbp_set_func = bench_faulty_set;
+  throttle->lbt_pwm_ops = &bench_faulty_ops;
+
+  lb_throttle_start_pwms(throttle);
+  lb_throttle_start_pwms(twin);
+  tick_ns = throttle->lbt_step_ns;
+
+  target = LB_POWER_C(0);
+  for (tick = 0; tick < ticks; tick++) {
+    if (tick % BENCH_SEGMENT_TICKS == 0) {
+      target = LB_POWER_FROM_FLOAT((float)(bench_random() * 80.0));
+      lb_throttle_request_set(throttle, target);
+      lb_throttle_request_set(twin, target);
+    }
+
+    lb_throttle_tick(throttle);
+    lb_throttle_tick(twin);
+    lb_sim_step(sim, tick_ns);
+    lb_sim_step(twin_sim, tick_ns);
+
+    lb_throttle_fault_get(throttle, &fault);
+    if (!faulted && fault.lbtf_state != LB_THROTTLE_FAULT_OK) {
+      faulted = true;
+      fault_start = tick;
+    } else if (faulted && fault.lbtf_state == LB_THROTTLE_FAULT_OK) {
+      faulted = false;
+      recover[recover_count++] = tick - fault_start;
+    }
+
+    if (fault.lbtf_state == LB_THROTTLE_FAULT_FAILED) {
+      /* A rider would power cycle, count the time and carry on. */
+      lb_throttle_fault_clear(throttle);
+    }
+
+    /* Lost throttle is any tick spent well short of the twin. */
+    diff = (double)LB_POWER_TO_FLOAT(twin->lbt_current_power) -
+        (double)LB_POWER_TO_FLOAT(throttle->lbt_current_power);
+    if (diff > BENCH_LOST_POWER || diff < -BENCH_LOST_POWER ||
+        fault.lbtf_state != LB_THROTTLE_FAULT_OK)
+      lost++;
+  }
+
+  qsort(recover, recover_count, sizeof(uint64_t), bench_compare_u64);
+
+  lb_throttle_fault_get(throttle, &fault);
+  printf("mode:              %s\n",
+         bench_injector.bi_mode == BENCH_BURST ? "burst" : "random");
+  printf("ticks:             %lu\n", (unsigned long)ticks);
+  printf("writes failed:     %lu\n", (unsigned long)bench_injector.bi_injected);
+  printf("transient faults:  %lu\n", (unsigned long)fault.lbtf_transient);
+  printf("persistent faults: %lu\n", (unsigned long)fault.lbtf_persistent);
+  printf("recoveries:        %lu\n", (unsigned long)fault.lbtf_recoveries);
+  if (recover_count > 0) {
+    printf("recover p50:       %.1f ms\n",
+           (double)(recover[(recover_count - 1) * 50 / 100] * tick_ns) / 1e6);
+    printf("recover p99:       %.1f ms\n",
+           (double)(recover[(recover_count - 1) * 99 / 100] * tick_ns) / 1e6);
+    printf("recover max:       %.1f ms\n",
+           (double)(recover[recover_count - 1] * tick_ns) / 1e6);
+  }
+  printf("fault ticks:       %lu\n", (unsigned long)fault.lbtf_lost_ticks);
+  printf("lost throttle:     %.1f s (%.2f%%)\n",
+         (double)(lost * tick_ns) / 1e9, 100.0 * (double)lost / (double)ticks);
+
+  lb_throttle_delete(throttle);
+  lb_throttle_delete(twin);
+  lb_sim_delete(sim);
+  lb_sim_delete(twin_sim);
+  free(recover);
+  return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file bench_ramp.c
+ * @brief Time the parse and ramp path a power sample takes on its way to
+ * the pwms. Build once with LIBLB_FIXED_POINT=ON and once without, then
+ * compare the two results.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "power.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define BENCH_DEFAULT_ITERATIONS 10000000UL
+
+/**
+ * @brief Samples the remote might send, full throttle to full brake.
+ */
+static const char *bench_samples[] = {
+  "0\n", "12.5\n", "25\n", "37.5\n", "50\n", "62.5\n", "75\n", "87.5\n",
+  "100\n", "80.25\n", "60\n", "40.75\n", "20\n", "5.5\n", "0\n", "33.3\n"
+};
+
+#define BENCH_SAMPLE_COUNT (sizeof(bench_samples) / sizeof(bench_samples[0]))
+
+static uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned long i, iterations = BENCH_DEFAULT_ITERATIONS;
+  uint64_t start, parse_ns, ramp_ns;
+  lb_power_t target = LB_POWER_C(0), current = LB_POWER_C(0);
+  lb_power_t targets[BENCH_SAMPLE_COUNT];
+  volatile lb_power_t sink;
+
+  if (argc > 1) {
+    iterations = strtoul(argv[1], NULL, 10);
+  }
+
+  /* Parse every sample, like the comm path does for each line. */
+  start = bench_now_ns();
+  for (i = 0; i < iterations; i++) {
+    lb_power_parse(bench_samples[i % BENCH_SAMPLE_COUNT], &target);
+    sink = target;
+  }
+  parse_ns = bench_now_ns() - start;
+
+  for (i = 0; i < BENCH_SAMPLE_COUNT; i++) {
+    lb_power_parse(bench_samples[i], &targets[i]);
+  }
+
+  /* Ramp towards a new target every 32 ticks, like the runner does. */
+  start = bench_now_ns();
+  for (i = 0; i < iterations; i++) {
+    current = lb_throttle_ramp(current, targets[(i / 32) % BENCH_SAMPLE_COUNT],
+                               LB_THROTTLE_MAX_ACCEL);
+    sink = current;
+  }
+  ramp_ns = bench_now_ns() - start;
+  (void)sink;
+
+#ifdef LB_FIXED_POINT
+  printf("build: fixed point (Q16.16)\n");
+#else
+  printf("build: float\n");
+#endif
+  printf("iterations: %lu\n", iterations);
+  printf("parse: %.2f ns/sample\n", (double)parse_ns / iterations);
+  printf("ramp: %.2f ns/tick\n", (double)ramp_ns / iterations);
+  printf("final power: %f\n", LB_POWER_TO_FLOAT(current));
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file bench_sim_sweep.c
+ * @brief Sweep random ride profiles through the board simulator for a
+ * few ramp limits, comparing response time and peak current.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define BENCH_DEFAULT_PROFILES 1000
+#define BENCH_SEGMENTS 4
+#define BENCH_SEGMENT_TICKS 50
+
+/**
+ * @brief A ride: who's riding, where, and what they ask for.
+ */
+struct bench_profile_t {
+  double bp_mass;
+  double bp_grade;
+  lb_power_t bp_targets[BENCH_SEGMENTS];
+};
+
+/**
+ * @brief The results of one ramp limit over every profile.
+ */
+struct bench_result_t {
+  double br_response_sum;
+  double *br_responses;
+  size_t br_response_count;
+  double br_peak_sum;
+  double br_peak_max;
+};
+
+static uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+bench_compare_double(const void *a, const void *b)
+{
+  double lhs = *(const double *)a, rhs = *(const double *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void
+bench_profile_random(struct bench_profile_t *profile, unsigned int *seed)
+{
+  int i;
+
+  profile->bp_mass = 55.0 + (rand_r(seed) % 650) / 10.0;
+  profile->bp_grade = -0.02 + (rand_r(seed) % 100) / 1000.0;
+  for (i = 0; i < BENCH_SEGMENTS; i++) {
+    profile->bp_targets[i] = (lb_power_t)(rand_r(seed) % 11) *
+      LB_POWER_C(10);
+  }
+}
+
+/**
+ * @brief Ride one profile with a ramp limit.
+ *
+ * @return The number of responses recorded.
+ */
+static size_t
+bench_ride(const struct bench_profile_t *profile, lb_power_t max_accel,
+           double *responses, double *out_peak)
+{
+  int seg, tick;
+  size_t count = 0;
+  double speeds[BENCH_SEGMENT_TICKS], start, final;
+  struct lb_sim_params_t params;
+  struct lb_sim_state_t state;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_throttle_config_t config;
+
+  lb_sim_params_default(&params);
+  params.lbsp_mass = profile->bp_mass;
+  params.lbsp_grade = profile->bp_grade;
+
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_config_default(&config);
+  config.lbtc_ramp_per_sec = lb_power_scale(max_accel, 1000000000ULL,
+                                            LB_THROTTLE_PERIOD_NSEC);
+  lb_throttle_config_set(throttle, &config);
+  lb_throttle_start_pwms(throttle);
+
+  for (seg = 0; seg < BENCH_SEGMENTS; seg++) {
+    lb_sim_state_get(sim, &state);
+    start = state.lbss_speed;
+
+    lb_throttle_request_set(throttle, profile->bp_targets[seg]);
+    for (tick = 0; tick < BENCH_SEGMENT_TICKS; tick++) {
+      lb_throttle_tick(throttle);
+      lb_sim_step(sim, LB_THROTTLE_NSEC_SLEEP);
+      lb_sim_state_get(sim, &state);
+      speeds[tick] = state.lbss_speed;
+    }
+
+    /* Time to get within 10% of where this segment settled. */
+    final = speeds[BENCH_SEGMENT_TICKS - 1];
+    if (fabs(final - start) < 0.5) {
+      continue;
+    }
+    for (tick = 0; tick < BENCH_SEGMENT_TICKS; tick++) {
+      if (fabs(final - speeds[tick]) <= 0.1 * fabs(final - start)) {
+        break;
+      }
+    }
+    responses[count++] = (tick + 1) * (LB_THROTTLE_NSEC_SLEEP / 1e9);
+  }
+
+  lb_sim_state_get(sim, &state);
+  *out_peak = state.lbss_peak_current;
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+  return count;
+}
+
+int
+main(int argc, char **argv)
+{
+  static const double accels[] = { 1.0, 2.0, 4.0, 8.0 };
+  const size_t accel_count = sizeof(accels) / sizeof(accels[0]);
+  int i, profiles = BENCH_DEFAULT_PROFILES;
+  size_t a, count;
+  unsigned int seed = 1;
+  double peak;
+  uint64_t start, elapsed;
+  struct bench_profile_t *rides;
+  struct bench_result_t result;
+
+  if (argc > 1) {
+    profiles = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    seed = (unsigned int)strtoul(argv[2], NULL, 10);
+  }
+  if (profiles <= 0) {
+    fprintf(stderr, "usage: %s [profiles] [seed]\n", argv[0]);
+    return 1;
+  }
+
+  rides = calloc((size_t)profiles, sizeof(struct bench_profile_t));
+  result.br_responses = calloc((size_t)profiles * BENCH_SEGMENTS,
+                               sizeof(double));
+  if (rides == NULL || result.br_responses == NULL) {
+    return 1;
+  }
+
+  for (i = 0; i < profiles; i++) {
+    bench_profile_random(&rides[i], &seed);
+  }
+
+  printf("profiles: %d, %d simulated seconds each\n", profiles,
+         (int)(BENCH_SEGMENTS * BENCH_SEGMENT_TICKS *
+               (LB_THROTTLE_NSEC_SLEEP / 1e9)));
+  printf("%-12s %12s %12s %14s %14s %14s\n", "accel/tick", "response",
+         "p95 resp", "mean peak A", "max peak A", "profiles/min");
+
+  for (a = 0; a < accel_count; a++) {
+    result.br_response_sum = 0.0;
+    result.br_response_count = 0;
+    result.br_peak_sum = 0.0;
+    result.br_peak_max = 0.0;
+
+    start = bench_now_ns();
+    for (i = 0; i < profiles; i++) {
+      count = bench_ride(&rides[i], LB_POWER_FROM_FLOAT(accels[a]),
+                         result.br_responses + result.br_response_count,
+                         &peak);
+      result.br_response_count += count;
+      result.br_peak_sum += peak;
+      if (peak > result.br_peak_max) {
+        result.br_peak_max = peak;
+      }
+    }
+    elapsed = bench_now_ns() - start;
+
+    for (count = 0; count < result.br_response_count; count++) {
+      result.br_response_sum += result.br_responses[count];
+    }
+    qsort(result.br_responses, result.br_response_count, sizeof(double),
+          bench_compare_double);
+
+    printf("%-12.1f %11.2fs %11.2fs %14.1f %14.1f %14.0f\n", accels[a],
+           result.br_response_count ?
+             result.br_response_sum / result.br_response_count : 0.0,
+           result.br_response_count ?
+             result.br_responses[result.br_response_count * 95 / 100] : 0.0,
+           result.br_peak_sum / profiles, result.br_peak_max,
+           profiles / (elapsed / 60e9));
+  }
+
+  free(result.br_responses);
+  free(rides);
+  return 0;
+}
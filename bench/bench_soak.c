@@ -0,0 +1,596 @@
+/**
+ * @file bench_soak.c
+ * @brief Soak a simulated throttle fed by a loopback comm with random
+ * input, tracking tick drift, latency and resource growth over time.
+ * Compressed soaks tick the throttle from the soak loop. In real time
+ * (-c 1) the throttle's own runner ticks it, and drift is the runner's.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "comm.h"
+#include "errors.h"
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define BENCH_DEFAULT_DURATION_SEC 600
+#define BENCH_DEFAULT_COMPRESS 100
+#define BENCH_DEFAULT_WINDOW_SEC 60
+#define BENCH_DEFAULT_TOLERANCE 0.25
+
+/** Inputs in flight between the writer and the reader. **/
+#define BENCH_INFLIGHT 64
+
+/** How long a real time soak waits for the runner to go live. **/
+#define BENCH_LIVE_TIMEOUT_MS 5000
+
+/**
+ * @brief The numbers a soak is judged on, and the baseline file keys.
+ */
+struct bench_summary_t {
+  double bs_lateness_p99_us;
+  double bs_comm_p99_us;
+  double bs_drift_ppm;
+  double bs_rss_growth_kib;
+  double bs_fd_growth;
+  double bs_thread_growth;
+};
+
+/**
+ * @brief The baseline keys. A soak regresses on a key when it is worse
+ * than the baseline by more than the slack, or by more than the
+ * tolerance for keys that scale.
+ */
+static const struct {
+  const char *bk_name;
+  size_t bk_offset;
+  double bk_slack;
+  bool bk_scales;
+} bench_keys[] = {
+  { "lateness_p99_us", offsetof(struct bench_summary_t, bs_lateness_p99_us),
+    1000.0, true },
+  { "comm_p99_us", offsetof(struct bench_summary_t, bs_comm_p99_us),
+    1000.0, true },
+  { "drift_ppm", offsetof(struct bench_summary_t, bs_drift_ppm),
+    1000.0, true },
+  { "rss_growth_kib", offsetof(struct bench_summary_t, bs_rss_growth_kib),
+    512.0, false },
+  { "fd_growth", offsetof(struct bench_summary_t, bs_fd_growth),
+    0.0, false },
+  { "thread_growth", offsetof(struct bench_summary_t, bs_thread_growth),
+    0.0, false },
+};
+
+#define BENCH_KEYS (sizeof(bench_keys) / sizeof(bench_keys[0]))
+
+/**
+ * @brief A growable list of latency samples for one window.
+ */
+struct bench_samples_t {
+  uint64_t *bsa_values;
+  size_t bsa_count;
+  size_t bsa_size;
+};
+
+/**
+ * @brief What the reader thread shares with the writer.
+ */
+struct bench_reader_t {
+  struct lb_comm_t *br_comm;
+  struct lb_throttle_t *br_throttle;
+
+  pthread_mutex_t br_mutex;
+  uint64_t br_sent_ns[BENCH_INFLIGHT];
+  size_t br_head;
+  size_t br_tail;
+  struct bench_samples_t br_latency;
+  uint64_t br_errors;
+};
+
+struct bench_resources_t {
+  long br_rss_kib;
+  long br_fds;
+  long br_threads;
+};
+
+static uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+bench_compare_u64(const void *a, const void *b)
+{
+  uint64_t lhs = *(const uint64_t *)a, rhs = *(const uint64_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void
+bench_samples_add(struct bench_samples_t *samples, uint64_t value)
+{
+  uint64_t *values;
+
+  if (samples->bsa_count == samples->bsa_size) {
+    samples->bsa_size = samples->bsa_size ? samples->bsa_size * 2 : 1024;
+    values = realloc(samples->bsa_values,
+                     samples->bsa_size * sizeof(uint64_t));
+    if (values == NULL) {
+      abort();
+    }
+    samples->bsa_values = values;
+  }
+  samples->bsa_values[samples->bsa_count++] = value;
+}
+
+/**
+ * @brief Sort the samples and get a percentile. Empty lists are 0.
+ */
+static uint64_t
+bench_samples_percentile(struct bench_samples_t *samples, unsigned int pct)
+{
+  if (samples->bsa_count == 0) {
+    return 0;
+  }
+
+  qsort(samples->bsa_values, samples->bsa_count, sizeof(uint64_t),
+        bench_compare_u64);
+  return samples->bsa_values[(samples->bsa_count - 1) * pct / 100];
+}
+
+static void
+bench_resources_get(struct bench_resources_t *res)
+{
+  FILE *file;
+  DIR *dir;
+  char line[128];
+  long pages = 0;
+
+  res->br_rss_kib = 0;
+  res->br_fds = 0;
+  res->br_threads = 0;
+
+  file = fopen("/proc/self/statm", "r");
+  if (file != NULL) {
+    if (fscanf(file, "%*s %ld", &pages) == 1) {
+      res->br_rss_kib = pages * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+    fclose(file);
+  }
+
+  dir = opendir("/proc/self/fd");
+  if (dir != NULL) {
+    while (readdir(dir) != NULL) {
+      res->br_fds++;
+    }
+    /* Don't count ., .. or the directory itself. */
+    res->br_fds -= 3;
+    closedir(dir);
+  }
+
+  file = fopen("/proc/self/status", "r");
+  if (file != NULL) {
+    while (fgets(line, sizeof(line), file) != NULL) {
+      if (sscanf(line, "Threads: %ld", &(res->br_threads)) == 1) {
+        break;
+      }
+    }
+    fclose(file);
+  }
+}
+
+/**
+ * @brief Read power levels from the comm until a negative one arrives,
+ * passing each to the throttle like a real remote handler would.
+ */
+static void *
+bench_reader_run(void *ctx)
+{
+  int rc;
+  uint64_t sent_ns, now_ns;
+  lb_power_t power;
+  struct bench_reader_t *reader = ctx;
+
+  for (;;) {
+    rc = lb_comm_get_power(reader->br_comm, &power);
+    now_ns = bench_now_ns();
+
+    if (rc != LB_OK && rc != LB_RETRY) {
+      pthread_mutex_lock(&(reader->br_mutex));
+      reader->br_errors++;
+      pthread_mutex_unlock(&(reader->br_mutex));
+      return NULL;
+    }
+
+    pthread_mutex_lock(&(reader->br_mutex));
+    if (reader->br_tail != reader->br_head) {
+      sent_ns = reader->br_sent_ns[reader->br_tail % BENCH_INFLIGHT];
+      reader->br_tail++;
+      bench_samples_add(&(reader->br_latency), now_ns - sent_ns);
+    }
+    pthread_mutex_unlock(&(reader->br_mutex));
+
+    if (rc == LB_OK) {
+      if (power < LB_POWER_C(0)) {
+        return NULL;
+      }
+      lb_throttle_request_set(reader->br_throttle, power);
+    }
+  }
+}
+
+/**
+ * @brief Send one line to the reader, recording when it was sent.
+ *
+ * @return 0 on success.
+ */
+static int
+bench_send(struct bench_reader_t *reader, int writer, const char *line)
+{
+  size_t len = strlen(line);
+
+  pthread_mutex_lock(&(reader->br_mutex));
+  if (reader->br_head - reader->br_tail == BENCH_INFLIGHT) {
+    /* The reader is badly behind, drop this input. */
+    pthread_mutex_unlock(&(reader->br_mutex));
+    return 0;
+  }
+  reader->br_sent_ns[reader->br_head % BENCH_INFLIGHT] = bench_now_ns();
+  reader->br_head++;
+  pthread_mutex_unlock(&(reader->br_mutex));
+
+  return write(writer, line, len) == (ssize_t)len ? 0 : -1;
+}
+
+static int
+bench_baseline_read(const char *path, struct bench_summary_t *baseline)
+{
+  FILE *file;
+  char key[64];
+  double value;
+  size_t k;
+
+  memset(baseline, 0, sizeof(struct bench_summary_t));
+
+  file = fopen(path, "r");
+  if (file == NULL) {
+    return -1;
+  }
+
+  while (fscanf(file, " %63[^=]=%lf", key, &value) == 2) {
+    for (k = 0; k < BENCH_KEYS; k++) {
+      if (strcmp(key, bench_keys[k].bk_name) == 0) {
+        *(double *)((char *)baseline + bench_keys[k].bk_offset) = value;
+      }
+    }
+  }
+
+  fclose(file);
+  return 0;
+}
+
+static int
+bench_baseline_write(const char *path, const struct bench_summary_t *summary)
+{
+  FILE *file;
+  size_t k;
+
+  file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+
+  for (k = 0; k < BENCH_KEYS; k++) {
+    fprintf(file, "%s=%.3f\n", bench_keys[k].bk_name,
+            *(const double *)((const char *)summary +
+                              bench_keys[k].bk_offset));
+  }
+
+  fclose(file);
+  return 0;
+}
+
+/**
+ * @brief Compare a soak against a baseline.
+ *
+ * @return The number of regressions.
+ */
+static int
+bench_baseline_check(const struct bench_summary_t *summary,
+                     const struct bench_summary_t *baseline,
+                     double tolerance)
+{
+  int regressions = 0;
+  size_t k;
+  double current, base, limit;
+
+  for (k = 0; k < BENCH_KEYS; k++) {
+    current = *(const double *)((const char *)summary +
+                                bench_keys[k].bk_offset);
+    base = *(const double *)((const char *)baseline +
+                             bench_keys[k].bk_offset);
+
+    limit = base + bench_keys[k].bk_slack;
+    if (bench_keys[k].bk_scales && base * (1.0 + tolerance) > limit) {
+      limit = base * (1.0 + tolerance);
+    }
+
+    if (current > limit) {
+      printf("REGRESSION %s: %.3f > %.3f (baseline %.3f)\n",
+             bench_keys[k].bk_name, current, limit, base);
+      regressions++;
+    }
+  }
+
+  return regressions;
+}
+
+static void
+bench_usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-d duration_sec] [-c compress] [-w window_sec]"
+          " [-s seed] [-t tolerance] [-b baseline] [-W write_baseline]\n",
+          name);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt, writer, rc = 0;
+  bool live;
+  unsigned int seed = 1;
+  long duration_sec = BENCH_DEFAULT_DURATION_SEC;
+  long compress = BENCH_DEFAULT_COMPRESS;
+  long window_sec = BENCH_DEFAULT_WINDOW_SEC;
+  double tolerance = BENCH_DEFAULT_TOLERANCE;
+  const char *baseline_path = NULL, *write_path = NULL;
+  uint64_t tick, total_ticks, period_ns, start_ns, deadline_ns, now_ns;
+  uint64_t virtual_ns = 0, next_input_ns = 0, next_window_ns;
+  uint64_t lateness_p99_max = 0, comm_p99_max = 0;
+  uint64_t start_ticks = 0, window_ticks = 0, expected_ticks;
+  double drift_ppm;
+  char line[32];
+  struct timespec deadline;
+  struct bench_samples_t lateness = { NULL, 0, 0 };
+  struct bench_resources_t res_start, res_now;
+  struct bench_summary_t summary, baseline;
+  struct bench_reader_t reader;
+  struct lb_throttle_tick_stats_t stats;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_comm_t *comm;
+  pthread_t reader_thread;
+
+  while ((opt = getopt(argc, argv, "d:c:w:s:t:b:W:")) != -1) {
+    switch (opt) {
+    case 'd': duration_sec = atol(optarg); break;
+    case 'c': compress = atol(optarg); break;
+    case 'w': window_sec = atol(optarg); break;
+    case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+    case 't': tolerance = atof(optarg); break;
+    case 'b': baseline_path = optarg; break;
+    case 'W': write_path = optarg; break;
+    default: bench_usage(argv[0]); return 1;
+    }
+  }
+  if (duration_sec <= 0 || compress <= 0 || window_sec <= 0) {
+    bench_usage(argv[0]);
+    return 1;
+  }
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = sim != NULL ? lb_throttle_sim_new(sim) : NULL;
+  comm = lb_comm_loopback_new();
+  if (sim == NULL || throttle == NULL || comm == NULL ||
+      lb_comm_open(comm) != LB_OK) {
+    fprintf(stderr, "failed to set up the soak\n");
+    return 1;
+  }
+
+  /*
+   * In real time the runner can keep up, so soak the real thing, its
+   * scheduling included. Compressed, the soak has to tick for it.
+   */
+  live = compress == 1;
+  if (live) {
+    rc = lb_throttle_start(throttle);
+    if (rc == LB_OK)
+      rc = lb_throttle_wait_live(throttle, BENCH_LIVE_TIMEOUT_MS);
+  } else {
+    rc = lb_throttle_start_pwms(throttle);
+  }
+  if (rc != LB_OK) {
+    fprintf(stderr, "failed to start the throttle\n");
+    return 1;
+  }
+  writer = lb_comm_loopback_writer(comm);
+
+  memset(&reader, 0, sizeof(reader));
+  reader.br_comm = comm;
+  reader.br_throttle = throttle;
+  pthread_mutex_init(&(reader.br_mutex), NULL);
+  pthread_create(&reader_thread, NULL, bench_reader_run, &reader);
+
+  bench_resources_get(&res_start);
+
+  /*
+   * The soak ticks the throttle itself, so it can run the simulated ride
+   * compress times faster than real time. Every deadline is absolute, so
+   * falling behind shows up as drift instead of being forgotten.
+   */
+  period_ns = LB_THROTTLE_PERIOD_NSEC;
+  total_ticks = (uint64_t)duration_sec * 1000000000ULL / period_ns;
+  next_window_ns = (uint64_t)window_sec * 1000000000ULL;
+
+  printf("soak: %lds simulated, %ldx compressed, seed %u%s\n", duration_sec,
+         compress, seed, live ? ", real runner" : "");
+  printf("%10s %8s %10s %10s %10s %10s %10s %6s %8s\n", "sim time", "ticks",
+         "late p50", "late p99", "late max", "comm p50", "comm p99",
+         "fds", "rss KiB");
+
+  lb_throttle_tick_stats_get(throttle, &stats);
+  start_ticks = stats.lbts_ticks;
+  window_ticks = start_ticks;
+  start_ns = bench_now_ns();
+  for (tick = 0; tick < total_ticks; tick++) {
+    deadline_ns = start_ns + (tick + 1) * period_ns / (uint64_t)compress;
+    deadline.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                           NULL) != 0)
+      ;
+
+    now_ns = bench_now_ns();
+    bench_samples_add(&lateness, now_ns - deadline_ns);
+
+    if (!live)
+      lb_throttle_tick(throttle);
+    lb_sim_step(sim, period_ns);
+    virtual_ns += period_ns;
+
+    /* Random targets every 50 to 500 ms, with the odd garbled line. */
+    if (virtual_ns >= next_input_ns) {
+      if (rand_r(&seed) % 50 == 0) {
+        snprintf(line, sizeof(line), "x%u\n", rand_r(&seed));
+      } else {
+        snprintf(line, sizeof(line), "%u\n", (rand_r(&seed) % 11) * 10);
+      }
+      if (bench_send(&reader, writer, line) != 0) {
+        fprintf(stderr, "failed to write to the comm\n");
+        rc = 1;
+        break;
+      }
+      next_input_ns = virtual_ns +
+        (50 + rand_r(&seed) % 451) * 1000000ULL;
+    }
+
+    if (virtual_ns >= next_window_ns || tick + 1 == total_ticks) {
+      uint64_t late_p50, late_p99, late_max, comm_p50, comm_p99;
+
+      late_p50 = bench_samples_percentile(&lateness, 50);
+      late_p99 = bench_samples_percentile(&lateness, 99);
+      late_max = bench_samples_percentile(&lateness, 100);
+      lateness.bsa_count = 0;
+
+      pthread_mutex_lock(&(reader.br_mutex));
+      comm_p50 = bench_samples_percentile(&(reader.br_latency), 50);
+      comm_p99 = bench_samples_percentile(&(reader.br_latency), 99);
+      reader.br_latency.bsa_count = 0;
+      pthread_mutex_unlock(&(reader.br_mutex));
+
+      if (late_p99 > lateness_p99_max) {
+        lateness_p99_max = late_p99;
+      }
+      if (comm_p99 > comm_p99_max) {
+        comm_p99_max = comm_p99;
+      }
+
+      bench_resources_get(&res_now);
+      printf("%9.0fs %8llu %8.1fus %8.1fus %8.1fus %8.1fus %8.1fus "
+             "%6ld %8ld\n", virtual_ns / 1e9, (unsigned long long)(tick + 1),
+             late_p50 / 1e3, late_p99 / 1e3, late_max / 1e3,
+             comm_p50 / 1e3, comm_p99 / 1e3, res_now.br_fds,
+             res_now.br_rss_kib);
+      if (live) {
+        lb_throttle_tick_stats_get(throttle, &stats);
+        printf("%10s runner: %llu ticks, period %.1fms, write %.1fus, "
+               "cpu %.1fms/s\n", "",
+               (unsigned long long)(stats.lbts_ticks - window_ticks),
+               stats.lbts_period_ns / 1e6, stats.lbts_write_ns / 1e3,
+               stats.lbts_cpu_ns_per_sec / 1e6);
+        window_ticks = stats.lbts_ticks;
+      }
+      fflush(stdout);
+
+      next_window_ns += (uint64_t)window_sec * 1000000000ULL;
+    }
+  }
+
+  /*
+   * How far the last tick landed from where the schedule put it. For
+   * the real runner, how many ticks it fell short of or ran over the
+   * ones its period allows for.
+   */
+  drift_ppm = 0.0;
+  if (live) {
+    lb_throttle_tick_stats_get(throttle, &stats);
+    expected_ticks = (bench_now_ns() - start_ns) / period_ns;
+    if (expected_ticks > 0) {
+      drift_ppm = ((double)expected_ticks -
+                   (double)(stats.lbts_ticks - start_ticks)) /
+        (double)expected_ticks * 1e6;
+    }
+  } else if (tick > 0) {
+    deadline_ns = tick * period_ns / (uint64_t)compress;
+    drift_ppm = ((double)(bench_now_ns() - start_ns) - (double)deadline_ns) /
+      (double)deadline_ns * 1e6;
+  }
+
+  /* Measure before tearing anything down, so it matches the start. */
+  bench_resources_get(&res_now);
+
+  bench_send(&reader, writer, "-1\n");
+  pthread_join(reader_thread, NULL);
+  if (live) {
+    lb_throttle_stop(throttle);
+  }
+
+  summary.bs_lateness_p99_us = lateness_p99_max / 1e3;
+  summary.bs_comm_p99_us = comm_p99_max / 1e3;
+  summary.bs_drift_ppm = drift_ppm;
+  summary.bs_rss_growth_kib = (double)(res_now.br_rss_kib -
+                                       res_start.br_rss_kib);
+  summary.bs_fd_growth = (double)(res_now.br_fds - res_start.br_fds);
+  summary.bs_thread_growth = (double)(res_now.br_threads -
+                                      res_start.br_threads);
+
+  printf("worst window p99: lateness %.1fus, comm %.1fus\n",
+         summary.bs_lateness_p99_us, summary.bs_comm_p99_us);
+  printf("drift: %.1f ppm, growth: rss %+.0f KiB, fds %+.0f, threads %+.0f\n",
+         summary.bs_drift_ppm, summary.bs_rss_growth_kib,
+         summary.bs_fd_growth, summary.bs_thread_growth);
+  if (reader.br_errors != 0) {
+    printf("reader failed reading the comm\n");
+    rc = 1;
+  }
+
+  if (baseline_path != NULL) {
+    if (bench_baseline_read(baseline_path, &baseline) != 0) {
+      fprintf(stderr, "failed to read baseline %s\n", baseline_path);
+      rc = 1;
+    } else if (bench_baseline_check(&summary, &baseline, tolerance) != 0) {
+      rc = 1;
+    }
+  }
+  if (write_path != NULL && bench_baseline_write(write_path, &summary) != 0) {
+    fprintf(stderr, "failed to write baseline %s\n", write_path);
+    rc = 1;
+  }
+
+  free(lateness.bsa_values);
+  free(reader.br_latency.bsa_values);
+  pthread_mutex_destroy(&(reader.br_mutex));
+  lb_comm_delete(comm);
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+  return rc;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file bench_startup.c
+ * @brief Time from creating a throttle to its first successful duty
+ * cycle write, which is when it goes live.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "errors.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define BENCH_DEFAULT_RUNS 100
+
+static uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+bench_compare_u64(const void *a, const void *b)
+{
+  uint64_t lhs = *(const uint64_t *)a, rhs = *(const uint64_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+int
+main(int argc, char **argv)
+{
+  int rc, i, runs = BENCH_DEFAULT_RUNS;
+  uint64_t start, *samples;
+  struct lb_throttle_t *throttle;
+
+  if (argc > 1) {
+    runs = atoi(argv[1]);
+  }
+  if (runs <= 0) {
+    fprintf(stderr, "usage: %s [runs]\n", argv[0]);
+    return 1;
+  }
+
+  samples = calloc((size_t)runs, sizeof(uint64_t));
+  if (samples == NULL) {
+    return 1;
+  }
+
+  for (i = 0; i < runs; i++) {
+    start = bench_now_ns();
+
+    throttle = lb_throttle_test_new();
+    if (throttle == NULL) {
+      fprintf(stderr, "Failed to create throttle.\n");
+      return 1;
+    }
+
+    rc = lb_throttle_start(throttle);
+    if (rc == LB_OK) {
+      rc = lb_throttle_wait_live(throttle, 5000);
+    }
+    if (rc != LB_OK) {
+      fprintf(stderr, "Throttle didn't go live: %d\n", rc);
+      return 1;
+    }
+
+    samples[i] = bench_now_ns() - start;
+    lb_throttle_delete(throttle);
+  }
+
+  qsort(samples, (size_t)runs, sizeof(uint64_t), bench_compare_u64);
+
+  printf("runs: %d\n", runs);
+  printf("new to live: min %.1f us, median %.1f us, max %.1f us\n",
+         samples[0] / 1000.0, samples[runs / 2] / 1000.0,
+         samples[runs - 1] / 1000.0);
+
+  free(samples);
+  return 0;
+}
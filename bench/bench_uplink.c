@@ -0,0 +1,339 @@
+/**
+ * @file bench_uplink.c
+ * @brief Measure inbound latency over a loopback comm with and without
+ * telemetry flowing back the other way.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/socket.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "comm.h"
+#include "errors.h"
+
+#define BENCH_DEFAULT_DURATION_MS 2000
+#define BENCH_DEFAULT_PERIOD_US 1000
+#define BENCH_DEFAULT_INTERVAL_US 1000
+
+/** The channel the remote's sequence numbers arrive on. **/
+#define BENCH_CHANNEL_SEQ 1
+/** Telemetry is published on this many channels after the sequence. **/
+#define BENCH_TELEMETRY_CHANNELS 8
+
+#define BENCH_INFLIGHT 1024
+
+enum bench_mode_t {
+  /** No telemetry at all. */
+  BENCH_MODE_IDLE,
+  /** Telemetry, with the remote reading it as fast as it comes. */
+  BENCH_MODE_DRAINED,
+  /** Telemetry, with the remote never reading it. */
+  BENCH_MODE_STALLED,
+  BENCH_MODES
+};
+
+static const char *bench_mode_names[BENCH_MODES] = {
+  "idle", "drained", "stalled"
+};
+
+/**
+ * @brief What the threads of one run share.
+ */
+struct bench_run_t {
+  enum bench_mode_t br_mode;
+  struct lb_comm_t *br_comm;
+  struct lb_channels_t *br_channels;
+  int br_writer;
+
+  pthread_mutex_t br_mutex;
+  uint64_t br_sent_ns[BENCH_INFLIGHT];
+  uint64_t *br_latency;
+  size_t br_count;
+  size_t br_size;
+
+  volatile bool br_done;
+  uint64_t br_published;
+  uint64_t br_drained;
+};
+
+static uint64_t
+bench_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void
+bench_sleep_until(uint64_t deadline_ns)
+{
+  struct timespec ts;
+
+  ts.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+  ts.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int
+bench_compare_u64(const void *a, const void *b)
+{
+  uint64_t lhs = *(const uint64_t *)a, rhs = *(const uint64_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/**
+ * @brief Record how long a sequence number took to arrive. A negative
+ * sequence number ends the run.
+ */
+static void
+bench_on_seq(unsigned int id, const union lb_channel_value_t *value,
+             void *ctx)
+{
+  uint64_t now_ns = bench_now_ns(), *latency;
+  struct bench_run_t *run = ctx;
+
+  (void)id;
+  if (value->lbcv_int < 0) {
+    run->br_done = true;
+    return;
+  }
+
+  pthread_mutex_lock(&(run->br_mutex));
+  if (run->br_count == run->br_size) {
+    run->br_size = run->br_size ? run->br_size * 2 : 4096;
+    latency = realloc(run->br_latency, run->br_size * sizeof(uint64_t));
+    if (latency == NULL) {
+      abort();
+    }
+    run->br_latency = latency;
+  }
+  run->br_latency[run->br_count++] = now_ns -
+      run->br_sent_ns[(size_t)value->lbcv_int % BENCH_INFLIGHT];
+  pthread_mutex_unlock(&(run->br_mutex));
+}
+
+/**
+ * @brief Pump the comm like a board's remote handler would.
+ */
+static void *
+bench_pump_run(void *ctx)
+{
+  struct bench_run_t *run = ctx;
+
+  while (!run->br_done) {
+    if (lb_comm_pump(run->br_comm, run->br_channels) == LB_COMM_ERROR) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Publish telemetry as fast as the board might, round robin over
+ * the telemetry channels.
+ */
+static void *
+bench_publish_run(void *ctx)
+{
+  unsigned int i = 0;
+  union lb_channel_value_t value;
+  struct bench_run_t *run = ctx;
+
+  while (!run->br_done) {
+    value.lbcv_float = (float)(run->br_published % 1000) / 10.0f;
+    lb_comm_uplink_publish(run->br_comm, BENCH_CHANNEL_SEQ + 1 + i,
+                           LB_CHANNEL_TYPE_FLOAT, &value);
+    run->br_published++;
+    i = (i + 1) % BENCH_TELEMETRY_CHANNELS;
+    usleep(10);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Read telemetry off the remote end as it arrives.
+ */
+static void *
+bench_drain_run(void *ctx)
+{
+  char buf[4096];
+  ssize_t size;
+  struct bench_run_t *run = ctx;
+
+  while (!run->br_done) {
+    size = recv(run->br_writer, buf, sizeof(buf), MSG_DONTWAIT);
+    if (size > 0) {
+      run->br_drained += (uint64_t)size;
+    } else {
+      usleep(100);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Run one mode and print its line of results.
+ */
+static int
+bench_run(enum bench_mode_t mode, uint64_t duration_ns, uint64_t period_ns,
+          uint64_t interval_ns)
+{
+  int rc = 0, size;
+  long seq = 0;
+  char line[32];
+  uint64_t start_ns, deadline_ns;
+  struct bench_run_t run;
+  struct lb_comm_uplink_stats_t stats;
+  pthread_t pump_thread, publish_thread, drain_thread;
+
+  memset(&run, 0, sizeof(run));
+  run.br_mode = mode;
+  pthread_mutex_init(&(run.br_mutex), NULL);
+
+  run.br_channels = lb_channels_new();
+  run.br_comm = lb_comm_loopback_new();
+  if (run.br_channels == NULL || run.br_comm == NULL ||
+      lb_comm_open(run.br_comm) != LB_OK) {
+    fprintf(stderr, "Failed to set up the loopback comm.\n");
+    rc = 1;
+    goto out;
+  }
+  run.br_writer = lb_comm_loopback_writer(run.br_comm);
+  lb_comm_uplink_interval_set(run.br_comm, interval_ns);
+
+  lb_channels_register(run.br_channels, BENCH_CHANNEL_SEQ,
+                       LB_CHANNEL_TYPE_INT, LB_CHANNEL_LATEST);
+  lb_channels_subscribe(run.br_channels, BENCH_CHANNEL_SEQ, bench_on_seq,
+                        &run);
+
+  pthread_create(&pump_thread, NULL, bench_pump_run, &run);
+  if (mode != BENCH_MODE_IDLE)
+    pthread_create(&publish_thread, NULL, bench_publish_run, &run);
+  if (mode == BENCH_MODE_DRAINED)
+    pthread_create(&drain_thread, NULL, bench_drain_run, &run);
+
+  start_ns = bench_now_ns();
+  deadline_ns = start_ns;
+  while (deadline_ns - start_ns < duration_ns) {
+    deadline_ns += period_ns;
+    bench_sleep_until(deadline_ns);
+
+    size = snprintf(line, sizeof(line), "50\n%d:%ld\n", BENCH_CHANNEL_SEQ,
+                    seq);
+    pthread_mutex_lock(&(run.br_mutex));
+    run.br_sent_ns[(size_t)seq % BENCH_INFLIGHT] = bench_now_ns();
+    pthread_mutex_unlock(&(run.br_mutex));
+    if (write(run.br_writer, line, (size_t)size) != size) {
+      fprintf(stderr, "Failed to write to the comm.\n");
+      break;
+    }
+    seq++;
+  }
+
+  size = snprintf(line, sizeof(line), "%d:-1\n", BENCH_CHANNEL_SEQ);
+  if (write(run.br_writer, line, (size_t)size) != size)
+    run.br_done = true;
+
+  pthread_join(pump_thread, NULL);
+  run.br_done = true;
+  if (mode != BENCH_MODE_IDLE)
+    pthread_join(publish_thread, NULL);
+  if (mode == BENCH_MODE_DRAINED)
+    pthread_join(drain_thread, NULL);
+
+  lb_comm_uplink_stats_get(run.br_comm, &stats);
+
+  qsort(run.br_latency, run.br_count, sizeof(uint64_t), bench_compare_u64);
+  if (run.br_count == 0) {
+    fprintf(stderr, "No inbound samples arrived.\n");
+    rc = 1;
+    goto out;
+  }
+
+  printf("%-8s %8zu %9.1f %9.1f %9.1f %8lu %9lu %10lu %8lu\n",
+         bench_mode_names[mode], run.br_count,
+         (double)run.br_latency[(run.br_count - 1) * 50 / 100] / 1000.0,
+         (double)run.br_latency[(run.br_count - 1) * 99 / 100] / 1000.0,
+         (double)run.br_latency[run.br_count - 1] / 1000.0,
+         (unsigned long)stats.lbus_frames,
+         (unsigned long)stats.lbus_records,
+         (unsigned long)stats.lbus_coalesced,
+         (unsigned long)stats.lbus_blocked);
+
+out:
+  if (run.br_comm != NULL)
+    lb_comm_delete(run.br_comm);
+  if (run.br_channels != NULL)
+    lb_channels_delete(run.br_channels);
+  free(run.br_latency);
+  pthread_mutex_destroy(&(run.br_mutex));
+  return rc;
+}
+
+static void
+bench_usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [-d duration_ms] [-p period_us] [-i interval_us]\n"
+          "  -d  How long to run each mode (default %d ms).\n"
+          "  -p  Time between inbound samples (default %d us).\n"
+          "  -i  Shortest time between telemetry frames (default %d us).\n",
+          name, BENCH_DEFAULT_DURATION_MS, BENCH_DEFAULT_PERIOD_US,
+          BENCH_DEFAULT_INTERVAL_US);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt, rc = 0;
+  enum bench_mode_t mode;
+  uint64_t duration_ms = BENCH_DEFAULT_DURATION_MS;
+  uint64_t period_us = BENCH_DEFAULT_PERIOD_US;
+  uint64_t interval_us = BENCH_DEFAULT_INTERVAL_US;
+
+  while ((opt = getopt(argc, argv, "d:p:i:h")) != -1) {
+    switch (opt) {
+    case 'd':
+      duration_ms = strtoull(optarg, NULL, 10);
+      break;
+    case 'p':
+      period_us = strtoull(optarg, NULL, 10);
+      break;
+    case 'i':
+      interval_us = strtoull(optarg, NULL, 10);
+      break;
+    default:
+      bench_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (period_us == 0) {
+    bench_usage(argv[0]);
+    return 1;
+  }
+
+  printf("%-8s %8s %9s %9s %9s %8s %9s %10s %8s\n", "mode", "samples",
+         "p50_us", "p99_us", "max_us", "frames", "records", "coalesced",
+         "blocked");
+  for (mode = 0; mode < BENCH_MODES; mode++) {
+    rc |= bench_run(mode, duration_ms * 1000000ULL, period_us * 1000ULL,
+                    interval_us * 1000ULL);
+  }
+
+  return rc;
+}
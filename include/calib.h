@@ -0,0 +1,82 @@
+/**
+ * @file calib.h
+ * @brief Calibration curves, mapping the power a channel is asked for to
+ * the duty cycle its ESC needs to deliver it.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_CALIB_H
+#define LONGBOARD_CALIB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of even steps a curve splits 0% to 100% power into.
+ * Powers between the points are linearly interpolated.
+ */
+#define LB_CALIB_SEGMENTS 128
+
+/**
+ * @brief The most points a measured calibration table may have.
+ */
+#define LB_CALIB_TABLE_MAX 1024
+
+/**
+ * @brief A calibration curve, precomputed into a lookup table so using
+ * it is one interpolation, whatever shape it was built from.
+ */
+struct lb_calib_t {
+  /** Set for the identity curve, which is skipped entirely. */
+  bool lbc_linear;
+  /**
+   * The duty cycle at each of the LB_CALIB_SEGMENTS + 1 points. A copy
+   * of the last point pads the end, so 100% interpolates without a
+   * bounds check.
+   */
+  lb_power_t lbc_duty[LB_CALIB_SEGMENTS + 2];
+};
+
+/**
+ * @brief The shape of a calibration curve.
+ */
+struct lb_calib_params_t {
+  /**
+   * The duty cycle the ESC starts turning the motor at. Zero power stays
+   * off, and the curve climbs to here across its first segment, so the
+   * bottom of the throttle isn't dead.
+   */
+  lb_power_t lbcp_dead_zone;
+  /** The duty cycle that gives full power. */
+  lb_power_t lbcp_duty_max;
+  /** From 0 for linear to 1 for cubic, softening the low end. */
+  lb_power_t lbcp_expo;
+};
+
+void lb_calib_linear(struct lb_calib_t *calib);
+void lb_calib_params_default(struct lb_calib_params_t *params);
+int lb_calib_curve(struct lb_calib_t *calib,
+                   const struct lb_calib_params_t *params);
+int lb_calib_table(struct lb_calib_t *calib, const lb_power_t *powers,
+                   const lb_power_t *duties, size_t count);
+int lb_calib_load(struct lb_calib_t *calib, const char *path);
+bool lb_calib_valid(const struct lb_calib_t *calib);
+
+lb_power_t lb_calib_eval(const struct lb_calib_t *calib, lb_power_t power);
+lb_power_t lb_calib_invert(const struct lb_calib_t *calib, lb_power_t duty);
+void lb_calib_apply(const struct lb_calib_t *calibs, lb_power_t *powers,
+                    size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_CALIB_H */
@@ -0,0 +1,120 @@
+/**
+ * @file channel.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_CHANNEL_H
+#define LONGBOARD_CHANNEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of channels one link can carry. Channel ids run from
+ * 0 up to this.
+ */
+#define LB_CHANNELS_MAX 16
+
+/**
+ * @brief The channel a bare number on the wire goes to. It is always
+ * registered, as a latest value power channel.
+ */
+#define LB_CHANNEL_POWER 0
+
+/**
+ * @brief How many values a queued channel holds before dropping.
+ */
+#define LB_CHANNEL_QUEUE_DEPTH 16
+
+/**
+ * @brief How many subscribers a channel can have.
+ */
+#define LB_CHANNEL_SUBSCRIBERS 4
+
+enum lb_channel_type_t {
+  LB_CHANNEL_TYPE_POWER,
+  LB_CHANNEL_TYPE_FLOAT,
+  LB_CHANNEL_TYPE_INT,
+  LB_CHANNEL_TYPE_BOOL
+};
+
+enum lb_channel_kind_t {
+  /** Keep only the newest value, readers never see a backlog. */
+  LB_CHANNEL_LATEST,
+  /** Keep every value in order, up to LB_CHANNEL_QUEUE_DEPTH. */
+  LB_CHANNEL_QUEUE
+};
+
+union lb_channel_value_t {
+  lb_power_t lbcv_power;
+  float lbcv_float;
+  int32_t lbcv_int;
+  bool lbcv_bool;
+};
+
+/**
+ * @brief Counters for the telemetry sent back over a comm.
+ */
+struct lb_comm_uplink_stats_t {
+  /** Frames handed to the link, and the records in them. */
+  uint64_t lbus_frames;
+  uint64_t lbus_records;
+  uint64_t lbus_bytes;
+  /** Values replaced by a newer one before they were sent. */
+  uint64_t lbus_coalesced;
+  /** Flushes that found the link full. */
+  uint64_t lbus_blocked;
+};
+
+typedef void (*lb_channel_func)(unsigned int id,
+                                const union lb_channel_value_t *value,
+                                void *ctx);
+
+struct lb_channels_t;
+struct lb_comm_t;
+
+struct lb_channels_t *lb_channels_new();
+void lb_channels_delete(struct lb_channels_t *channels);
+
+int lb_channels_register(struct lb_channels_t *channels, unsigned int id,
+                         enum lb_channel_type_t type,
+                         enum lb_channel_kind_t kind);
+int lb_channels_subscribe(struct lb_channels_t *channels, unsigned int id,
+                          lb_channel_func func, void *ctx);
+
+int lb_channel_split(char *record, unsigned int *out_id, char **out_value);
+int lb_channel_parse(enum lb_channel_type_t type, const char *str,
+                     union lb_channel_value_t *out_value);
+
+int lb_channels_dispatch(struct lb_channels_t *channels, char *record);
+int lb_channels_latest_get(struct lb_channels_t *channels, unsigned int id,
+                           union lb_channel_value_t *out_value,
+                           uint32_t *out_seq);
+int lb_channels_queue_pop(struct lb_channels_t *channels, unsigned int id,
+                          union lb_channel_value_t *out_value);
+uint64_t lb_channels_dropped(struct lb_channels_t *channels);
+
+int lb_comm_pump(struct lb_comm_t *comm, struct lb_channels_t *channels);
+
+int lb_comm_uplink_publish(struct lb_comm_t *comm, unsigned int id,
+                           enum lb_channel_type_t type,
+                           const union lb_channel_value_t *value);
+int lb_comm_uplink_flush(struct lb_comm_t *comm);
+int lb_comm_uplink_interval_set(struct lb_comm_t *comm, uint64_t interval_ns);
+int lb_comm_uplink_stats_get(struct lb_comm_t *comm,
+                             struct lb_comm_uplink_stats_t *out_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_CHANNEL_H */
@@ -9,15 +9,39 @@
 #ifndef LONGBOARD_COMM_H
 #define LONGBOARD_COMM_H
 
-enum lb_comm_type_t { LB_COMM_BT };
+#include <stddef.h>
+
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum lb_comm_type_t { LB_COMM_BT, LB_COMM_LOOPBACK };
 
 struct lb_comm_t;
+struct lb_failsafe_t;
 
 struct lb_comm_t *lb_comm_bt_new(const char *addr);
+struct lb_comm_t *lb_comm_loopback_new();
 
+size_t lb_comm_bt_sizeof();
+size_t lb_comm_alignof();
+int lb_comm_bt_init(struct lb_comm_t *storage, const char *addr);
+size_t lb_comm_loopback_sizeof();
+int lb_comm_loopback_init(struct lb_comm_t *storage);
+int lb_comm_loopback_writer(struct lb_comm_t *comm);
+
+int lb_comm_deinit(struct lb_comm_t *comm);
 int lb_comm_delete(struct lb_comm_t *comm);
 int lb_comm_open(struct lb_comm_t *comm);
 int lb_comm_close(struct lb_comm_t *comm);
-int lb_comm_get_power(struct lb_comm_t *comm, float *out_power);
+int lb_comm_get_power(struct lb_comm_t *comm, lb_power_t *out_power);
+int lb_comm_failsafe_attach(struct lb_comm_t *comm,
+                            struct lb_failsafe_t *failsafe, int source);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /*LONGBOARD_COMM_H */
@@ -0,0 +1,77 @@
+/**
+ * @file comm.hpp
+ * @brief A header only C++17 RAII layer over the comm objects.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_COMM_HPP
+#define LONGBOARD_COMM_HPP
+
+#include <memory>
+
+#include "comm.h"
+#include "errors.h"
+#include "power.h"
+
+namespace lb {
+
+namespace detail {
+
+struct comm_deleter {
+  void
+  operator()(lb_comm_t *comm) const noexcept
+  {
+    lb_comm_delete(comm);
+  }
+};
+
+} // namespace detail
+
+/**
+ * @brief A move only owner of an lb_comm_t. Methods return the same
+ * status codes as the C functions they wrap.
+ */
+class comm {
+public:
+  comm() noexcept = default;
+  explicit comm(lb_comm_t *handle) noexcept : handle_(handle) {}
+
+  static comm
+  bluetooth(const char *addr)
+  {
+    return comm(lb_comm_bt_new(addr));
+  }
+
+  static comm
+  loopback()
+  {
+    return comm(lb_comm_loopback_new());
+  }
+
+  comm(comm &&) noexcept = default;
+  comm &operator=(comm &&) noexcept = default;
+  comm(const comm &) = delete;
+  comm &operator=(const comm &) = delete;
+
+  explicit operator bool() const noexcept { return handle_ != nullptr; }
+  lb_comm_t *get() const noexcept { return handle_.get(); }
+  lb_comm_t *release() noexcept { return handle_.release(); }
+
+  int open() noexcept { return lb_comm_open(get()); }
+  int close() noexcept { return lb_comm_close(get()); }
+
+  int
+  get_power(lb_power_t *out_power) noexcept
+  {
+    return lb_comm_get_power(get(), out_power);
+  }
+
+private:
+  std::unique_ptr<lb_comm_t, detail::comm_deleter> handle_;
+};
+
+} // namespace lb
+
+#endif /* LONGBOARD_COMM_HPP */
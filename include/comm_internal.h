@@ -9,32 +9,143 @@
 #ifndef LONGBOARD_COMM_INTERNAL
 #define LONGBOARD_COMM_INTERNAL
 
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "channel.h"
 #include "comm.h"
+#include "uring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The longest line we'll accept from the remote.
+ */
+#define LB_COMM_BUF_SIZE 128
+
+/**
+ * @brief The most telemetry bytes waiting to go out. One frame is built
+ * at a time, and a new one only once the last has fully gone.
+ */
+#define LB_COMM_UPLINK_BUF_SIZE 256
+
+/**
+ * @brief The default shortest time between telemetry frames.
+ */
+#define LB_COMM_UPLINK_INTERVAL_NSEC 50000000ULL
 
 typedef int (*lb_comm_generic_func)(struct lb_comm_t *);
-typedef int (*lb_comm_get_float_func)(struct lb_comm_t*, float *out);
+typedef int (*lb_comm_read_func)(struct lb_comm_t *, char *buf, size_t len,
+                                 size_t *out_len);
+typedef int (*lb_comm_write_func)(struct lb_comm_t *, const char *buf,
+                                  size_t len, size_t *out_len);
+
+/**
+ * @brief The newest telemetry value for one channel id.
+ */
+struct lb_comm_uplink_slot_t {
+  bool lbcus_dirty;
+  enum lb_channel_type_t lbcus_type;
+  union lb_channel_value_t lbcus_value;
+};
+
+/**
+ * @brief The outbound half of a comm. Publishers overwrite slots, and
+ * the flush turns dirty slots into a frame, so a slow link sees fewer,
+ * newer values rather than a backlog.
+ */
+struct lb_comm_uplink_t {
+  pthread_mutex_t lbcu_mutex;
+  struct lb_comm_uplink_slot_t lbcu_slots[LB_CHANNELS_MAX];
+
+  uint64_t lbcu_interval_ns;
+  uint64_t lbcu_last_ns;
+
+  /** The frame being sent, from start up to end. **/
+  size_t lbcu_out_start;
+  size_t lbcu_out_end;
+  char lbcu_out[LB_COMM_UPLINK_BUF_SIZE];
+
+  struct lb_comm_uplink_stats_t lbcu_stats;
+};
 
 struct lb_comm_t {
   enum lb_comm_type_t lbc_type;
   void *lbc_ctx;
 
   /** Function Pointers **/
-  lb_comm_generic_func lbc_delete_func;
+  lb_comm_generic_func lbc_deinit_func;
   lb_comm_generic_func lbc_open_func;
   lb_comm_generic_func lbc_close_func;
-  lb_comm_get_float_func lbc_get_power_func;
+  lb_comm_read_func lbc_read_func;
+  lb_comm_write_func lbc_write_func;
+
+  /** Fed with every valid sample, if attached. **/
+  struct lb_failsafe_t *lbc_failsafe;
+  int lbc_failsafe_source;
+
+  /** Bytes read but not yet parsed, from start up to end. **/
+  size_t lbc_buf_start;
+  size_t lbc_buf_end;
+  char lbc_buf[LB_COMM_BUF_SIZE];
+  /** Set after an overlong line, to drop the rest of it. **/
+  bool lbc_buf_discard;
+
+  struct lb_comm_uplink_t lbc_uplink;
 };
 
 struct lb_comm_bt_t {
   const char *lbc_bt_addr;
   int lbc_bt_socket;
+  struct lb_uring_t lbc_bt_uring;
 };
 
-struct lb_comm_t *lb_comm_new(enum lb_comm_type_t type, void *ctx);
+/**
+ * @brief The layout of the single block of storage a bluetooth comm
+ * lives in. The bluetooth context follows the generic comm.
+ */
+struct lb_comm_bt_storage_t {
+  struct lb_comm_t lbcs_comm;
+  struct lb_comm_bt_t lbcs_bt;
+};
+
+struct lb_comm_loopback_t {
+  /** The comm reads the first socket, tests write the second. **/
+  int lbc_lo_fds[2];
+  struct lb_uring_t lbc_lo_uring;
+};
+
+struct lb_comm_loopback_storage_t {
+  struct lb_comm_t lbcs_comm;
+  struct lb_comm_loopback_t lbcs_loopback;
+};
+
+void lb_comm_init(struct lb_comm_t *comm, enum lb_comm_type_t type, void *ctx);
+int lb_comm_read_line(struct lb_comm_t *comm, char **out_line);
+bool lb_comm_line_buffered(struct lb_comm_t *comm);
 
-int lb_comm_bt_delete(struct lb_comm_t *comm);
+int lb_comm_bt_deinit(struct lb_comm_t *comm);
 int lb_comm_bt_open(struct lb_comm_t *comm);
 int lb_comm_bt_close(struct lb_comm_t *comm);
-int lb_comm_bt_get_power(struct lb_comm_t *comm, float *out_power);
+int lb_comm_bt_read(struct lb_comm_t *comm, char *buf, size_t len,
+                    size_t *out_len);
+int lb_comm_bt_write(struct lb_comm_t *comm, const char *buf, size_t len,
+                     size_t *out_len);
+
+int lb_comm_loopback_deinit(struct lb_comm_t *comm);
+int lb_comm_loopback_open(struct lb_comm_t *comm);
+int lb_comm_loopback_close(struct lb_comm_t *comm);
+int lb_comm_loopback_read(struct lb_comm_t *comm, char *buf, size_t len,
+                          size_t *out_len);
+int lb_comm_loopback_write(struct lb_comm_t *comm, const char *buf,
+                           size_t len, size_t *out_len);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* LONGBOARD_COMM_INTERNAL */
@@ -6,7 +6,12 @@
  * @date 2015-10-02
  */
 
+#ifndef LONGBOARD_ERRORS_H
+#define LONGBOARD_ERRORS_H
+
 enum lb_error_t {
+  LB_NOT_SUPPORTED = -5,
+  LB_PARSE_ERROR = -4,
   LB_NOT_FOUND = -3,
   LB_THROTTLE_ERROR = -3,
   LB_COMM_ERROR = -2,
@@ -14,3 +19,5 @@ enum lb_error_t {
   LB_OK = 0,
   LB_RETRY = 2
 };
+
+#endif /* LONGBOARD_ERRORS_H */
@@ -0,0 +1,88 @@
+/**
+ * @file failsafe.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_FAILSAFE_H
+#define LONGBOARD_FAILSAFE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The resolution of failsafe deadlines.
+ */
+#define LB_FAILSAFE_TICK_NSEC 1000000ULL
+
+/**
+ * @brief The number of slots in the timer wheel. Deadlines further out
+ * than this many ticks wrap around the wheel and count down in rounds.
+ */
+#define LB_FAILSAFE_WHEEL_SLOTS 256
+
+/**
+ * @brief The most comm sources one failsafe can watch.
+ */
+#define LB_FAILSAFE_MAX_SOURCES 32
+
+struct lb_failsafe_t;
+struct lb_throttle_t;
+
+/**
+ * @brief How the failsafe brings the throttle down once a source is lost.
+ * The throttle's own ramp still limits how fast power can fall.
+ */
+struct lb_failsafe_profile_t {
+  /** How long to hold the last requested power before slowing, in ms. */
+  unsigned int lbfp_hold_ms;
+  /** How fast to take the requested power down, per second. */
+  lb_power_t lbfp_decel_per_sec;
+};
+
+struct lb_failsafe_metrics_t {
+  /** The number of times the failsafe has tripped. */
+  uint64_t lbfm_trips;
+  /** From the last valid sample to tripping, for the last trip. */
+  uint64_t lbfm_loss_to_trip_ns;
+  /** From the last valid sample to zero power, for the last trip. */
+  uint64_t lbfm_loss_to_zero_ns;
+  /** The longest loss to zero seen. */
+  uint64_t lbfm_max_loss_to_zero_ns;
+};
+
+struct lb_failsafe_t *lb_failsafe_new(struct lb_throttle_t *throttle);
+void lb_failsafe_delete(struct lb_failsafe_t *failsafe);
+
+int lb_failsafe_profile_set(struct lb_failsafe_t *failsafe,
+                            const struct lb_failsafe_profile_t *profile);
+
+int lb_failsafe_source_add(struct lb_failsafe_t *failsafe,
+                           unsigned int timeout_ms, int *out_source);
+int lb_failsafe_source_remove(struct lb_failsafe_t *failsafe, int source);
+
+int lb_failsafe_feed(struct lb_failsafe_t *failsafe, int source);
+int lb_failsafe_feed_at(struct lb_failsafe_t *failsafe, int source,
+                        uint64_t now_ns);
+int lb_failsafe_advance(struct lb_failsafe_t *failsafe, uint64_t now_ns);
+
+int lb_failsafe_start(struct lb_failsafe_t *failsafe);
+int lb_failsafe_stop(struct lb_failsafe_t *failsafe);
+
+bool lb_failsafe_is_tripped(struct lb_failsafe_t *failsafe);
+int lb_failsafe_metrics_get(struct lb_failsafe_t *failsafe,
+                            struct lb_failsafe_metrics_t *out_metrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_FAILSAFE_H */
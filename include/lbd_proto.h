@@ -0,0 +1,110 @@
+/**
+ * @file lbd_proto.h
+ * @brief The wire protocol between lbd and its local clients.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ *
+ * Clients talk to lbd over a Unix stream socket, so everything is in
+ * host byte order. Each side sends frames: a header, then header count
+ * fixed size records. A client frame carries a batch of commands, and
+ * lbd answers every command with a response, in order, usually all in
+ * one frame. Events for subscribers arrive in frames of their own,
+ * flagged LBD_FRAME_EVENTS, which may split the responses to a batch
+ * that subscribes.
+ *
+ * Power levels are hundredths of a percent, whatever lb_power_t is.
+ */
+
+#ifndef LONGBOARD_LBD_PROTO_H
+#define LONGBOARD_LBD_PROTO_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LBD_PROTO_VERSION 1
+
+/**
+ * @brief Where lbd listens unless told otherwise.
+ */
+#define LBD_SOCKET_PATH "/run/lbd.sock"
+
+/**
+ * @brief The most records in one frame.
+ */
+#define LBD_BATCH_MAX 64
+
+enum lbd_op_t {
+  /** Answered with status 0, to measure round trips. */
+  LBD_OP_PING = 0,
+  /** Set the requested power to value. */
+  LBD_OP_REQUEST_SET = 1,
+  /** Get the requested power. */
+  LBD_OP_REQUEST_GET = 2,
+  /** Get the power the pwms are driven at. */
+  LBD_OP_CURRENT_GET = 3,
+  /** Get the fault state, an lb_throttle_fault_state_t. */
+  LBD_OP_FAULT_GET = 4,
+  /** Clear a failed throttle. */
+  LBD_OP_FAULT_CLEAR = 5,
+  /** Replace this client's subscriptions with the value's event mask. */
+  LBD_OP_SUBSCRIBE = 6,
+  LBD_OPS
+};
+
+/**
+ * @brief Events a client can subscribe to, as bits in a mask. An event
+ * record's op is the event, and its value the new state.
+ */
+enum lbd_event_t {
+  LBD_EVENT_REQUEST = 1 << 0,
+  LBD_EVENT_CURRENT = 1 << 1,
+  LBD_EVENT_FAULT = 1 << 2
+};
+
+enum lbd_frame_flags_t {
+  /** The records are events, not responses. */
+  LBD_FRAME_EVENTS = 1 << 0,
+  /** Events were dropped for this client before this frame. */
+  LBD_FRAME_LOST = 1 << 1
+};
+
+struct lbd_frame_header_t {
+  uint8_t lbfh_version;
+  uint8_t lbfh_flags;
+  uint16_t lbfh_count;
+};
+
+struct lbd_command_t {
+  /** Echoed back in the response. */
+  uint32_t lbdc_seq;
+  uint16_t lbdc_op;
+  uint16_t lbdc_reserved;
+  int64_t lbdc_value;
+};
+
+struct lbd_response_t {
+  uint32_t lbdr_seq;
+  uint16_t lbdr_op;
+  /** An lb_error_t. */
+  int16_t lbdr_status;
+  int64_t lbdr_value;
+};
+
+#ifndef __cplusplus
+_Static_assert(sizeof(struct lbd_frame_header_t) == 4,
+               "lbd frame headers must be 4 bytes");
+_Static_assert(sizeof(struct lbd_command_t) == 16,
+               "lbd commands must be 16 bytes");
+_Static_assert(sizeof(struct lbd_response_t) == 16,
+               "lbd responses must be 16 bytes");
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_LBD_PROTO_H */
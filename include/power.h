@@ -0,0 +1,66 @@
+/**
+ * @file power.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_POWER_H
+#define LONGBOARD_POWER_H
+
+#include <stdint.h>
+
+#include "lb_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef LB_FIXED_POINT
+
+/**
+ * @brief A power level as a percentage, stored in Q16.16 fixed point so
+ * boards without an FPU never go through soft-float.
+ */
+typedef int32_t lb_power_t;
+
+#define LB_POWER_FRAC_BITS 16
+#define LB_POWER_ONE ((lb_power_t)1 << LB_POWER_FRAC_BITS)
+
+/**
+ * @brief Convert a constant to a power level. Only use this with
+ * constants, so the conversion is folded at compile time.
+ */
+#define LB_POWER_C(x)                                                         \
+  ((lb_power_t)((x) >= 0 ? (x) * 65536.0 + 0.5 : (x) * 65536.0 - 0.5))
+
+#define LB_POWER_TO_FLOAT(p) ((float)(p) / 65536.0f)
+#define LB_POWER_FROM_FLOAT(f) lb_power_from_float(f)
+
+#else
+
+/**
+ * @brief A power level as a percentage.
+ */
+typedef float lb_power_t;
+
+#define LB_POWER_C(x) ((float)(x))
+#define LB_POWER_TO_FLOAT(p) (p)
+#define LB_POWER_FROM_FLOAT(f) (f)
+
+#endif /* LB_FIXED_POINT */
+
+lb_power_t lb_power_from_float(float value);
+int lb_power_parse(const char *str, lb_power_t *out_power);
+int lb_power_parse_end(const char *str, lb_power_t *out_power,
+                       const char **out_end);
+lb_power_t lb_power_mul(lb_power_t a, lb_power_t b);
+lb_power_t lb_power_div(lb_power_t a, lb_power_t b);
+lb_power_t lb_power_scale(lb_power_t power, uint64_t num, uint64_t den);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_POWER_H */
@@ -0,0 +1,81 @@
+/**
+ * @file profile.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_PROFILE_H
+#define LONGBOARD_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The wall time each profile window covers.
+ */
+#define LB_PROFILE_WINDOW_NSEC 1000000000ULL
+
+/**
+ * @brief The number of completed windows the profiler keeps.
+ */
+#define LB_PROFILE_WINDOWS 8
+
+/**
+ * @brief The phases a runner tick is split into.
+ */
+enum lb_profile_phase_t {
+  /** Waiting to take the throttle lock. */
+  LB_PROFILE_LOCK_WAIT,
+  /** Working out the next power level. */
+  LB_PROFILE_RAMP,
+  /** Writing the left pwm. */
+  LB_PROFILE_WRITE_LEFT,
+  /** Writing the right pwm. */
+  LB_PROFILE_WRITE_RIGHT,
+  /** Waking up later than the tick's deadline. */
+  LB_PROFILE_SLEEP_OVERSHOOT,
+  LB_PROFILE_PHASES
+};
+
+struct lb_profile_phase_stats_t {
+  uint64_t lbps_count;
+  uint64_t lbps_total_ns;
+  uint64_t lbps_max_ns;
+};
+
+/**
+ * @brief A summary of one profile window.
+ */
+struct lb_profile_report_t {
+  /** The wall time the window covers. */
+  uint64_t lbpr_wall_ns;
+  /** The CPU time the ticking thread used in the window. */
+  uint64_t lbpr_cpu_ns;
+  /** Context switches the ticking thread made, and had forced on it. */
+  uint64_t lbpr_voluntary_csw;
+  uint64_t lbpr_involuntary_csw;
+  uint64_t lbpr_ticks;
+  struct lb_profile_phase_stats_t lbpr_phases[LB_PROFILE_PHASES];
+};
+
+struct lb_throttle_t;
+
+int lb_throttle_profile_enable(struct lb_throttle_t *throttle, bool enable);
+int lb_throttle_profile_get(struct lb_throttle_t *throttle, unsigned int age,
+                            struct lb_profile_report_t *out_report);
+int lb_throttle_profile_dump(struct lb_throttle_t *throttle, FILE *file);
+
+const char *lb_profile_phase_name(enum lb_profile_phase_t phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_PROFILE_H */
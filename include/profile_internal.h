@@ -0,0 +1,71 @@
+/**
+ * @file profile_internal.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_PROFILE_INTERNAL_H
+#define LONGBOARD_PROFILE_INTERNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A span of wall time, and the CPU time the thread that started
+ * it has used since. Used by the profiler's windows and the runner's
+ * CPU usage estimate alike.
+ */
+struct lb_cpu_window_t {
+  uint64_t lbcw_start_ns;
+  uint64_t lbcw_start_cpu_ns;
+};
+
+/**
+ * @brief A tick profiler. The open window is only touched by the thread
+ * that ticks, so recording a phase never takes a lock. Completed windows
+ * are copied into a ring under lbpf_mutex for readers.
+ */
+struct lb_profile_t {
+  bool lbpf_enabled;
+
+  struct lb_profile_report_t lbpf_open;
+  struct lb_cpu_window_t lbpf_open_window;
+  uint64_t lbpf_open_voluntary_csw;
+  uint64_t lbpf_open_involuntary_csw;
+  bool lbpf_open_started;
+
+  pthread_mutex_t lbpf_mutex;
+  struct lb_profile_report_t lbpf_ring[LB_PROFILE_WINDOWS];
+  unsigned int lbpf_ring_next;
+  unsigned int lbpf_ring_count;
+};
+
+void lb_cpu_window_start(struct lb_cpu_window_t *window, uint64_t now_ns);
+void lb_cpu_window_elapsed(const struct lb_cpu_window_t *window,
+                           uint64_t now_ns, uint64_t *out_wall_ns,
+                           uint64_t *out_cpu_ns);
+
+void lb_profile_init(struct lb_profile_t *profile);
+void lb_profile_deinit(struct lb_profile_t *profile);
+void lb_profile_set_enabled(struct lb_profile_t *profile, bool enable);
+uint64_t lb_profile_start(struct lb_profile_t *profile);
+void lb_profile_record(struct lb_profile_t *profile,
+                       enum lb_profile_phase_t phase, uint64_t start_ns);
+void lb_profile_record_ns(struct lb_profile_t *profile,
+                          enum lb_profile_phase_t phase, uint64_t ns);
+void lb_profile_tick_end(struct lb_profile_t *profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_PROFILE_INTERNAL_H */
@@ -0,0 +1,47 @@
+/**
+ * @file pwm_index.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_PWM_INDEX_H
+#define LONGBOARD_PWM_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct usp_pwm_t;
+struct usp_controller_t;
+
+/**
+ * @brief The number of slots in a pwm index. Must be a power of two and
+ * larger than the number of pwms on any controller we support.
+ */
+#define LB_PWM_INDEX_SLOTS 16
+
+struct lb_pwm_index_entry_t {
+  uint32_t lbpe_hash;
+  const char *lbpe_name;
+  struct usp_pwm_t *lbpe_pwm;
+};
+
+/**
+ * @brief A hashed index of a controller's pwms by name. Built by walking
+ * the pwm list once, so later lookups don't have to.
+ */
+struct lb_pwm_index_t {
+  struct lb_pwm_index_entry_t lbpi_entries[LB_PWM_INDEX_SLOTS];
+  size_t lbpi_count;
+  bool lbpi_built;
+};
+
+int lb_pwm_index_build(struct lb_pwm_index_t *index,
+                       struct usp_controller_t *controller);
+void lb_pwm_index_clear(struct lb_pwm_index_t *index);
+struct usp_pwm_t *lb_pwm_index_find(struct lb_pwm_index_t *index,
+                                    const char *name);
+
+#endif /* LONGBOARD_PWM_INDEX_H */
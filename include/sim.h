@@ -0,0 +1,101 @@
+/**
+ * @file sim.h
+ * @brief A board physics simulator that stands in for the pwms, so ramp
+ * settings can be compared without a board.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_SIM_H
+#define LONGBOARD_SIM_H
+
+#include <stdint.h>
+
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lb_sim_t;
+struct lb_throttle_t;
+
+/**
+ * @brief The physical parameters of a simulated board and rider. All
+ * values are SI units.
+ */
+struct lb_sim_params_t {
+  /** Time constant of an ESC following its duty cycle, in seconds. **/
+  double lbsp_esc_tau;
+
+  /** Motor winding resistance, in ohms. **/
+  double lbsp_motor_resistance;
+  /** Motor torque constant, in Nm/A. Also the back-EMF in V*s/rad. **/
+  double lbsp_motor_kt;
+  /** Current an ESC will let one motor draw, in amps. **/
+  double lbsp_motor_max_current;
+
+  /** Motor turns per wheel turn. **/
+  double lbsp_gear_ratio;
+  /** Wheel radius, in meters. **/
+  double lbsp_wheel_radius;
+
+  /** Rider plus board, in kg. **/
+  double lbsp_mass;
+  /** Grade as rise over run, positive is uphill. **/
+  double lbsp_grade;
+  /** Rolling resistance coefficient. **/
+  double lbsp_rolling_coeff;
+  /** Drag coefficient times frontal area, in m^2. **/
+  double lbsp_drag_area;
+
+  /** Battery open circuit voltage when full, in volts. **/
+  double lbsp_battery_voltage;
+  /** Battery voltage when empty, in volts. **/
+  double lbsp_battery_empty_voltage;
+  /** Battery internal resistance, in ohms. **/
+  double lbsp_battery_resistance;
+  /** Battery capacity, in amp hours. **/
+  double lbsp_battery_capacity;
+
+  /** Physics step, in seconds. **/
+  double lbsp_step;
+};
+
+/**
+ * @brief The simulated state of the board.
+ */
+struct lb_sim_state_t {
+  /** Simulated time, in nanoseconds. **/
+  uint64_t lbss_time_ns;
+  /** Board speed, in m/s. **/
+  double lbss_speed;
+  /** Distance travelled, in meters. **/
+  double lbss_distance;
+  /** Current drawn from the battery, in amps. **/
+  double lbss_current;
+  /** Battery voltage under load, in volts. **/
+  double lbss_voltage;
+  /** Charge drawn from the battery so far, in amp hours. **/
+  double lbss_charge_used;
+  /** Highest battery current seen since the last reset, in amps. **/
+  double lbss_peak_current;
+};
+
+void lb_sim_params_default(struct lb_sim_params_t *params);
+
+struct lb_sim_t *lb_sim_new(const struct lb_sim_params_t *params);
+void lb_sim_delete(struct lb_sim_t *sim);
+void lb_sim_reset(struct lb_sim_t *sim);
+
+void lb_sim_step(struct lb_sim_t *sim, uint64_t nsec);
+void lb_sim_state_get(struct lb_sim_t *sim, struct lb_sim_state_t *out_state);
+
+struct lb_throttle_t *lb_throttle_sim_new(struct lb_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_SIM_H */
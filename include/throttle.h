@@ -9,34 +9,175 @@
 #ifndef LONGBOARD_THROTTLE_H
 #define LONGBOARD_THROTTLE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "calib.h"
+#include "power.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
- * @brief The maximum amount of power to change by in cycle. If you
- * change the cycle, don't forget to change this value.
+ * @brief The default maximum amount of power to change by in a cycle of
+ * the default length. At runtime the ramp limit comes from the
+ * throttle's config, in power per second.
  *
  * Currently 20% of power per second.
  */
-#define LB_THROTTLE_MAX_ACCEL 2.0f
+#define LB_THROTTLE_MAX_ACCEL LB_POWER_C(2.0)
 
 /**
- * @brief The time in seconds to sleep before changing the power level.
+ * @brief The default time in seconds to sleep before changing the power
+ * level.
  */
 #define LB_THROTTLE_SEC_SLEEP 0
 
 /**
- * @brief The time in nanoseconds to sleep before changing the power level.
+ * @brief The default time in nanoseconds to sleep before changing the
+ * power level.
  */
 #define LB_THROTTLE_NSEC_SLEEP 100000000
 
+/**
+ * @brief How the runner schedules its ticks.
+ */
+enum lb_throttle_tick_mode_t {
+  /** Tick at the config's tick period. */
+  LB_THROTTLE_TICK_FIXED,
+  /** Tick fast while ramping and back off to a keepalive when steady. */
+  LB_THROTTLE_TICK_ADAPTIVE
+};
+
+/**
+ * @brief A snapshot of how the runner is ticking.
+ */
+struct lb_throttle_tick_stats_t {
+  /** The period the runner is currently ticking at, in nanoseconds. */
+  uint64_t lbts_period_ns;
+  /** The smoothed cost of writing every channel, in nanoseconds. */
+  uint64_t lbts_write_ns;
+  /** The runner's CPU time per second of wall time, in nanoseconds. */
+  uint64_t lbts_cpu_ns_per_sec;
+  /** The number of ticks run since the throttle was initialized. */
+  uint64_t lbts_ticks;
+};
+
+/**
+ * @brief The number of pwm channels a throttle drives.
+ */
+#define LB_THROTTLE_CHANNELS 2
+
+enum lb_throttle_channel_t {
+  LB_THROTTLE_LEFT = 0,
+  LB_THROTTLE_RIGHT = 1
+};
+
+/**
+ * @brief Runtime tuning for a throttle. A config is published as a whole
+ * and takes effect from the next tick.
+ */
+struct lb_throttle_config_t {
+  /** The most the power may change by in a second. */
+  lb_power_t lbtc_ramp_per_sec;
+  /** The tick period in fixed mode, and the longest ramping tick. */
+  uint64_t lbtc_tick_ns;
+  /** Requests are clamped to between these, except 0 stays off. */
+  lb_power_t lbtc_power_min;
+  lb_power_t lbtc_power_max;
+  /** Each channel is written its power times its trim. */
+  lb_power_t lbtc_trim[LB_THROTTLE_CHANNELS];
+  /** Then mapped through its curve to the duty cycle its ESC needs. */
+  struct lb_calib_t lbtc_calib[LB_THROTTLE_CHANNELS];
+};
+
+/**
+ * @brief Where a throttle is in recovering from pwm faults.
+ */
+enum lb_throttle_fault_state_t {
+  /** Driving the pwms normally. */
+  LB_THROTTLE_FAULT_OK,
+  /** A write failed, and each tick tries to bring the pwms back. */
+  LB_THROTTLE_FAULT_RECOVERING,
+  /** Recovery ran out of attempts, the pwms stay off until cleared. */
+  LB_THROTTLE_FAULT_FAILED
+};
+
+/**
+ * @brief The fault state of a throttle, and counters on its faults.
+ */
+struct lb_throttle_fault_t {
+  enum lb_throttle_fault_state_t lbtf_state;
+  /** The channel and status code of the last fault. */
+  int lbtf_channel;
+  int lbtf_rc;
+  /** Faults the pwms may get past on their own, and ones they won't. */
+  uint64_t lbtf_transient;
+  uint64_t lbtf_persistent;
+  uint64_t lbtf_recoveries;
+  /** Ticks the last recovery took, and the longest one did. */
+  unsigned int lbtf_recover_ticks;
+  unsigned int lbtf_recover_ticks_max;
+  /** Ticks spent recovering or failed. */
+  uint64_t lbtf_lost_ticks;
+};
+
+/**
+ * @brief The uplink channels lb_throttle_telemetry_publish() reports on.
+ * They sit at the top of the id range, clear of application channels.
+ */
+#define LB_THROTTLE_TELEMETRY_POWER 13
+#define LB_THROTTLE_TELEMETRY_REQUEST 14
+#define LB_THROTTLE_TELEMETRY_FAULT 15
+
+struct lb_comm_t;
+struct lb_throttle_t;
+
 struct lb_throttle_t *lb_throttle_new();
 void lb_throttle_delete(struct lb_throttle_t *throttle);
 
+size_t lb_throttle_sizeof();
+size_t lb_throttle_alignof();
+int lb_throttle_init(struct lb_throttle_t *storage);
+void lb_throttle_deinit(struct lb_throttle_t *throttle);
+
 int lb_throttle_start(struct lb_throttle_t *throttle);
 int lb_throttle_stop(struct lb_throttle_t *throttle);
 
-int lb_throttle_request_set(struct lb_throttle_t *throttle, float power);
-int lb_throttle_request_get(struct lb_throttle_t *throttle, float *out_power);
+bool lb_throttle_is_live(struct lb_throttle_t *throttle);
+int lb_throttle_wait_live(struct lb_throttle_t *throttle,
+                          unsigned int timeout_ms);
+
+int lb_throttle_tick_mode_set(struct lb_throttle_t *throttle,
+                              enum lb_throttle_tick_mode_t mode);
+int lb_throttle_tick_stats_get(struct lb_throttle_t *throttle,
+                               struct lb_throttle_tick_stats_t *out_stats);
+
+void lb_throttle_config_default(struct lb_throttle_config_t *config);
+int lb_throttle_config_set(struct lb_throttle_t *throttle,
+                           const struct lb_throttle_config_t *config);
+int lb_throttle_config_get(struct lb_throttle_t *throttle,
+                           struct lb_throttle_config_t *out_config);
+
+int lb_throttle_request_set(struct lb_throttle_t *throttle, lb_power_t power);
+int lb_throttle_request_get(struct lb_throttle_t *throttle,
+                            lb_power_t *out_power);
+
+int lb_throttle_current_set(struct lb_throttle_t *throttle, lb_power_t power);
+int lb_throttle_current_get(struct lb_throttle_t *throttle,
+                            lb_power_t *out_power);
+
+int lb_throttle_fault_get(struct lb_throttle_t *throttle,
+                          struct lb_throttle_fault_t *out_fault);
+int lb_throttle_fault_clear(struct lb_throttle_t *throttle);
+
+int lb_throttle_telemetry_publish(struct lb_throttle_t *throttle,
+                                  struct lb_comm_t *comm);
 
-int lb_throttle_current_set(struct lb_throttle_t *throttle, float power);
-int lb_throttle_current_get(struct lb_throttle_t *throttle, float *out_power);
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* LONGBOARD_THROTTLE_H */
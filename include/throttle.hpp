@@ -0,0 +1,282 @@
+/**
+ * @file throttle.hpp
+ * @brief A header only C++17 layer over the throttle. RAII handles for
+ * the C objects, plus a ramp and a throttle that are specialized at
+ * compile time for each product's channel count, tick period and ramp
+ * limit.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_THROTTLE_HPP
+#define LONGBOARD_THROTTLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "errors.h"
+#include "power.h"
+#include "throttle.h"
+
+namespace lb {
+
+/**
+ * @brief A power level in Q16.16 fixed point, whatever the library was
+ * built with.
+ */
+using fixed_t = std::int32_t;
+
+/**
+ * @brief How to build a value type from an exact ratio at compile time.
+ */
+template <typename Value> struct value_traits;
+
+template <> struct value_traits<float> {
+  static constexpr float
+  from_ratio(std::uint64_t num, std::uint64_t den)
+  {
+    return static_cast<float>(num) / static_cast<float>(den);
+  }
+};
+
+template <> struct value_traits<fixed_t> {
+  static constexpr fixed_t
+  from_ratio(std::uint64_t num, std::uint64_t den)
+  {
+    return static_cast<fixed_t>(((num << 16) + den / 2) / den);
+  }
+};
+
+/**
+ * @brief A throttle configuration, fixed at compile time.
+ *
+ * @tparam Channels The number of pwm channels to drive.
+ * @tparam TickNs The tick period in nanoseconds.
+ * @tparam RampPerSec The largest change in power per second, in percent.
+ * @tparam Value The power type, float or fixed_t.
+ */
+template <std::size_t Channels,
+          std::uint64_t TickNs = LB_THROTTLE_NSEC_SLEEP,
+          std::uint64_t RampPerSec = 20,
+          typename Value = lb_power_t>
+struct throttle_config {
+  static_assert(Channels > 0, "A throttle needs at least one channel.");
+  static_assert(TickNs > 0, "The tick period can't be zero.");
+
+  using value_type = Value;
+  static constexpr std::size_t channels = Channels;
+  static constexpr std::uint64_t tick_ns = TickNs;
+
+  /** The largest change in power in a single tick. */
+  static constexpr value_type ramp_per_tick =
+      value_traits<Value>::from_ratio(RampPerSec * TickNs, 1000000000ULL);
+
+  static_assert(ramp_per_tick > value_type(0),
+                "The ramp limit rounds to nothing at this tick period.");
+};
+
+/**
+ * @brief The ramp for a throttle configuration. All of the limits are
+ * constants, so each tick compiles down to a clamp per channel.
+ */
+template <typename Config> class ramp {
+public:
+  using value_type = typename Config::value_type;
+  using values_type = std::array<value_type, Config::channels>;
+
+  static constexpr value_type limit = Config::ramp_per_tick;
+
+  /**
+   * @brief Step one channel towards its target. Written as a clamp so it
+   * compiles to min/max or conditional moves rather than branches.
+   */
+  static constexpr value_type
+  step(value_type current, value_type target) noexcept
+  {
+    value_type diff = target - current;
+    diff = diff < -limit ? -limit : diff;
+    diff = diff > limit ? limit : diff;
+    return current + diff;
+  }
+
+  /**
+   * @brief Step every channel towards its target.
+   */
+  constexpr void
+  tick(const values_type &target) noexcept
+  {
+    for (std::size_t i = 0; i < Config::channels; i++) {
+      current_[i] = step(current_[i], target[i]);
+    }
+  }
+
+  constexpr const values_type &
+  current() const noexcept
+  {
+    return current_;
+  }
+
+  constexpr void
+  reset() noexcept
+  {
+    current_.fill(value_type(0));
+  }
+
+private:
+  values_type current_{};
+};
+
+/**
+ * @brief A throttle specialized at compile time. Each tick steps every
+ * channel through ramp<Config> and writes the channels that moved to
+ * the pwm backend. Channels step from what was last written, so one
+ * whose write fails is retried a single step on from the pwm, however
+ * long the outage.
+ *
+ * @tparam Config A throttle_config.
+ * @tparam Pwm The pwm backend, with an int set(std::size_t channel,
+ * value_type duty) that returns a status code.
+ */
+template <typename Config, typename Pwm> class static_throttle {
+public:
+  using value_type = typename Config::value_type;
+  using values_type = typename ramp<Config>::values_type;
+
+  static constexpr value_type power_max =
+      value_traits<value_type>::from_ratio(100, 1);
+
+  explicit static_throttle(Pwm pwm) : pwm_(std::move(pwm)) {}
+
+  /**
+   * @brief Request a power level on every channel, clamped to 0-100%.
+   */
+  constexpr void
+  request_set(value_type power) noexcept
+  {
+    target_.fill(clamp(power));
+  }
+
+  /**
+   * @brief Request a power level on one channel, clamped to 0-100%.
+   */
+  constexpr int
+  request_set(std::size_t channel, value_type power) noexcept
+  {
+    if (channel >= Config::channels)
+      return LB_THROTTLE_ERROR;
+    target_[channel] = clamp(power);
+    return LB_OK;
+  }
+
+  /**
+   * @brief Step every channel and write the ones that changed.
+   *
+   * @return A status code, from the first write that failed.
+   */
+  int
+  tick() noexcept
+  {
+    int rc, first = LB_OK;
+    value_type next;
+
+    for (std::size_t i = 0; i < Config::channels; i++) {
+      next = ramp<Config>::step(written_[i], target_[i]);
+      if (next == written_[i])
+        continue;
+      rc = pwm_.set(i, next);
+      if (rc != LB_OK) {
+        first = first == LB_OK ? rc : first;
+        continue;
+      }
+      written_[i] = next;
+    }
+    return first;
+  }
+
+  constexpr const values_type &request() const noexcept { return target_; }
+  constexpr const values_type &current() const noexcept { return written_; }
+  Pwm &pwm() noexcept { return pwm_; }
+
+private:
+  static constexpr value_type
+  clamp(value_type power) noexcept
+  {
+    power = power < value_type(0) ? value_type(0) : power;
+    return power > power_max ? power_max : power;
+  }
+
+  Pwm pwm_;
+  values_type target_{};
+  values_type written_{};
+};
+
+namespace detail {
+
+struct throttle_deleter {
+  void
+  operator()(lb_throttle_t *throttle) const noexcept
+  {
+    lb_throttle_delete(throttle);
+  }
+};
+
+} // namespace detail
+
+/**
+ * @brief A move only owner of an lb_throttle_t. Methods return the same
+ * status codes as the C functions they wrap.
+ */
+class throttle {
+public:
+  throttle() : handle_(lb_throttle_new()) {}
+  explicit throttle(lb_throttle_t *handle) noexcept : handle_(handle) {}
+
+  throttle(throttle &&) noexcept = default;
+  throttle &operator=(throttle &&) noexcept = default;
+  throttle(const throttle &) = delete;
+  throttle &operator=(const throttle &) = delete;
+
+  explicit operator bool() const noexcept { return handle_ != nullptr; }
+  lb_throttle_t *get() const noexcept { return handle_.get(); }
+  lb_throttle_t *release() noexcept { return handle_.release(); }
+
+  int start() noexcept { return lb_throttle_start(get()); }
+  int stop() noexcept { return lb_throttle_stop(get()); }
+  bool is_live() noexcept { return lb_throttle_is_live(get()); }
+
+  int
+  wait_live(unsigned int timeout_ms) noexcept
+  {
+    return lb_throttle_wait_live(get(), timeout_ms);
+  }
+
+  int
+  request_set(lb_power_t power) noexcept
+  {
+    return lb_throttle_request_set(get(), power);
+  }
+
+  int
+  request_get(lb_power_t *out_power) noexcept
+  {
+    return lb_throttle_request_get(get(), out_power);
+  }
+
+  int
+  current_get(lb_power_t *out_power) noexcept
+  {
+    return lb_throttle_current_get(get(), out_power);
+  }
+
+private:
+  std::unique_ptr<lb_throttle_t, detail::throttle_deleter> handle_;
+};
+
+} // namespace lb
+
+#endif /* LONGBOARD_THROTTLE_HPP */
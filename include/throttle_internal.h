@@ -13,42 +13,186 @@
 #include <stdint.h>
 #include <pthread.h>
 
+#include "profile_internal.h"
+#include "pwm_index.h"
 #include "throttle.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct usp_pwm_t;
 struct usp_controller_t;
 
+/**
+ * @brief The first delay between attempts to enable the pwms.
+ */
+#define LB_THROTTLE_START_BACKOFF_MIN_NSEC 1000000ULL
+
+/**
+ * @brief The longest delay between attempts to enable the pwms.
+ */
+#define LB_THROTTLE_START_BACKOFF_MAX_NSEC 1000000000ULL
+
+/**
+ * @brief The default tick period. LB_THROTTLE_MAX_ACCEL is the change
+ * allowed over one period of this length.
+ */
+#define LB_THROTTLE_PERIOD_NSEC                                               \
+  ((uint64_t)LB_THROTTLE_SEC_SLEEP * 1000000000ULL + LB_THROTTLE_NSEC_SLEEP)
+
+/**
+ * @brief The shortest period the adaptive runner will tick at.
+ */
+#define LB_THROTTLE_ADAPTIVE_MIN_NSEC 5000000ULL
+
+/**
+ * @brief The period the adaptive runner backs off to while steady.
+ */
+#define LB_THROTTLE_ADAPTIVE_KEEPALIVE_NSEC 1000000000ULL
+
+/**
+ * @brief How many times the write cost a ramping tick must last, so
+ * writing the pwms never takes more than a fraction of the runner's time.
+ */
+#define LB_THROTTLE_ADAPTIVE_WRITE_FACTOR 4
+
+/**
+ * @brief The shortest and longest tick periods a config may ask for.
+ */
+#define LB_THROTTLE_TICK_MIN_NSEC 1000000ULL
+#define LB_THROTTLE_TICK_MAX_NSEC 10000000000ULL
+
+/**
+ * @brief How far a pwm may read back from what was written to it, for
+ * backends that round the duty cycle.
+ */
+#define LB_THROTTLE_READBACK_TOLERANCE LB_POWER_C(0.01)
+
+/**
+ * @brief The most ticks a throttle spends recovering from a pwm fault
+ * before it gives up and leaves the pwms off.
+ */
+#define LB_THROTTLE_RECOVER_TICKS 8
+
+/**
+ * @brief The wall time the CPU usage estimate is averaged over.
+ */
+#define LB_THROTTLE_CPU_WINDOW_NSEC 1000000000ULL
+
+struct lb_throttle_t;
+
+typedef int (*lb_pwm_generic_func)(struct lb_throttle_t *);
+typedef int (*lb_pwm_channel_func)(struct lb_throttle_t *, int channel);
+typedef int (*lb_pwm_set_func)(struct lb_throttle_t *, int channel,
+                               lb_power_t duty);
+typedef int (*lb_pwm_get_func)(struct lb_throttle_t *, int channel,
+                               lb_power_t *out_duty);
+
+/**
+ * @brief The pwm backend a throttle drives. libusp by default, but
+ * anything that takes duty cycles will do, like the simulator. A set
+ * that may succeed if simply tried again returns LB_RETRY, any other
+ * failure is taken to need the pwm re-enabled.
+ */
+struct lb_pwm_ops_t {
+  /** Find the pwms, called by lb_throttle_start with the lock held. **/
+  lb_pwm_generic_func lbp_open_func;
+  lb_pwm_generic_func lbp_deinit_func;
+  lb_pwm_channel_func lbp_enable_func;
+  lb_pwm_channel_func lbp_disable_func;
+  lb_pwm_set_func lbp_set_func;
+  lb_pwm_get_func lbp_get_func;
+};
+
+extern const struct lb_pwm_ops_t lb_pwm_usp_ops;
+
 /**
  * @brief The master throttle
  */
 struct lb_throttle_t {
+  const struct lb_pwm_ops_t *lbt_pwm_ops;
+  void *lbt_pwm_ctx;
+
   struct usp_controller_t *lbt_pwm_controller;
+  struct lb_pwm_index_t lbt_pwm_index;
+
+  struct usp_pwm_t *lbt_pwms[LB_THROTTLE_CHANNELS];
+  const char *lbt_pwm_names[LB_THROTTLE_CHANNELS];
+
+  lb_power_t lbt_current_power;
+  lb_power_t lbt_target_power;
 
-  struct usp_pwm_t *lbt_pwm_left;
-  struct usp_pwm_t *lbt_pwm_right;
+  /** The power last written, and what each channel got after trims. */
+  lb_power_t lbt_written_power;
+  lb_power_t lbt_written[LB_THROTTLE_CHANNELS];
 
-  const char *lbt_pwm_left_name;
-  const char *lbt_pwm_right_name;
+  /**
+   * The published config. Readers count themselves in
+   * lbt_config_readers around their use of it, and a writer swaps the
+   * pointer then waits for the count to drain before freeing the old
+   * snapshot. The first snapshot lives inline and is never freed.
+   */
+  struct lb_throttle_config_t *lbt_config;
+  unsigned int lbt_config_readers;
+  struct lb_throttle_config_t lbt_config_initial;
+  pthread_mutex_t lbt_config_mutex;
 
-  float lbt_current_power;
-  float lbt_target_power;
-  float lbt_max_accel;
+  enum lb_throttle_tick_mode_t lbt_tick_mode;
+  uint64_t lbt_step_ns;
+  uint64_t lbt_period_ns;
+  uint64_t lbt_write_ns;
+  uint64_t lbt_cpu_ns_per_sec;
+  uint64_t lbt_ticks;
+  bool lbt_ramping;
+  bool lbt_wakeup;
+
+  struct lb_profile_t lbt_profile;
+
+  /** Fault recovery, see lb_throttle_recover. **/
+  struct lb_throttle_fault_t lbt_fault;
+  unsigned int lbt_recover_attempt;
+  bool lbt_pwms_stopped;
 
   bool lbt_running;
+  bool lbt_live;
   pthread_t lbt_thread;
   pthread_mutex_t lbt_mutex;
+  pthread_cond_t lbt_cond;
 };
 
+int lb_throttle_backend_init(struct lb_throttle_t *throttle,
+                             const struct lb_pwm_ops_t *ops, void *ctx);
+int lb_throttle_internal_init(struct lb_throttle_t *throttle,
+                              const char *pwm_left, const char *pwm_right);
 struct lb_throttle_t *lb_throttle_internal_new(const char *pwm_left,
                                                const char *pwm_right);
+int lb_throttle_test_init(struct lb_throttle_t *storage);
 struct lb_throttle_t *lb_throttle_test_new();
 
+int lb_throttle_channels_set(struct lb_throttle_t *throttle, lb_power_t power,
+                             struct lb_profile_t *profile, int *out_channel);
 int lb_throttle_stop_pwms(struct lb_throttle_t *throttle);
 int lb_throttle_start_pwms(struct lb_throttle_t *throttle);
 
 void *lb_throttle_runner(void *ctx);
+int lb_throttle_tick(struct lb_throttle_t *throttle);
+
+lb_power_t lb_throttle_ramp(lb_power_t current, lb_power_t target,
+                            lb_power_t max_accel);
+
+const struct lb_throttle_config_t *
+lb_throttle_config_acquire(struct lb_throttle_t *throttle);
+void lb_throttle_config_release(struct lb_throttle_t *throttle);
 
 bool lb_throttle_get_running(struct lb_throttle_t *throttle);
 void lb_throttle_set_running(struct lb_throttle_t *throttle, bool running);
+bool lb_throttle_wait(struct lb_throttle_t *throttle, uint64_t nsec);
+bool lb_throttle_sleep_until(struct lb_throttle_t *throttle,
+                             uint64_t deadline_ns);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* LONGBOARD_THROTTLE_INTERNAL_H */
@@ -0,0 +1,102 @@
+/**
+ * @file trace.h
+ * @brief Static tracepoints for bpftrace and perf. With sys/sdt.h each
+ * one is a test of its semaphore, so arguments are only worked out once
+ * a probe is attached. Without it they compile away entirely.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_TRACE_H
+#define LONGBOARD_TRACE_H
+
+#include "lb_config.h"
+#include "power.h"
+
+#ifdef LB_HAVE_SDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Every probe in the liblb provider. Each one gets a semaphore,
+ * defined in trace.c, that the tracer bumps while it is attached.
+ */
+#define LB_TRACE_PROBES(X)                                                    \
+  X(tick__start)                                                              \
+  X(tick__end)                                                                \
+  X(pwm__write)                                                               \
+  X(pwm__write__done)                                                         \
+  X(request__set)                                                             \
+  X(comm__read__start)                                                        \
+  X(comm__read__done)                                                         \
+  X(comm__parse)                                                              \
+  X(bt__connect)                                                              \
+  X(bt__disconnect)
+
+#ifdef LB_HAVE_SDT
+
+#define LB_TRACE_SEMAPHORE(name) liblb_##name##_semaphore
+
+#define LB_TRACE_DECLARE(name)                                                \
+  extern volatile unsigned short LB_TRACE_SEMAPHORE(name);
+LB_TRACE_PROBES(LB_TRACE_DECLARE)
+#undef LB_TRACE_DECLARE
+
+/**
+ * @brief Check whether a probe is attached.
+ */
+#define LB_TRACE_ENABLED(name)                                                \
+  __builtin_expect(LB_TRACE_SEMAPHORE(name) != 0, 0)
+
+#define LB_TRACE0(name)                                                       \
+  do {                                                                        \
+    if (LB_TRACE_ENABLED(name))                                               \
+      DTRACE_PROBE(liblb, name);                                              \
+  } while (0)
+#define LB_TRACE1(name, a)                                                    \
+  do {                                                                        \
+    if (LB_TRACE_ENABLED(name))                                               \
+      DTRACE_PROBE1(liblb, name, a);                                          \
+  } while (0)
+#define LB_TRACE2(name, a, b)                                                 \
+  do {                                                                        \
+    if (LB_TRACE_ENABLED(name))                                               \
+      DTRACE_PROBE2(liblb, name, a, b);                                       \
+  } while (0)
+#define LB_TRACE3(name, a, b, c)                                              \
+  do {                                                                        \
+    if (LB_TRACE_ENABLED(name))                                               \
+      DTRACE_PROBE3(liblb, name, a, b, c);                                    \
+  } while (0)
+
+#else
+
+#define LB_TRACE_ENABLED(name) 0
+
+/* sizeof keeps the arguments used without evaluating them. */
+#define LB_TRACE0(name) do { } while (0)
+#define LB_TRACE1(name, a) do { (void)sizeof(a); } while (0)
+#define LB_TRACE2(name, a, b)                                                 \
+  do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#define LB_TRACE3(name, a, b, c)                                              \
+  do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+
+#endif
+
+/**
+ * @brief Pass a power level to a probe as hundredths of a percent, so
+ * scripts see the same integer in either power representation.
+ */
+#define LB_TRACE_POWER(power) ((long)(LB_POWER_TO_FLOAT(power) * 100.0f))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_TRACE_H */
@@ -0,0 +1,78 @@
+/**
+ * @file uring.h
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#ifndef LONGBOARD_URING_H
+#define LONGBOARD_URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lb_config.h"
+
+#ifdef LB_HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The number of receive buffers registered with the kernel.
+ * Must be a power of two.
+ */
+#define LB_URING_BUFS 8
+
+/**
+ * @brief The size of each registered receive buffer.
+ */
+#define LB_URING_BUF_SIZE 64
+
+/**
+ * @brief How long to wait for data before giving up, matching the
+ * socket's receive timeout.
+ */
+#define LB_URING_TIMEOUT_SEC 2
+
+/**
+ * @brief An io_uring engine reading a socket with a multishot receive.
+ * The kernel picks one of the registered buffers for each completion,
+ * so a steady stream of samples costs no submissions at all.
+ */
+struct lb_uring_t {
+  bool lbu_active;
+#ifdef LB_HAVE_IO_URING
+  int lbu_fd;
+  bool lbu_armed;
+
+  struct io_uring lbu_ring;
+  struct io_uring_buf_ring *lbu_buf_ring;
+
+  /** The completion being consumed, if it didn't fit in one read. */
+  bool lbu_pending;
+  uint16_t lbu_pending_bid;
+  size_t lbu_pending_off;
+  size_t lbu_pending_len;
+
+  char lbu_bufs[LB_URING_BUFS][LB_URING_BUF_SIZE];
+#endif
+};
+
+int lb_uring_init(struct lb_uring_t *uring, int fd);
+void lb_uring_deinit(struct lb_uring_t *uring);
+int lb_uring_recv(struct lb_uring_t *uring, char *buf, size_t len,
+                  size_t *out_len);
+int lb_uring_read(struct lb_uring_t *uring, int fd, char *buf, size_t len,
+                  size_t *out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LONGBOARD_URING_H */
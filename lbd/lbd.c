@@ -0,0 +1,919 @@
+/**
+ * @file lbd.c
+ * @brief A daemon that owns the throttle and the comm link, and serves
+ * local clients over a Unix socket from a single epoll loop.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "comm.h"
+#include "errors.h"
+#include "failsafe.h"
+#include "lbd_proto.h"
+#include "sim.h"
+#include "throttle.h"
+
+#define LBD_CLIENTS_MAX 256
+#define LBD_EVENTS_MAX 64
+
+/** Room for a few full batches from a client that pipelines. **/
+#define LBD_IN_SIZE                                                           \
+  (4 * (sizeof(struct lbd_frame_header_t) +                                   \
+        LBD_BATCH_MAX * sizeof(struct lbd_command_t)))
+#define LBD_OUT_SIZE 16384
+
+/** How often subscribed state is checked for changes. **/
+#define LBD_WATCH_NSEC 10000000L
+
+/** How long the remote may go quiet before the failsafe trips. **/
+#define LBD_FAILSAFE_TIMEOUT_MS 500
+
+#define LBD_EVENTS_ALL                                                        \
+  (LBD_EVENT_REQUEST | LBD_EVENT_CURRENT | LBD_EVENT_FAULT)
+
+/** epoll tags, clients are tagged with their slot after these. **/
+enum lbd_tag_t {
+  LBD_TAG_LISTEN,
+  LBD_TAG_TIMER,
+  LBD_TAG_SIGNAL,
+  LBD_TAG_CLIENTS
+};
+
+struct lbd_client_t {
+  int lc_fd;
+  unsigned int lc_slot;
+  uint32_t lc_events;
+  /** Events didn't fit and were dropped, the next event frame says so. **/
+  bool lc_lost;
+  /** Waiting on the socket to drain before reading more. **/
+  bool lc_blocked;
+  /** The client shut its side, close once everything it sent is answered. **/
+  bool lc_eof;
+  /** What epoll is watching the socket for. **/
+  uint32_t lc_armed;
+
+  size_t lc_in_len;
+  uint8_t lc_in[LBD_IN_SIZE];
+
+  size_t lc_out_start;
+  size_t lc_out_end;
+  uint8_t lc_out[LBD_OUT_SIZE];
+};
+
+struct lbd_t {
+  int ld_epoll;
+  int ld_listen;
+  int ld_timer;
+  int ld_signal;
+  bool ld_running;
+
+  struct lb_throttle_t *ld_throttle;
+  struct lb_sim_t *ld_sim;
+
+  const char *ld_bt_addr;
+  struct lb_comm_t *ld_comm;
+  struct lb_channels_t *ld_channels;
+  struct lb_failsafe_t *ld_failsafe;
+  pthread_t ld_comm_thread;
+  volatile bool ld_comm_running;
+
+  struct lbd_client_t *ld_clients[LBD_CLIENTS_MAX];
+  uint32_t ld_subscribed;
+
+  /** The state last sent to subscribers. **/
+  int64_t ld_request;
+  int64_t ld_current;
+  int64_t ld_fault;
+};
+
+static int64_t
+lbd_power_to_wire(lb_power_t power)
+{
+  return (int64_t)lroundf(LB_POWER_TO_FLOAT(power) * 100.0f);
+}
+
+static lb_power_t
+lbd_power_from_wire(int64_t value)
+{
+  return LB_POWER_FROM_FLOAT((float)value / 100.0f);
+}
+
+/**
+ * @brief Read the throttle state behind one event.
+ *
+ * @return A status code.
+ */
+static int
+lbd_state_get(struct lbd_t *lbd, uint32_t event, int64_t *out_value)
+{
+  int rc;
+  lb_power_t power;
+  struct lb_throttle_fault_t fault;
+
+  switch (event) {
+  case LBD_EVENT_REQUEST:
+    rc = lb_throttle_request_get(lbd->ld_throttle, &power);
+    *out_value = lbd_power_to_wire(power);
+    return rc;
+  case LBD_EVENT_CURRENT:
+    rc = lb_throttle_current_get(lbd->ld_throttle, &power);
+    *out_value = rc == LB_OK ? lbd_power_to_wire(power) : 0;
+    return rc;
+  case LBD_EVENT_FAULT:
+    rc = lb_throttle_fault_get(lbd->ld_throttle, &fault);
+    *out_value = fault.lbtf_state;
+    return rc;
+  default:
+    return LB_NOT_SUPPORTED;
+  }
+}
+
+/**
+ * @brief Start a frame in a client's output. The caller must have
+ * checked there is room for it.
+ *
+ * @return The header, to fill in the count of once the records are in.
+ */
+static struct lbd_frame_header_t *
+lbd_frame_begin(struct lbd_client_t *client, uint8_t flags)
+{
+  struct lbd_frame_header_t *header;
+
+  if (client->lc_out_start == client->lc_out_end) {
+    client->lc_out_start = 0;
+    client->lc_out_end = 0;
+  }
+
+  header = (struct lbd_frame_header_t *)(client->lc_out + client->lc_out_end);
+  header->lbfh_version = LBD_PROTO_VERSION;
+  header->lbfh_flags = flags;
+  header->lbfh_count = 0;
+  client->lc_out_end += sizeof(*header);
+  return header;
+}
+
+static void
+lbd_frame_add(struct lbd_client_t *client, struct lbd_frame_header_t *header,
+              uint32_t seq, uint16_t op, int16_t status, int64_t value)
+{
+  struct lbd_response_t *response;
+
+  response = (struct lbd_response_t *)(client->lc_out + client->lc_out_end);
+  response->lbdr_seq = seq;
+  response->lbdr_op = op;
+  response->lbdr_status = status;
+  response->lbdr_value = value;
+  client->lc_out_end += sizeof(*response);
+  header->lbfh_count++;
+}
+
+/**
+ * @brief Check whether a frame of some records fits in a client's
+ * output as it is.
+ */
+static bool
+lbd_out_fits(struct lbd_client_t *client, size_t records)
+{
+  return LBD_OUT_SIZE - client->lc_out_end >=
+      sizeof(struct lbd_frame_header_t) +
+      records * sizeof(struct lbd_response_t);
+}
+
+/**
+ * @brief Check whether a frame of some records fits in a client's
+ * output, compacting it if that makes room. Don't call this with a
+ * frame half built, it moves them.
+ */
+static bool
+lbd_out_room(struct lbd_client_t *client, size_t records)
+{
+  if (lbd_out_fits(client, records))
+    return true;
+
+  if (client->lc_out_start > 0) {
+    memmove(client->lc_out, client->lc_out + client->lc_out_start,
+            client->lc_out_end - client->lc_out_start);
+    client->lc_out_end -= client->lc_out_start;
+    client->lc_out_start = 0;
+  }
+
+  return lbd_out_fits(client, records);
+}
+
+/**
+ * @brief Queue an event frame for a client with the given events.
+ */
+static void
+lbd_events_queue(struct lbd_client_t *client, uint32_t events,
+                 const int64_t *values)
+{
+  uint32_t event;
+  unsigned int i;
+  struct lbd_frame_header_t *header;
+
+  events &= client->lc_events;
+  if (events == 0)
+    return;
+
+  if (!lbd_out_fits(client, 3)) {
+    /* A slow client misses changes rather than stalling the rest. */
+    client->lc_lost = true;
+    return;
+  }
+
+  header = lbd_frame_begin(client, LBD_FRAME_EVENTS |
+                           (client->lc_lost ? LBD_FRAME_LOST : 0));
+  client->lc_lost = false;
+  for (i = 0; i < 3; i++) {
+    event = 1U << i;
+    if (events & event)
+      lbd_frame_add(client, header, 0, (uint16_t)event, LB_OK, values[i]);
+  }
+}
+
+static void lbd_client_close(struct lbd_t *lbd, struct lbd_client_t *client);
+static void lbd_client_flush(struct lbd_t *lbd, struct lbd_client_t *client);
+
+/**
+ * @brief Look for changes in subscribed state, and tell subscribers.
+ */
+static void
+lbd_watch(struct lbd_t *lbd)
+{
+  int64_t values[3] = { 0, 0, 0 };
+  int64_t *last[3] = { &lbd->ld_request, &lbd->ld_current, &lbd->ld_fault };
+  uint32_t changed = 0, event;
+  unsigned int i;
+  struct lbd_client_t *client;
+
+  for (i = 0; i < 3; i++) {
+    event = 1U << i;
+    if (!(lbd->ld_subscribed & event))
+      continue;
+    if (lbd_state_get(lbd, event, &values[i]) != LB_OK)
+      continue;
+    if (values[i] != *last[i]) {
+      *last[i] = values[i];
+      changed |= event;
+    }
+  }
+
+  if (changed == 0)
+    return;
+
+  for (i = 0; i < LBD_CLIENTS_MAX; i++) {
+    client = lbd->ld_clients[i];
+    if (client == NULL || !(client->lc_events & changed))
+      continue;
+    lbd_out_room(client, 3);
+    lbd_events_queue(client, changed, values);
+    lbd_client_flush(lbd, client);
+  }
+}
+
+static void
+lbd_subscribed_update(struct lbd_t *lbd)
+{
+  unsigned int i;
+
+  lbd->ld_subscribed = 0;
+  for (i = 0; i < LBD_CLIENTS_MAX; i++) {
+    if (lbd->ld_clients[i] != NULL)
+      lbd->ld_subscribed |= lbd->ld_clients[i]->lc_events;
+  }
+}
+
+/**
+ * @brief Run one command.
+ *
+ * @return The status code to answer with.
+ */
+static int
+lbd_command_run(struct lbd_t *lbd, struct lbd_client_t *client,
+                const struct lbd_command_t *command, int64_t *out_value)
+{
+  int rc;
+  unsigned int i;
+  uint32_t event;
+  int64_t values[3] = { 0, 0, 0 };
+
+  *out_value = 0;
+
+  switch (command->lbdc_op) {
+  case LBD_OP_PING:
+    return LB_OK;
+  case LBD_OP_REQUEST_SET:
+    if (command->lbdc_value < 0 || command->lbdc_value > 10000)
+      return LB_PARSE_ERROR;
+    return lb_throttle_request_set(lbd->ld_throttle,
+                                   lbd_power_from_wire(command->lbdc_value));
+  case LBD_OP_REQUEST_GET:
+    return lbd_state_get(lbd, LBD_EVENT_REQUEST, out_value);
+  case LBD_OP_CURRENT_GET:
+    return lbd_state_get(lbd, LBD_EVENT_CURRENT, out_value);
+  case LBD_OP_FAULT_GET:
+    return lbd_state_get(lbd, LBD_EVENT_FAULT, out_value);
+  case LBD_OP_FAULT_CLEAR:
+    return lb_throttle_fault_clear(lbd->ld_throttle);
+  case LBD_OP_SUBSCRIBE:
+    client->lc_events = (uint32_t)command->lbdc_value & LBD_EVENTS_ALL;
+    lbd_subscribed_update(lbd);
+
+    /* Start subscribers off with the current state, so they don't race
+     * the first change. */
+    for (i = 0; i < 3; i++) {
+      event = 1U << i;
+      if (client->lc_events & event) {
+        rc = lbd_state_get(lbd, event, &values[i]);
+        if (rc != LB_OK)
+          return rc;
+      }
+    }
+    lbd_events_queue(client, client->lc_events, values);
+    return LB_OK;
+  default:
+    return LB_NOT_SUPPORTED;
+  }
+}
+
+/**
+ * @brief Run every complete batch a client has sent, while there is room
+ * to answer it.
+ *
+ * @return A status code. LB_PARSE_ERROR if the client broke protocol.
+ */
+static int
+lbd_client_process(struct lbd_t *lbd, struct lbd_client_t *client)
+{
+  int rc;
+  size_t offset = 0, size, records;
+  uint16_t i;
+  int64_t value;
+  struct lbd_frame_header_t in_header, *out_header;
+  struct lbd_command_t command;
+
+  while (client->lc_in_len - offset >= sizeof(in_header)) {
+    memcpy(&in_header, client->lc_in + offset, sizeof(in_header));
+    if (in_header.lbfh_version != LBD_PROTO_VERSION ||
+        in_header.lbfh_count > LBD_BATCH_MAX)
+      return LB_PARSE_ERROR;
+
+    size = sizeof(in_header) + in_header.lbfh_count * sizeof(command);
+    if (client->lc_in_len - offset < size)
+      break;
+
+    /*
+     * Room for every response, plus each subscribe's events and the
+     * extra headers around them, so the batch is answered in one go.
+     */
+    records = in_header.lbfh_count;
+    for (i = 0; i < in_header.lbfh_count; i++) {
+      memcpy(&command, client->lc_in + offset + sizeof(in_header) +
+             i * sizeof(command), sizeof(command));
+      if (command.lbdc_op == LBD_OP_SUBSCRIBE)
+        records += 4;
+    }
+    if (!lbd_out_room(client, records)) {
+      client->lc_blocked = true;
+      break;
+    }
+
+    out_header = NULL;
+    for (i = 0; i < in_header.lbfh_count; i++) {
+      memcpy(&command, client->lc_in + offset + sizeof(in_header) +
+             i * sizeof(command), sizeof(command));
+      rc = lbd_command_run(lbd, client, &command, &value);
+      if (command.lbdc_op == LBD_OP_SUBSCRIBE) {
+        /* The events went in ahead, answer in a frame after them. */
+        out_header = NULL;
+      }
+      if (out_header == NULL)
+        out_header = lbd_frame_begin(client, 0);
+      lbd_frame_add(client, out_header, command.lbdc_seq, command.lbdc_op,
+                    (int16_t)rc, value);
+    }
+    offset += size;
+  }
+
+  if (offset > 0) {
+    memmove(client->lc_in, client->lc_in + offset, client->lc_in_len - offset);
+    client->lc_in_len -= offset;
+  }
+
+  return LB_OK;
+}
+
+/**
+ * @brief Update what epoll watches a client for.
+ */
+static void
+lbd_client_arm(struct lbd_t *lbd, struct lbd_client_t *client)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.data.u64 = LBD_TAG_CLIENTS + client->lc_slot;
+  /*
+   * A half close shows up as the end of the input, once everything
+   * before it is read. Hangups and errors are always reported.
+   */
+  ev.events = 0;
+  if (!client->lc_blocked && !client->lc_eof)
+    ev.events |= EPOLLIN;
+  if (client->lc_out_start != client->lc_out_end)
+    ev.events |= EPOLLOUT;
+
+  if (ev.events != client->lc_armed) {
+    epoll_ctl(lbd->ld_epoll, EPOLL_CTL_MOD, client->lc_fd, &ev);
+    client->lc_armed = ev.events;
+  }
+}
+
+/**
+ * @brief Send what the socket takes of a client's output without
+ * blocking.
+ */
+static void
+lbd_client_flush(struct lbd_t *lbd, struct lbd_client_t *client)
+{
+  ssize_t sent;
+
+  while (client->lc_out_start != client->lc_out_end) {
+    sent = send(client->lc_fd, client->lc_out + client->lc_out_start,
+                client->lc_out_end - client->lc_out_start,
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      lbd_client_close(lbd, client);
+      return;
+    }
+    client->lc_out_start += (size_t)sent;
+  }
+
+  if (client->lc_out_start == client->lc_out_end) {
+    client->lc_out_start = 0;
+    client->lc_out_end = 0;
+
+    /* Everything a half closed client sent has been answered. */
+    if (client->lc_eof && !client->lc_blocked) {
+      lbd_client_close(lbd, client);
+      return;
+    }
+  }
+
+  lbd_client_arm(lbd, client);
+}
+
+static void
+lbd_client_close(struct lbd_t *lbd, struct lbd_client_t *client)
+{
+  epoll_ctl(lbd->ld_epoll, EPOLL_CTL_DEL, client->lc_fd, NULL);
+  close(client->lc_fd);
+  lbd->ld_clients[client->lc_slot] = NULL;
+  if (client->lc_events != 0)
+    lbd_subscribed_update(lbd);
+  free(client);
+}
+
+/**
+ * @brief Start serving a connected, non-blocking socket. The socket is
+ * closed if there's no room for another client.
+ *
+ * @return 0 on success.
+ */
+static int
+lbd_client_add(struct lbd_t *lbd, int fd)
+{
+  unsigned int slot;
+  struct epoll_event ev;
+  struct lbd_client_t *client;
+
+  for (slot = 0; slot < LBD_CLIENTS_MAX; slot++) {
+    if (lbd->ld_clients[slot] == NULL)
+      break;
+  }
+
+  client = slot < LBD_CLIENTS_MAX ? calloc(1, sizeof(*client)) : NULL;
+  if (client == NULL) {
+    close(fd);
+    return -1;
+  }
+
+  client->lc_fd = fd;
+  client->lc_slot = slot;
+  client->lc_armed = EPOLLIN;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = client->lc_armed;
+  ev.data.u64 = LBD_TAG_CLIENTS + slot;
+  if (epoll_ctl(lbd->ld_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+    close(fd);
+    free(client);
+    return -1;
+  }
+
+  lbd->ld_clients[slot] = client;
+  return 0;
+}
+
+static void
+lbd_accept(struct lbd_t *lbd)
+{
+  int fd;
+
+  while ((fd = accept4(lbd->ld_listen, NULL, NULL,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    lbd_client_add(lbd, fd);
+  }
+}
+
+static void
+lbd_client_event(struct lbd_t *lbd, struct lbd_client_t *client,
+                 uint32_t events)
+{
+  ssize_t size;
+  bool watch = false;
+  unsigned int slot = client->lc_slot;
+
+  if (events & (EPOLLHUP | EPOLLERR)) {
+    lbd_client_close(lbd, client);
+    return;
+  }
+
+  if (events & EPOLLOUT) {
+    /* The flush closes the client if the socket went bad. */
+    lbd_client_flush(lbd, client);
+    if (lbd->ld_clients[slot] != client)
+      return;
+
+    if (client->lc_blocked) {
+      /* Answer what was held back now there's room. */
+      client->lc_blocked = false;
+      watch = true;
+      if (lbd_client_process(lbd, client) != LB_OK) {
+        lbd_client_close(lbd, client);
+        return;
+      }
+    }
+  }
+
+  if (events & EPOLLIN) {
+    /*
+     * Leave the input be while answers are held back, or there is no
+     * room for it. A zero length recv would look like a hangup.
+     */
+    size = -1;
+    if (!client->lc_blocked && !client->lc_eof &&
+        client->lc_in_len < LBD_IN_SIZE) {
+      size = recv(client->lc_fd, client->lc_in + client->lc_in_len,
+                  LBD_IN_SIZE - client->lc_in_len, 0);
+      if (size < 0 && errno != EAGAIN && errno != EINTR) {
+        lbd_client_close(lbd, client);
+        return;
+      }
+    }
+
+    /* A half close, answer what was sent before it, then hang up. */
+    if (size == 0)
+      client->lc_eof = true;
+
+    if (size > 0) {
+      client->lc_in_len += (size_t)size;
+      watch = true;
+      if (lbd_client_process(lbd, client) != LB_OK) {
+        lbd_client_close(lbd, client);
+        return;
+      }
+    }
+  }
+
+  lbd_client_flush(lbd, client);
+
+  /* Requests take effect right away, so let subscribers hear of them. */
+  if (watch && (lbd->ld_subscribed & LBD_EVENT_REQUEST))
+    lbd_watch(lbd);
+}
+
+/**
+ * @brief Pass a power level from the remote's power channel on to the
+ * throttle.
+ */
+static void
+lbd_comm_power(unsigned int id, const union lb_channel_value_t *value,
+               void *ctx)
+{
+  struct lbd_t *lbd = ctx;
+
+  (void)id;
+  lb_throttle_request_set(lbd->ld_throttle, value->lbcv_power);
+}
+
+/**
+ * @brief Route the remote's records through the channel registry,
+ * reconnecting whenever the link drops. The throttle's state goes back
+ * as telemetry after every read, whether or not the remote sent
+ * anything.
+ */
+static void *
+lbd_comm_run(void *ctx)
+{
+  int rc;
+  struct lbd_t *lbd = ctx;
+
+  while (lbd->ld_comm_running) {
+    if (lb_comm_open(lbd->ld_comm) != LB_OK) {
+      sleep(1);
+      continue;
+    }
+
+    while (lbd->ld_comm_running) {
+      lb_throttle_telemetry_publish(lbd->ld_throttle, lbd->ld_comm);
+      rc = lb_comm_pump(lbd->ld_comm, lbd->ld_channels);
+      if (rc != LB_OK && rc != LB_RETRY) {
+        break;
+      }
+    }
+
+    lb_comm_close(lbd->ld_comm);
+  }
+
+  return NULL;
+}
+
+static int
+lbd_listen(const char *path)
+{
+  int fd;
+  struct sockaddr_un addr;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path is too long: %s\n", path);
+    return -1;
+  }
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("socket");
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    perror(path);
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static int
+lbd_epoll_add(struct lbd_t *lbd, int fd, uint64_t tag)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = tag;
+  return epoll_ctl(lbd->ld_epoll, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+ * @brief Serve clients until signalled.
+ */
+static int
+lbd_serve(struct lbd_t *lbd)
+{
+  int count, i;
+  uint64_t tag, expirations;
+  struct signalfd_siginfo info;
+  struct epoll_event events[LBD_EVENTS_MAX];
+  struct lbd_client_t *client;
+
+  lbd->ld_running = true;
+  while (lbd->ld_running) {
+    count = epoll_wait(lbd->ld_epoll, events, LBD_EVENTS_MAX, -1);
+    if (count < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("epoll_wait");
+      return 1;
+    }
+
+    for (i = 0; i < count; i++) {
+      tag = events[i].data.u64;
+      switch (tag) {
+      case LBD_TAG_LISTEN:
+        lbd_accept(lbd);
+        break;
+      case LBD_TAG_TIMER:
+        if (read(lbd->ld_timer, &expirations, sizeof(expirations)) > 0 &&
+            lbd->ld_subscribed != 0)
+          lbd_watch(lbd);
+        break;
+      case LBD_TAG_SIGNAL:
+        if (read(lbd->ld_signal, &info, sizeof(info)) > 0)
+          lbd->ld_running = false;
+        break;
+      default:
+        client = lbd->ld_clients[tag - LBD_TAG_CLIENTS];
+        if (client != NULL)
+          lbd_client_event(lbd, client, events[i].events);
+        break;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static void
+lbd_usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [-s socket | -c fd] [-b bt_addr] [-S]\n"
+          "  -s  The socket to listen on (default %s).\n"
+          "  -c  Serve one client already connected on fd, instead of\n"
+          "      listening.\n"
+          "  -b  Take power levels from a bluetooth remote.\n"
+          "  -S  Drive a simulated board instead of the pwms.\n",
+          name, LBD_SOCKET_PATH);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt, rc = 1, client_fd = -1;
+  unsigned int i;
+  const char *path = LBD_SOCKET_PATH;
+  bool simulate = false;
+  sigset_t mask;
+  struct itimerspec interval;
+  struct lb_sim_params_t params;
+  struct lbd_t lbd;
+  int source;
+
+  memset(&lbd, 0, sizeof(lbd));
+  lbd.ld_epoll = lbd.ld_listen = lbd.ld_timer = lbd.ld_signal = -1;
+
+  while ((opt = getopt(argc, argv, "s:c:b:Sh")) != -1) {
+    switch (opt) {
+    case 's':
+      path = optarg;
+      break;
+    case 'c':
+      client_fd = atoi(optarg);
+      break;
+    case 'b':
+      lbd.ld_bt_addr = optarg;
+      break;
+    case 'S':
+      simulate = true;
+      break;
+    default:
+      lbd_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  /*
+   * Signals arrive through epoll, so the loop stays single threaded.
+   * Block them before any thread starts, so every thread inherits it.
+   */
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &mask, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (simulate) {
+    lb_sim_params_default(&params);
+    lbd.ld_sim = lb_sim_new(&params);
+    lbd.ld_throttle = lbd.ld_sim ? lb_throttle_sim_new(lbd.ld_sim) : NULL;
+  } else {
+    lbd.ld_throttle = lb_throttle_new();
+  }
+  if (lbd.ld_throttle == NULL || lb_throttle_start(lbd.ld_throttle) != LB_OK) {
+    fprintf(stderr, "Failed to start the throttle.\n");
+    goto out;
+  }
+
+  if (lbd.ld_bt_addr != NULL) {
+    lbd.ld_comm = lb_comm_bt_new(lbd.ld_bt_addr);
+    lbd.ld_channels = lb_channels_new();
+    lbd.ld_failsafe = lb_failsafe_new(lbd.ld_throttle);
+    if (lbd.ld_comm == NULL || lbd.ld_channels == NULL ||
+        lbd.ld_failsafe == NULL ||
+        lb_channels_subscribe(lbd.ld_channels, LB_CHANNEL_POWER,
+                              lbd_comm_power, &lbd) != LB_OK ||
+        lb_failsafe_source_add(lbd.ld_failsafe, LBD_FAILSAFE_TIMEOUT_MS,
+                               &source) != LB_OK) {
+      fprintf(stderr, "Failed to set up the comm.\n");
+      goto out;
+    }
+    lb_comm_failsafe_attach(lbd.ld_comm, lbd.ld_failsafe, source);
+    lb_failsafe_start(lbd.ld_failsafe);
+    lbd.ld_comm_running = true;
+    pthread_create(&(lbd.ld_comm_thread), NULL, lbd_comm_run, &lbd);
+  }
+
+  lbd.ld_epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (client_fd < 0)
+    lbd.ld_listen = lbd_listen(path);
+  lbd.ld_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  lbd.ld_signal = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (lbd.ld_epoll < 0 || (client_fd < 0 && lbd.ld_listen < 0) ||
+      lbd.ld_timer < 0 || lbd.ld_signal < 0) {
+    fprintf(stderr, "Failed to set up the event loop.\n");
+    goto out;
+  }
+
+  interval.it_interval.tv_sec = 0;
+  interval.it_interval.tv_nsec = LBD_WATCH_NSEC;
+  interval.it_value = interval.it_interval;
+  timerfd_settime(lbd.ld_timer, 0, &interval, NULL);
+
+  if ((lbd.ld_listen >= 0 &&
+       lbd_epoll_add(&lbd, lbd.ld_listen, LBD_TAG_LISTEN) != 0) ||
+      lbd_epoll_add(&lbd, lbd.ld_timer, LBD_TAG_TIMER) != 0 ||
+      lbd_epoll_add(&lbd, lbd.ld_signal, LBD_TAG_SIGNAL) != 0) {
+    perror("epoll_ctl");
+    goto out;
+  }
+
+  /* A client handed over on the command line, like a socketpair end. */
+  if (client_fd >= 0 &&
+      (fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK) != 0 ||
+       lbd_client_add(&lbd, client_fd) != 0)) {
+    fprintf(stderr, "Failed to serve fd %d.\n", client_fd);
+    goto out;
+  }
+
+  rc = lbd_serve(&lbd);
+
+out:
+  for (i = 0; i < LBD_CLIENTS_MAX; i++) {
+    if (lbd.ld_clients[i] != NULL)
+      lbd_client_close(&lbd, lbd.ld_clients[i]);
+  }
+  if (lbd.ld_listen >= 0) {
+    close(lbd.ld_listen);
+    unlink(path);
+  }
+  if (lbd.ld_signal >= 0)
+    close(lbd.ld_signal);
+  if (lbd.ld_timer >= 0)
+    close(lbd.ld_timer);
+  if (lbd.ld_epoll >= 0)
+    close(lbd.ld_epoll);
+
+  if (lbd.ld_comm_running) {
+    lbd.ld_comm_running = false;
+    pthread_join(lbd.ld_comm_thread, NULL);
+  }
+  if (lbd.ld_failsafe != NULL) {
+    lb_failsafe_stop(lbd.ld_failsafe);
+    lb_failsafe_delete(lbd.ld_failsafe);
+  }
+  if (lbd.ld_comm != NULL)
+    lb_comm_delete(lbd.ld_comm);
+  if (lbd.ld_channels != NULL)
+    lb_channels_delete(lbd.ld_channels);
+
+  if (lbd.ld_throttle != NULL) {
+    lb_throttle_stop(lbd.ld_throttle);
+    lb_throttle_delete(lbd.ld_throttle);
+  }
+  if (lbd.ld_sim != NULL)
+    lb_sim_delete(lbd.ld_sim);
+
+  return rc;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file lbd_load.c
+ * @brief Load lbd with more and more clients, reporting commands per
+ * second and round trip latency at each step.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "errors.h"
+#include "lbd_proto.h"
+
+#define LOAD_DEFAULT_CLIENTS "1,2,4,8,16,32"
+#define LOAD_DEFAULT_BATCH 16
+#define LOAD_DEFAULT_DURATION_MS 2000
+#define LOAD_STEPS_MAX 32
+
+/**
+ * @brief One client's run.
+ */
+struct load_client_t {
+  const char *lc_path;
+  unsigned int lc_batch;
+  uint64_t lc_deadline_ns;
+
+  uint64_t lc_commands;
+  uint64_t lc_errors;
+  uint64_t *lc_rtt;
+  size_t lc_count;
+  size_t lc_size;
+  bool lc_failed;
+};
+
+static uint64_t
+load_now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int
+load_compare_u64(const void *a, const void *b)
+{
+  uint64_t lhs = *(const uint64_t *)a, rhs = *(const uint64_t *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static int
+load_connect(const char *path)
+{
+  int fd;
+  struct sockaddr_un addr;
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static bool
+load_read_all(int fd, void *buf, size_t len)
+{
+  ssize_t size;
+  uint8_t *pos = buf;
+
+  while (len > 0) {
+    size = read(fd, pos, len);
+    if (size <= 0)
+      return false;
+    pos += size;
+    len -= (size_t)size;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Send batches back to back until the deadline, timing each from
+ * send until its last response is in.
+ */
+static void *
+load_client_run(void *ctx)
+{
+  int fd;
+  uint8_t out[sizeof(struct lbd_frame_header_t) +
+              LBD_BATCH_MAX * sizeof(struct lbd_command_t)];
+  uint16_t i;
+  uint32_t seq = 0;
+  unsigned int answered;
+  uint64_t start_ns, *rtt;
+  size_t out_len;
+  struct load_client_t *client = ctx;
+  struct lbd_frame_header_t header;
+  struct lbd_command_t command;
+  struct lbd_response_t response;
+
+  fd = load_connect(client->lc_path);
+  if (fd < 0) {
+    client->lc_failed = true;
+    return NULL;
+  }
+
+  while (load_now_ns() < client->lc_deadline_ns) {
+    header.lbfh_version = LBD_PROTO_VERSION;
+    header.lbfh_flags = 0;
+    header.lbfh_count = (uint16_t)client->lc_batch;
+    memcpy(out, &header, sizeof(header));
+    out_len = sizeof(header);
+
+    for (i = 0; i < client->lc_batch; i++) {
+      memset(&command, 0, sizeof(command));
+      command.lbdc_seq = ++seq;
+      command.lbdc_op = i % 2 ? LBD_OP_REQUEST_GET : LBD_OP_PING;
+      memcpy(out + out_len, &command, sizeof(command));
+      out_len += sizeof(command);
+    }
+
+    start_ns = load_now_ns();
+    if (write(fd, out, out_len) != (ssize_t)out_len) {
+      client->lc_failed = true;
+      break;
+    }
+
+    answered = 0;
+    while (answered < client->lc_batch) {
+      if (!load_read_all(fd, &header, sizeof(header))) {
+        client->lc_failed = true;
+        goto out;
+      }
+      for (i = 0; i < header.lbfh_count; i++) {
+        if (!load_read_all(fd, &response, sizeof(response))) {
+          client->lc_failed = true;
+          goto out;
+        }
+        if (header.lbfh_flags & LBD_FRAME_EVENTS)
+          continue;
+        if (response.lbdr_status != LB_OK)
+          client->lc_errors++;
+        answered++;
+      }
+    }
+
+    if (client->lc_count == client->lc_size) {
+      client->lc_size = client->lc_size ? client->lc_size * 2 : 4096;
+      rtt = realloc(client->lc_rtt, client->lc_size * sizeof(uint64_t));
+      if (rtt == NULL)
+        abort();
+      client->lc_rtt = rtt;
+    }
+    client->lc_rtt[client->lc_count++] = load_now_ns() - start_ns;
+    client->lc_commands += client->lc_batch;
+  }
+
+out:
+  close(fd);
+  return NULL;
+}
+
+/**
+ * @brief Run one step with some number of clients and print its line.
+ *
+ * @return A status code.
+ */
+static int
+load_step(const char *path, unsigned int clients, unsigned int batch,
+          uint64_t duration_ns)
+{
+  int rc = LB_OK;
+  unsigned int i;
+  uint64_t commands = 0, errors = 0, start_ns, elapsed_ns, *rtt;
+  size_t count = 0;
+  pthread_t *threads;
+  struct load_client_t *runs;
+
+  threads = calloc(clients, sizeof(pthread_t));
+  runs = calloc(clients, sizeof(struct load_client_t));
+  if (threads == NULL || runs == NULL) {
+    free(threads);
+    free(runs);
+    return LB_NOT_SUPPORTED;
+  }
+
+  start_ns = load_now_ns();
+  for (i = 0; i < clients; i++) {
+    runs[i].lc_path = path;
+    runs[i].lc_batch = batch;
+    runs[i].lc_deadline_ns = start_ns + duration_ns;
+    pthread_create(&threads[i], NULL, load_client_run, &runs[i]);
+  }
+
+  for (i = 0; i < clients; i++) {
+    pthread_join(threads[i], NULL);
+    commands += runs[i].lc_commands;
+    errors += runs[i].lc_errors;
+    count += runs[i].lc_count;
+    if (runs[i].lc_failed)
+      rc = LB_COMM_ERROR;
+  }
+  elapsed_ns = load_now_ns() - start_ns;
+
+  rtt = malloc((count ? count : 1) * sizeof(uint64_t));
+  if (rtt == NULL)
+    abort();
+  count = 0;
+  for (i = 0; i < clients; i++) {
+    memcpy(rtt + count, runs[i].lc_rtt, runs[i].lc_count * sizeof(uint64_t));
+    count += runs[i].lc_count;
+    free(runs[i].lc_rtt);
+  }
+  qsort(rtt, count, sizeof(uint64_t), load_compare_u64);
+
+  if (count > 0) {
+    printf("%7u %12.0f %9.1f %9.1f %9.1f %7lu\n", clients,
+           (double)commands * 1e9 / (double)elapsed_ns,
+           (double)rtt[(count - 1) * 50 / 100] / 1000.0,
+           (double)rtt[(count - 1) * 99 / 100] / 1000.0,
+           (double)rtt[count - 1] / 1000.0, (unsigned long)errors);
+  } else {
+    printf("%7u %12s\n", clients, "failed");
+  }
+
+  free(rtt);
+  free(runs);
+  free(threads);
+  return rc;
+}
+
+static void
+load_usage(const char *name)
+{
+  fprintf(stderr,
+          "Usage: %s [-s socket] [-c clients] [-b batch] [-d duration_ms]\n"
+          "Load a running lbd, for example one started with lbd -S.\n"
+          "  -s  The socket lbd listens on (default %s).\n"
+          "  -c  Comma separated client counts (default %s).\n"
+          "  -b  Commands per batch, up to %d (default %d).\n"
+          "  -d  How long to run each step (default %d ms).\n",
+          name, LBD_SOCKET_PATH, LOAD_DEFAULT_CLIENTS, LBD_BATCH_MAX,
+          LOAD_DEFAULT_BATCH, LOAD_DEFAULT_DURATION_MS);
+}
+
+int
+main(int argc, char **argv)
+{
+  int opt, rc = 0;
+  unsigned int batch = LOAD_DEFAULT_BATCH, steps = 0, i;
+  unsigned int clients[LOAD_STEPS_MAX];
+  uint64_t duration_ms = LOAD_DEFAULT_DURATION_MS;
+  const char *path = LBD_SOCKET_PATH, *counts = LOAD_DEFAULT_CLIENTS;
+  char *end;
+
+  while ((opt = getopt(argc, argv, "s:c:b:d:h")) != -1) {
+    switch (opt) {
+    case 's':
+      path = optarg;
+      break;
+    case 'c':
+      counts = optarg;
+      break;
+    case 'b':
+      batch = (unsigned int)strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      duration_ms = strtoull(optarg, NULL, 10);
+      break;
+    default:
+      load_usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  while (*counts != '\0' && steps < LOAD_STEPS_MAX) {
+    clients[steps] = (unsigned int)strtoul(counts, &end, 10);
+    if (end == counts || clients[steps] == 0)
+      break;
+    steps++;
+    counts = *end == ',' ? end + 1 : end;
+  }
+
+  if (batch == 0 || batch > LBD_BATCH_MAX || steps == 0) {
+    load_usage(argv[0]);
+    return 1;
+  }
+
+  printf("%7s %12s %9s %9s %9s %7s\n", "clients", "commands/s", "p50_us",
+         "p99_us", "max_us", "errors");
+  for (i = 0; i < steps; i++) {
+    if (load_step(path, clients[i], batch, duration_ms * 1000000ULL) !=
+        LB_OK) {
+      fprintf(stderr, "Clients failed talking to lbd at %s.\n", path);
+      rc = 1;
+    }
+  }
+
+  return rc;
+}
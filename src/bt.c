@@ -13,49 +13,92 @@
 #include <bluetooth/rfcomm.h>
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "comm.h"
 #include "comm_internal.h"
 #include "errors.h"
+#include "trace.h"
 
 /**
- * @brief Create a new comm object based on a bluetooth comm.
+ * @brief Get the size of the storage a bluetooth comm needs.
+ *
+ * @return The size of a bluetooth comm in bytes.
+ */
+size_t
+lb_comm_bt_sizeof()
+{
+  return sizeof(struct lb_comm_bt_storage_t);
+}
+
+/**
+ * @brief Initialize a bluetooth comm in caller provided storage. The
+ * storage must be at least lb_comm_bt_sizeof() bytes and aligned to
+ * lb_comm_alignof().
  *
+ * @param storage The storage to initialize the comm in.
  * @param addr The bluetooth address to connect to.
  *
- * @return A new comm object.
+ * @return A status code.
  */
-struct lb_comm_t *
-lb_comm_bt_new(const char *addr)
+int
+lb_comm_bt_init(struct lb_comm_t *storage, const char *addr)
 {
+  struct lb_comm_bt_storage_t *bt_storage;
   struct lb_comm_t *comm;
   struct lb_comm_bt_t *bt_comm;
 
-  bt_comm = malloc(sizeof(struct lb_comm_bt_t));
-  assert(bt_comm != NULL);
+  bt_storage = (struct lb_comm_bt_storage_t *)storage;
+  comm = &(bt_storage->lbcs_comm);
+  bt_comm = &(bt_storage->lbcs_bt);
 
   bt_comm->lbc_bt_addr = addr;
   bt_comm->lbc_bt_socket = -1;
+  bt_comm->lbc_bt_uring.lbu_active = false;
 
-  comm = lb_comm_new(LB_COMM_BT, bt_comm);
-  comm->lbc_delete_func = lb_comm_bt_delete;
+  lb_comm_init(comm, LB_COMM_BT, bt_comm);
+  comm->lbc_deinit_func = lb_comm_bt_deinit;
   comm->lbc_open_func = lb_comm_bt_open;
   comm->lbc_close_func = lb_comm_bt_close;
-  comm->lbc_get_power_func = lb_comm_bt_get_power;
+  comm->lbc_read_func = lb_comm_bt_read;
+  comm->lbc_write_func = lb_comm_bt_write;
+
+  return LB_OK;
+}
+
+/**
+ * @brief Create a new comm object based on a bluetooth comm.
+ *
+ * @param addr The bluetooth address to connect to.
+ *
+ * @return A new comm object, or NULL on failure.
+ */
+struct lb_comm_t *
+lb_comm_bt_new(const char *addr)
+{
+  struct lb_comm_t *comm;
+
+  comm = malloc(lb_comm_bt_sizeof());
+  if (comm == NULL) {
+    return NULL;
+  }
 
+  lb_comm_bt_init(comm, addr);
   return comm;
 }
 
 /**
- * @brief Delete a bluetooth comm object and the parent comm.
+ * @brief Tear down a bluetooth comm object, closing the socket if it
+ * is open. Doesn't free the storage.
  *
- * @param comm The comm to delete.
+ * @param comm The comm to tear down.
  */
 int
-lb_comm_bt_delete(struct lb_comm_t *comm)
+lb_comm_bt_deinit(struct lb_comm_t *comm)
 {
   struct lb_comm_bt_t *bt_comm = comm->lbc_ctx;
   assert(comm->lbc_type == LB_COMM_BT);
@@ -64,8 +107,6 @@ lb_comm_bt_delete(struct lb_comm_t *comm)
     lb_comm_bt_close(comm);
   }
 
-  free(bt_comm);
-  free(comm);
   return LB_OK;
 }
 
@@ -116,6 +157,9 @@ lb_comm_bt_open(struct lb_comm_t *comm)
     goto out;
   }
 
+  /* Without io_uring we just read the socket directly. */
+  lb_uring_init(&(bt_comm->lbc_bt_uring), sock);
+
 out:
   if (rc != LB_OK) {
     close(sock);
@@ -124,6 +168,7 @@ out:
     bt_comm->lbc_bt_socket = sock;
   }
 
+  LB_TRACE2(bt__connect, rc, sock);
   return rc;
 }
 
@@ -142,6 +187,9 @@ lb_comm_bt_close(struct lb_comm_t *comm)
   assert(comm->lbc_type == LB_COMM_BT);
   bt_comm = comm->lbc_ctx;
 
+  LB_TRACE1(bt__disconnect, bt_comm->lbc_bt_socket);
+
+  lb_uring_deinit(&(bt_comm->lbc_bt_uring));
   close(bt_comm->lbc_bt_socket);
   bt_comm->lbc_bt_socket = -1;
 
@@ -149,50 +197,69 @@ lb_comm_bt_close(struct lb_comm_t *comm)
 }
 
 /**
- * @brief Read a power level from the bluetooth socket.
+ * @brief Read from the bluetooth socket, through io_uring when the
+ * kernel supports it.
  *
  * @param comm The comm object to read.
- * @param out_power The power level read.
+ * @param buf The buffer to read into.
+ * @param len The size of the buffer.
+ * @param out_len The number of bytes read.
  *
  * @return A status code.
  */
 int
-lb_comm_bt_get_power(struct lb_comm_t *comm, float *out_power)
+lb_comm_bt_read(struct lb_comm_t *comm, char *buf, size_t len,
+                size_t *out_len)
+{
+  struct lb_comm_bt_t *bt_comm;
+
+  assert(comm->lbc_type == LB_COMM_BT);
+  bt_comm = comm->lbc_ctx;
+
+  if(bt_comm->lbc_bt_socket < 0) {
+    return LB_COMM_ERROR;
+  }
+
+  return lb_uring_read(&(bt_comm->lbc_bt_uring), bt_comm->lbc_bt_socket,
+                       buf, len, out_len);
+}
+
+/**
+ * @brief Write to the bluetooth socket without blocking. Telemetry must
+ * never stall the thread reading power levels, so a full socket is
+ * reported rather than waited on.
+ *
+ * @param comm The comm object to write.
+ * @param buf The bytes to write.
+ * @param len The number of bytes to write.
+ * @param out_len The number of bytes written.
+ *
+ * @return A status code. LB_RETRY if the socket is full.
+ */
+int
+lb_comm_bt_write(struct lb_comm_t *comm, const char *buf, size_t len,
+                 size_t *out_len)
 {
-  ssize_t size_read, left;
+  ssize_t size_written;
   struct lb_comm_bt_t *bt_comm;
-  char *start;
-  char buf[32];
 
   assert(comm->lbc_type == LB_COMM_BT);
   bt_comm = comm->lbc_ctx;
 
+  *out_len = 0;
   if(bt_comm->lbc_bt_socket < 0) {
     return LB_COMM_ERROR;
   }
 
-  left = sizeof(buf);
-  start = buf;
-
-  while ((size_read = read(bt_comm->lbc_bt_socket, start, left)) > 0) {
-    if (strchr(start, '\n') != NULL) {
-      sscanf(buf, "%f", out_power);
-      return LB_OK;
-    } else {
-      start += size_read;
-      left -= size_read;
-      if (left <= 0) {
-        /*
-         * XXX: Hack, better validation would be nice.
-         * Overflowed the line, retry.
-         */
-        return LB_RETRY;
-      }
+  size_written = send(bt_comm->lbc_bt_socket, buf, len,
+                      MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (size_written < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return LB_RETRY;
     }
+    return LB_COMM_ERROR;
   }
 
-  /*
-   * Failed reading somewhere. This is probably a socket error.
-   */
-  return LB_COMM_ERROR;
+  *out_len = (size_t)size_written;
+  return LB_OK;
 }
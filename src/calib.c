@@ -0,0 +1,440 @@
+/**
+ * @file calib.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "calib.h"
+#include "errors.h"
+
+/**
+ * @brief The longest line a calibration file may have.
+ */
+#define LB_CALIB_LINE_MAX 64
+
+/**
+ * @brief Get the power at one of a curve's points.
+ *
+ * @param point The point, from 0 to LB_CALIB_SEGMENTS.
+ *
+ * @return The power at the point.
+ */
+static lb_power_t
+lb_calib_point_power(unsigned int point)
+{
+  return lb_power_scale(LB_POWER_C(100), point, LB_CALIB_SEGMENTS);
+}
+
+/**
+ * @brief Interpolate from a towards b, by num / den of the way.
+ *
+ * @param a The value at the start.
+ * @param b The value at the end.
+ * @param num How far along, over den.
+ * @param den The whole way. Must be above zero.
+ *
+ * @return The interpolated value.
+ */
+static lb_power_t
+lb_calib_lerp(lb_power_t a, lb_power_t b, lb_power_t num, lb_power_t den)
+{
+#ifdef LB_FIXED_POINT
+  return a + (lb_power_t)(((int64_t)(b - a) * num) / den);
+#else
+  return a + (b - a) * num / den;
+#endif
+}
+
+/**
+ * @brief Look a power up in a curve's table. This is the hot path, so it
+ * is one multiply to find the segment and one to interpolate in it.
+ *
+ * @param calib The curve to look the power up in.
+ * @param power The power, clamped to 0% to 100%.
+ *
+ * @return The duty cycle for the power.
+ */
+static inline lb_power_t
+lb_calib_lookup(const struct lb_calib_t *calib, lb_power_t power)
+{
+  const lb_power_t *duty = calib->lbc_duty;
+#ifdef LB_FIXED_POINT
+  int64_t index;
+  int32_t i, frac;
+
+  power = power < 0 ? 0 : power;
+  power = power > LB_POWER_C(100) ? LB_POWER_C(100) : power;
+
+  /* The index in Q16.16, the division by a constant is a multiply. */
+  index = ((int64_t)power * LB_CALIB_SEGMENTS) / 100;
+  i = (int32_t)(index >> LB_POWER_FRAC_BITS);
+  frac = (int32_t)(index & (LB_POWER_ONE - 1));
+  return duty[i] + (lb_power_t)(((int64_t)(duty[i + 1] - duty[i]) * frac) >>
+                                LB_POWER_FRAC_BITS);
+#else
+  float index;
+  int i;
+
+  /* Written so NaN clamps to 0 rather than indexing anywhere. */
+  power = power > 0.0f ? power : 0.0f;
+  power = power < 100.0f ? power : 100.0f;
+
+  index = power * ((float)LB_CALIB_SEGMENTS / 100.0f);
+  i = (int)index;
+  return duty[i] + (duty[i + 1] - duty[i]) * (index - (float)i);
+#endif
+}
+
+/**
+ * @brief Make a curve the identity, so duty cycle equals power.
+ *
+ * @param calib The curve to fill in.
+ */
+void
+lb_calib_linear(struct lb_calib_t *calib)
+{
+  unsigned int i;
+
+  for (i = 0; i <= LB_CALIB_SEGMENTS; i++)
+    calib->lbc_duty[i] = lb_calib_point_power(i);
+  calib->lbc_duty[LB_CALIB_SEGMENTS + 1] = calib->lbc_duty[LB_CALIB_SEGMENTS];
+  calib->lbc_linear = true;
+}
+
+/**
+ * @brief Get the curve shape that works out to the identity.
+ *
+ * @param params The shape to fill in.
+ */
+void
+lb_calib_params_default(struct lb_calib_params_t *params)
+{
+  params->lbcp_dead_zone = LB_POWER_C(0);
+  params->lbcp_duty_max = LB_POWER_C(100);
+  params->lbcp_expo = LB_POWER_C(0);
+}
+
+/**
+ * @brief Build a curve from a dead zone, a top end and an expo.
+ *
+ * @param calib The curve to fill in.
+ * @param params The shape of the curve.
+ *
+ * @return A status code.
+ */
+int
+lb_calib_curve(struct lb_calib_t *calib,
+               const struct lb_calib_params_t *params)
+{
+  unsigned int i;
+  float x, expo, dead_zone, span;
+
+  if (params->lbcp_dead_zone < LB_POWER_C(0) ||
+      params->lbcp_dead_zone >= params->lbcp_duty_max ||
+      params->lbcp_duty_max > LB_POWER_C(100) ||
+      params->lbcp_expo < LB_POWER_C(0) ||
+      params->lbcp_expo > LB_POWER_C(1.0)) {
+    return LB_THROTTLE_ERROR;
+  }
+
+  if (params->lbcp_dead_zone == LB_POWER_C(0) &&
+      params->lbcp_duty_max == LB_POWER_C(100) &&
+      params->lbcp_expo == LB_POWER_C(0)) {
+    lb_calib_linear(calib);
+    return LB_OK;
+  }
+
+  /* Building the table isn't the hot path, so it can take floats. */
+  expo = LB_POWER_TO_FLOAT(params->lbcp_expo);
+  dead_zone = LB_POWER_TO_FLOAT(params->lbcp_dead_zone);
+  span = LB_POWER_TO_FLOAT(params->lbcp_duty_max) - dead_zone;
+
+  calib->lbc_duty[0] = LB_POWER_C(0);
+  for (i = 1; i <= LB_CALIB_SEGMENTS; i++) {
+    x = (float)i / (float)LB_CALIB_SEGMENTS;
+    x = (1.0f - expo) * x + expo * x * x * x;
+    calib->lbc_duty[i] = LB_POWER_FROM_FLOAT(dead_zone + x * span);
+  }
+  calib->lbc_duty[LB_CALIB_SEGMENTS + 1] = calib->lbc_duty[LB_CALIB_SEGMENTS];
+  calib->lbc_linear = false;
+
+  return LB_OK;
+}
+
+/**
+ * @brief Build a curve from measured points, resampled onto the curve's
+ * even steps. Powers outside the measured range get the duty cycle of
+ * the nearest end.
+ *
+ * @param calib The curve to fill in.
+ * @param powers The measured powers, strictly increasing.
+ * @param duties The duty cycle measured at each power, never decreasing.
+ * The first must be 0, so no power is off, and the last above it.
+ * @param count The number of points, at least 2.
+ *
+ * @return A status code.
+ */
+int
+lb_calib_table(struct lb_calib_t *calib, const lb_power_t *powers,
+               const lb_power_t *duties, size_t count)
+{
+  size_t i, j = 0;
+  lb_power_t power;
+
+  if (count < 2 || count > LB_CALIB_TABLE_MAX)
+    return LB_THROTTLE_ERROR;
+
+  for (i = 0; i < count; i++) {
+    if (powers[i] < LB_POWER_C(0) || powers[i] > LB_POWER_C(100) ||
+        duties[i] < LB_POWER_C(0) || duties[i] > LB_POWER_C(100))
+      return LB_THROTTLE_ERROR;
+    if (i > 0 && (powers[i] <= powers[i - 1] || duties[i] < duties[i - 1]))
+      return LB_THROTTLE_ERROR;
+  }
+  if (duties[0] != LB_POWER_C(0) || duties[count - 1] <= duties[0])
+    return LB_THROTTLE_ERROR;
+
+  for (i = 0; i <= LB_CALIB_SEGMENTS; i++) {
+    power = lb_calib_point_power((unsigned int)i);
+    while (j + 2 < count && powers[j + 1] < power)
+      j++;
+
+    if (power <= powers[0]) {
+      calib->lbc_duty[i] = duties[0];
+    } else if (power >= powers[count - 1]) {
+      calib->lbc_duty[i] = duties[count - 1];
+    } else {
+      calib->lbc_duty[i] = lb_calib_lerp(duties[j], duties[j + 1],
+                                         power - powers[j],
+                                         powers[j + 1] - powers[j]);
+    }
+  }
+  calib->lbc_duty[LB_CALIB_SEGMENTS + 1] = calib->lbc_duty[LB_CALIB_SEGMENTS];
+  calib->lbc_linear = false;
+
+  return LB_OK;
+}
+
+/**
+ * @brief Parse one line of a calibration file, "power duty" separated by
+ * spaces, tabs or a comma.
+ *
+ * @param line The line, NUL terminated.
+ * @param out_power The power parsed.
+ * @param out_duty The duty cycle parsed.
+ *
+ * @return A status code. LB_NOT_FOUND if the line is blank or a comment.
+ */
+static int
+lb_calib_parse_line(char *line, lb_power_t *out_power, lb_power_t *out_duty)
+{
+  int rc;
+  char *pos = line;
+
+  while (isspace((unsigned char)*pos))
+    pos++;
+  if (*pos == '\0' || *pos == '#')
+    return LB_NOT_FOUND;
+
+  rc = lb_power_parse(pos, out_power);
+  if (rc != LB_OK)
+    return rc;
+
+  /* Skip the number lb_power_parse just read, then the separator. */
+  while (*pos != '\0' && !isspace((unsigned char)*pos) && *pos != ',')
+    pos++;
+  while (isspace((unsigned char)*pos) || *pos == ',')
+    pos++;
+  if (*pos == '\0')
+    return LB_PARSE_ERROR;
+
+  return lb_power_parse(pos, out_duty);
+}
+
+/**
+ * @brief Load a measured curve from a calibration file. Each line holds
+ * a power and the duty cycle measured to deliver it, in percent; blank
+ * lines and lines starting with # are skipped. The file is mapped
+ * rather than read, and lines are copied out one at a time to parse.
+ *
+ * @param calib The curve to fill in.
+ * @param path The calibration file.
+ *
+ * @return A status code.
+ */
+int
+lb_calib_load(struct lb_calib_t *calib, const char *path)
+{
+  int fd, rc = LB_OK;
+  size_t count = 0, offset = 0, len;
+  const char *map = MAP_FAILED, *end;
+  char line[LB_CALIB_LINE_MAX];
+  lb_power_t powers[LB_CALIB_TABLE_MAX], duties[LB_CALIB_TABLE_MAX];
+  struct stat info;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return LB_NOT_FOUND;
+
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    rc = LB_PARSE_ERROR;
+    goto out;
+  }
+
+  map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    rc = LB_NOT_FOUND;
+    goto out;
+  }
+
+  while (offset < (size_t)info.st_size) {
+    end = memchr(map + offset, '\n', (size_t)info.st_size - offset);
+    len = end != NULL ? (size_t)(end - (map + offset)) :
+        (size_t)info.st_size - offset;
+    if (len >= sizeof(line)) {
+      rc = LB_PARSE_ERROR;
+      goto out;
+    }
+
+    memcpy(line, map + offset, len);
+    line[len] = '\0';
+    offset += len + 1;
+
+    if (count == LB_CALIB_TABLE_MAX) {
+      rc = LB_PARSE_ERROR;
+      goto out;
+    }
+    rc = lb_calib_parse_line(line, &powers[count], &duties[count]);
+    if (rc == LB_NOT_FOUND) {
+      rc = LB_OK;
+      continue;
+    }
+    if (rc != LB_OK)
+      goto out;
+    count++;
+  }
+
+  rc = lb_calib_table(calib, powers, duties, count);
+
+out:
+  if (map != MAP_FAILED)
+    munmap((void *)map, (size_t)info.st_size);
+  close(fd);
+  return rc;
+}
+
+/**
+ * @brief Check a curve is safe to drive pwms with: every duty cycle is
+ * in range, more power never means less duty, zero power is off and
+ * full power is on.
+ *
+ * @param calib The curve to check.
+ *
+ * @return True if the curve is usable.
+ */
+bool
+lb_calib_valid(const struct lb_calib_t *calib)
+{
+  unsigned int i;
+
+  if (calib->lbc_duty[0] != LB_POWER_C(0) ||
+      calib->lbc_duty[LB_CALIB_SEGMENTS] <= calib->lbc_duty[0])
+    return false;
+
+  for (i = 0; i <= LB_CALIB_SEGMENTS; i++) {
+    if (calib->lbc_duty[i] < LB_POWER_C(0) ||
+        calib->lbc_duty[i] > LB_POWER_C(100))
+      return false;
+    if (i > 0 && calib->lbc_duty[i] < calib->lbc_duty[i - 1])
+      return false;
+  }
+
+  return calib->lbc_duty[LB_CALIB_SEGMENTS + 1] ==
+      calib->lbc_duty[LB_CALIB_SEGMENTS];
+}
+
+/**
+ * @brief Get the duty cycle a curve gives for a power.
+ *
+ * @param calib The curve to evaluate.
+ * @param power The power, clamped to 0% to 100%.
+ *
+ * @return The duty cycle.
+ */
+lb_power_t
+lb_calib_eval(const struct lb_calib_t *calib, lb_power_t power)
+{
+  if (calib->lbc_linear)
+    return power;
+  return lb_calib_lookup(calib, power);
+}
+
+/**
+ * @brief Get the lowest power a curve gives a duty cycle for, to work
+ * back from what a pwm reads.
+ *
+ * @param calib The curve to invert.
+ * @param duty The duty cycle.
+ *
+ * @return The power.
+ */
+lb_power_t
+lb_calib_invert(const struct lb_calib_t *calib, lb_power_t duty)
+{
+  unsigned int low = 0, high = LB_CALIB_SEGMENTS, mid;
+  const lb_power_t *table = calib->lbc_duty;
+
+  if (calib->lbc_linear)
+    return duty;
+  if (duty <= table[0])
+    return LB_POWER_C(0);
+  if (duty > table[LB_CALIB_SEGMENTS])
+    return LB_POWER_C(100);
+
+  /* Keep table[low] < duty <= table[high]. */
+  while (high - low > 1) {
+    mid = (low + high) / 2;
+    if (table[mid] < duty)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  return lb_calib_lerp(lb_calib_point_power(low), lb_calib_point_power(high),
+                       duty - table[low], table[high] - table[low]);
+}
+
+/**
+ * @brief Map a power per channel to its duty cycle, in place. When every
+ * curve is the identity this is a few loads; otherwise every channel
+ * goes through the same branch free lookup, so the compiler can run the
+ * channels side by side.
+ *
+ * @param calibs The curve of each channel.
+ * @param powers The power of each channel, replaced with its duty cycle.
+ * @param count The number of channels.
+ */
+void
+lb_calib_apply(const struct lb_calib_t *calibs, lb_power_t *powers,
+               size_t count)
+{
+  size_t i;
+  bool linear = true;
+
+  for (i = 0; i < count; i++)
+    linear &= calibs[i].lbc_linear;
+  if (linear)
+    return;
+
+  for (i = 0; i < count; i++)
+    powers[i] = lb_calib_lookup(&calibs[i], powers[i]);
+}
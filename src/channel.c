@@ -0,0 +1,452 @@
+/**
+ * @file channel.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channel.h"
+#include "comm.h"
+#include "comm_internal.h"
+#include "errors.h"
+#include "failsafe.h"
+#include "trace.h"
+
+struct lb_channel_subscriber_t {
+  lb_channel_func lbcs_func;
+  void *lbcs_ctx;
+};
+
+struct lb_channel_t {
+  bool lbch_registered;
+  enum lb_channel_type_t lbch_type;
+  enum lb_channel_kind_t lbch_kind;
+
+  /** Bumped on every update, so readers can tell a value is new. **/
+  uint32_t lbch_seq;
+  union lb_channel_value_t lbch_latest;
+
+  union lb_channel_value_t lbch_queue[LB_CHANNEL_QUEUE_DEPTH];
+  unsigned int lbch_queue_head;
+  unsigned int lbch_queue_count;
+
+  struct lb_channel_subscriber_t lbch_subs[LB_CHANNEL_SUBSCRIBERS];
+  unsigned int lbch_sub_count;
+};
+
+struct lb_channels_t {
+  struct lb_channel_t lbcs_channels[LB_CHANNELS_MAX];
+  uint64_t lbcs_dropped;
+  pthread_mutex_t lbcs_mutex;
+};
+
+/**
+ * @brief Parse a value for a channel of some type. The whole value must
+ * be the number, give or take surrounding whitespace.
+ *
+ * @param type The type of the channel.
+ * @param str The value as it came off the wire.
+ * @param out_value The value parsed.
+ *
+ * @return A status code.
+ */
+int
+lb_channel_parse(enum lb_channel_type_t type, const char *str,
+                 union lb_channel_value_t *out_value)
+{
+  int rc;
+  char *end;
+  const char *power_end;
+  long value;
+
+  switch (type) {
+  case LB_CHANNEL_TYPE_POWER:
+    rc = lb_power_parse_end(str, &(out_value->lbcv_power), &power_end);
+    if (rc != LB_OK)
+      return rc;
+    end = (char *)power_end;
+    break;
+  case LB_CHANNEL_TYPE_FLOAT:
+    out_value->lbcv_float = strtof(str, &end);
+    break;
+  case LB_CHANNEL_TYPE_INT:
+    value = strtol(str, &end, 10);
+    if (value < INT32_MIN || value > INT32_MAX)
+      return LB_PARSE_ERROR;
+    out_value->lbcv_int = (int32_t)value;
+    break;
+  case LB_CHANNEL_TYPE_BOOL:
+    value = strtol(str, &end, 10);
+    out_value->lbcv_bool = value != 0;
+    break;
+  default:
+    return LB_PARSE_ERROR;
+  }
+
+  if (end == str)
+    return LB_PARSE_ERROR;
+
+  while (isspace((unsigned char)*end))
+    end++;
+  return *end == '\0' ? LB_OK : LB_PARSE_ERROR;
+}
+
+/**
+ * @brief Split a record into its channel id and value. Records are
+ * "id:value", or a bare value for the power channel.
+ *
+ * @param record The record, without its newline.
+ * @param out_id The channel the record is for.
+ * @param out_value The value part of the record.
+ *
+ * @return A status code. LB_PARSE_ERROR for a malformed id.
+ */
+int
+lb_channel_split(char *record, unsigned int *out_id, char **out_value)
+{
+  char *colon, *end;
+
+  colon = strchr(record, ':');
+  if (colon == NULL) {
+    *out_id = LB_CHANNEL_POWER;
+    *out_value = record;
+    return LB_OK;
+  }
+
+  if (!isdigit((unsigned char)*record))
+    return LB_PARSE_ERROR;
+
+  *out_id = (unsigned int)strtoul(record, &end, 10);
+  if (end != colon)
+    return LB_PARSE_ERROR;
+
+  *out_value = colon + 1;
+  return LB_OK;
+}
+
+/**
+ * @brief Create a channel registry with the power channel registered.
+ *
+ * @return A new channel registry, or NULL on failure.
+ */
+struct lb_channels_t *
+lb_channels_new()
+{
+  struct lb_channels_t *channels;
+
+  channels = calloc(1, sizeof(struct lb_channels_t));
+  if (channels == NULL) {
+    return NULL;
+  }
+
+  pthread_mutex_init(&(channels->lbcs_mutex), NULL);
+  lb_channels_register(channels, LB_CHANNEL_POWER, LB_CHANNEL_TYPE_POWER,
+                       LB_CHANNEL_LATEST);
+  return channels;
+}
+
+/**
+ * @brief Delete a channel registry.
+ *
+ * @param channels The registry to delete.
+ */
+void
+lb_channels_delete(struct lb_channels_t *channels)
+{
+  pthread_mutex_destroy(&(channels->lbcs_mutex));
+  free(channels);
+}
+
+/**
+ * @brief Register a channel, or change the type of one.
+ *
+ * @param channels The registry to add the channel to.
+ * @param id The id the channel has on the wire.
+ * @param type The type of the channel's values.
+ * @param kind Whether to keep the latest value or queue them.
+ *
+ * @return A status code.
+ */
+int
+lb_channels_register(struct lb_channels_t *channels, unsigned int id,
+                     enum lb_channel_type_t type,
+                     enum lb_channel_kind_t kind)
+{
+  struct lb_channel_t *channel;
+
+  if (id >= LB_CHANNELS_MAX)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  channel = &(channels->lbcs_channels[id]);
+  memset(channel, 0, sizeof(struct lb_channel_t));
+  channel->lbch_registered = true;
+  channel->lbch_type = type;
+  channel->lbch_kind = kind;
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+
+  return LB_OK;
+}
+
+/**
+ * @brief Call a function with every new value on a channel. It is called
+ * on the thread that pumps the comm, without any lock held.
+ *
+ * @param channels The registry the channel is in.
+ * @param id The id of the channel.
+ * @param func The function to call.
+ * @param ctx The context to pass to the function.
+ *
+ * @return A status code. LB_NOT_FOUND if the channel isn't registered or
+ * has no room for more subscribers.
+ */
+int
+lb_channels_subscribe(struct lb_channels_t *channels, unsigned int id,
+                      lb_channel_func func, void *ctx)
+{
+  int rc = LB_OK;
+  struct lb_channel_t *channel;
+
+  if (id >= LB_CHANNELS_MAX)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  channel = &(channels->lbcs_channels[id]);
+  if (!channel->lbch_registered ||
+      channel->lbch_sub_count == LB_CHANNEL_SUBSCRIBERS) {
+    rc = LB_NOT_FOUND;
+    goto out;
+  }
+
+  channel->lbch_subs[channel->lbch_sub_count].lbcs_func = func;
+  channel->lbch_subs[channel->lbch_sub_count].lbcs_ctx = ctx;
+  channel->lbch_sub_count++;
+
+out:
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+  return rc;
+}
+
+/**
+ * @brief Route one record to its channel. Records are "id:value", or a
+ * bare value for the power channel. The record is parsed where it lies,
+ * so passing a line straight out of the comm's buffer copies nothing.
+ *
+ * @param channels The registry to route the record through.
+ * @param record The record, without its newline.
+ *
+ * @return A status code. LB_NOT_FOUND for an unregistered channel, and
+ * LB_PARSE_ERROR for a malformed record.
+ */
+int
+lb_channels_dispatch(struct lb_channels_t *channels, char *record)
+{
+  int rc;
+  unsigned int id = LB_CHANNEL_POWER, i, sub_count, slot;
+  char *value_str;
+  union lb_channel_value_t value;
+  struct lb_channel_t *channel;
+  struct lb_channel_subscriber_t subs[LB_CHANNEL_SUBSCRIBERS];
+
+  rc = lb_channel_split(record, &id, &value_str);
+  if (rc != LB_OK) {
+    goto drop;
+  }
+
+  if (id >= LB_CHANNELS_MAX) {
+    rc = LB_NOT_FOUND;
+    goto drop;
+  }
+
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  channel = &(channels->lbcs_channels[id]);
+  if (!channel->lbch_registered) {
+    pthread_mutex_unlock(&(channels->lbcs_mutex));
+    rc = LB_NOT_FOUND;
+    goto drop;
+  }
+
+  rc = lb_channel_parse(channel->lbch_type, value_str, &value);
+  if (rc != LB_OK) {
+    pthread_mutex_unlock(&(channels->lbcs_mutex));
+    goto drop;
+  }
+
+  channel->lbch_seq++;
+  channel->lbch_latest = value;
+  if (channel->lbch_kind == LB_CHANNEL_QUEUE) {
+    if (channel->lbch_queue_count == LB_CHANNEL_QUEUE_DEPTH) {
+      /* Full, drop the oldest so the queue stays current. */
+      channel->lbch_queue_head =
+          (channel->lbch_queue_head + 1) % LB_CHANNEL_QUEUE_DEPTH;
+      channel->lbch_queue_count--;
+      channels->lbcs_dropped++;
+    }
+    slot = (channel->lbch_queue_head + channel->lbch_queue_count) %
+        LB_CHANNEL_QUEUE_DEPTH;
+    channel->lbch_queue[slot] = value;
+    channel->lbch_queue_count++;
+  }
+
+  sub_count = channel->lbch_sub_count;
+  memcpy(subs, channel->lbch_subs, sizeof(subs[0]) * sub_count);
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+
+  LB_TRACE2(comm__parse, id, LB_OK);
+
+  for (i = 0; i < sub_count; i++) {
+    subs[i].lbcs_func(id, &value, subs[i].lbcs_ctx);
+  }
+
+  return LB_OK;
+
+drop:
+  LB_TRACE2(comm__parse, id, rc);
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  channels->lbcs_dropped++;
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+  return rc;
+}
+
+/**
+ * @brief Get the newest value on a channel.
+ *
+ * @param channels The registry the channel is in.
+ * @param id The id of the channel.
+ * @param out_value The newest value.
+ * @param out_seq The number of values the channel has seen, or NULL.
+ *
+ * @return A status code. LB_RETRY if the channel has no value yet.
+ */
+int
+lb_channels_latest_get(struct lb_channels_t *channels, unsigned int id,
+                       union lb_channel_value_t *out_value,
+                       uint32_t *out_seq)
+{
+  int rc = LB_OK;
+  struct lb_channel_t *channel;
+
+  if (id >= LB_CHANNELS_MAX)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  channel = &(channels->lbcs_channels[id]);
+  if (!channel->lbch_registered) {
+    rc = LB_NOT_FOUND;
+  } else if (channel->lbch_seq == 0) {
+    rc = LB_RETRY;
+  } else {
+    *out_value = channel->lbch_latest;
+    if (out_seq != NULL)
+      *out_seq = channel->lbch_seq;
+  }
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+
+  return rc;
+}
+
+/**
+ * @brief Take the oldest value off a queued channel.
+ *
+ * @param channels The registry the channel is in.
+ * @param id The id of the channel.
+ * @param out_value The oldest value.
+ *
+ * @return A status code. LB_RETRY if the queue is empty.
+ */
+int
+lb_channels_queue_pop(struct lb_channels_t *channels, unsigned int id,
+                      union lb_channel_value_t *out_value)
+{
+  int rc = LB_OK;
+  struct lb_channel_t *channel;
+
+  if (id >= LB_CHANNELS_MAX)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  channel = &(channels->lbcs_channels[id]);
+  if (!channel->lbch_registered || channel->lbch_kind != LB_CHANNEL_QUEUE) {
+    rc = LB_NOT_FOUND;
+  } else if (channel->lbch_queue_count == 0) {
+    rc = LB_RETRY;
+  } else {
+    *out_value = channel->lbch_queue[channel->lbch_queue_head];
+    channel->lbch_queue_head =
+        (channel->lbch_queue_head + 1) % LB_CHANNEL_QUEUE_DEPTH;
+    channel->lbch_queue_count--;
+  }
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+
+  return rc;
+}
+
+/**
+ * @brief Get the number of records dropped, because they were malformed,
+ * for an unknown channel, or pushed out of a full queue.
+ *
+ * @param channels The registry to check.
+ *
+ * @return The number of records dropped.
+ */
+uint64_t
+lb_channels_dropped(struct lb_channels_t *channels)
+{
+  uint64_t dropped;
+
+  pthread_mutex_lock(&(channels->lbcs_mutex));
+  dropped = channels->lbcs_dropped;
+  pthread_mutex_unlock(&(channels->lbcs_mutex));
+
+  return dropped;
+}
+
+/**
+ * @brief Read from the comm and route every record to its channel. Waits
+ * for one record, then drains whatever else arrived with it without
+ * reading again, so a burst on one channel never holds up the next
+ * power level behind another read. Pending telemetry is flushed after,
+ * even if the read timed out or failed.
+ *
+ * @param comm The comm to read.
+ * @param channels The registry to route records through.
+ *
+ * @return A status code. Bad records are dropped and counted, not
+ * returned.
+ */
+int
+lb_comm_pump(struct lb_comm_t *comm, struct lb_channels_t *channels)
+{
+  int rc;
+  char *line;
+
+  rc = lb_comm_read_line(comm, &line);
+  if (rc != LB_OK) {
+    /* A quiet remote still gets its telemetry. */
+    lb_comm_uplink_flush(comm);
+    return rc;
+  }
+
+  for (;;) {
+    if (lb_channels_dispatch(channels, line) == LB_OK &&
+        comm->lbc_failsafe != NULL) {
+      lb_failsafe_feed(comm->lbc_failsafe, comm->lbc_failsafe_source);
+    }
+
+    if (!lb_comm_line_buffered(comm) ||
+        lb_comm_read_line(comm, &line) != LB_OK) {
+      break;
+    }
+  }
+
+  /* Telemetry rides along once the inbound records are handled. */
+  lb_comm_uplink_flush(comm);
+
+  return LB_OK;
+}
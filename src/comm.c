@@ -6,60 +6,277 @@
  * @date 2015-10-02
  */
 
-#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "comm.h"
 #include "comm_internal.h"
+#include "errors.h"
+#include "failsafe.h"
+#include "trace.h"
 
 /**
- * @brief Create a generic comm object.
+ * @brief Initialize a generic comm object.
  *
+ * @param comm The comm object to initialize.
  * @param type The type of comm object.
  * @param ctx The context for the specific comm object.
- * @param delete_func The delete func for the comm object.
- *
- * @return A new comm object.
  */
-struct lb_comm_t *
-lb_comm_new(enum lb_comm_type_t type, void *ctx)
+void
+lb_comm_init(struct lb_comm_t *comm, enum lb_comm_type_t type, void *ctx)
 {
-  struct lb_comm_t *comm;
-
-  comm = calloc(sizeof(struct lb_comm_t), 1);
-  assert(comm != NULL);
+  memset(comm, 0, sizeof(struct lb_comm_t));
 
   comm->lbc_type = type;
   comm->lbc_ctx = ctx;
 
-  return comm;
+  pthread_mutex_init(&(comm->lbc_uplink.lbcu_mutex), NULL);
+  comm->lbc_uplink.lbcu_interval_ns = LB_COMM_UPLINK_INTERVAL_NSEC;
+}
+
+/**
+ * @brief Get the alignment the storage for any comm object needs.
+ *
+ * @return The alignment of a comm in bytes.
+ */
+size_t
+lb_comm_alignof()
+{
+  if (_Alignof(struct lb_comm_bt_storage_t) >
+      _Alignof(struct lb_comm_loopback_storage_t))
+    return _Alignof(struct lb_comm_bt_storage_t);
+
+  return _Alignof(struct lb_comm_loopback_storage_t);
 }
 
 /**
- * @brief Delete a generic comm object.
+ * @brief Tear down a comm object without freeing its storage.
+ *
+ * @param comm The comm object to tear down.
+ */
+int
+lb_comm_deinit(struct lb_comm_t *comm)
+{
+  int rc;
+
+  rc = comm->lbc_deinit_func(comm);
+  pthread_mutex_destroy(&(comm->lbc_uplink.lbcu_mutex));
+  return rc;
+}
+
+/**
+ * @brief Delete a comm object created by one of the new functions.
  *
  * @param comm The comm object to delete.
  */
 int
 lb_comm_delete(struct lb_comm_t *comm)
 {
-  return comm->lbc_delete_func(comm);
+  int rc;
+
+  rc = lb_comm_deinit(comm);
+  free(comm);
+  return rc;
 }
 
+/**
+ * @brief Forget the partial line and the frame in flight, so nothing left
+ * over from one connection is read or sent as part of the next.
+ *
+ * @param comm The comm object to reset.
+ */
+static void
+lb_comm_buffers_reset(struct lb_comm_t *comm)
+{
+  comm->lbc_buf_start = 0;
+  comm->lbc_buf_end = 0;
+  comm->lbc_buf_discard = false;
+
+  pthread_mutex_lock(&(comm->lbc_uplink.lbcu_mutex));
+  comm->lbc_uplink.lbcu_out_start = 0;
+  comm->lbc_uplink.lbcu_out_end = 0;
+  pthread_mutex_unlock(&(comm->lbc_uplink.lbcu_mutex));
+}
+
+/**
+ * @brief Open a comm object, starting from empty buffers.
+ *
+ * @param comm The comm object to open.
+ *
+ * @return A status code.
+ */
 int
 lb_comm_open(struct lb_comm_t *comm)
 {
-  return comm->lbc_open_func(comm);
+  int rc;
+
+  rc = comm->lbc_open_func(comm);
+  if (rc == LB_OK)
+    lb_comm_buffers_reset(comm);
+
+  return rc;
 }
 
+/**
+ * @brief Close a comm object, dropping anything still buffered.
+ *
+ * @param comm The comm object to close.
+ *
+ * @return A status code.
+ */
 int
 lb_comm_close(struct lb_comm_t *comm)
 {
+  lb_comm_buffers_reset(comm);
   return comm->lbc_close_func(comm);
 }
 
+/**
+ * @brief Read the next line from the comm. Reads more from the backend
+ * only when no complete line is buffered.
+ *
+ * @param comm The comm object to read.
+ * @param out_line The line read, without its newline. Only valid until
+ * the next read.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_read_line(struct lb_comm_t *comm, char **out_line)
+{
+  int rc;
+  size_t size_read;
+  char *newline;
+
+  for (;;) {
+    newline = memchr(comm->lbc_buf + comm->lbc_buf_start, '\n',
+                     comm->lbc_buf_end - comm->lbc_buf_start);
+    if (newline != NULL && comm->lbc_buf_discard) {
+      /* The tail of an overlong line, it isn't a line of its own. */
+      comm->lbc_buf_start = (size_t)(newline - comm->lbc_buf) + 1;
+      comm->lbc_buf_discard = false;
+      continue;
+    }
+    if (newline != NULL) {
+      *newline = '\0';
+      *out_line = comm->lbc_buf + comm->lbc_buf_start;
+      comm->lbc_buf_start = (size_t)(newline - comm->lbc_buf) + 1;
+      return LB_OK;
+    }
+
+    /* Move the partial line to the front to make room. */
+    if (comm->lbc_buf_start > 0) {
+      memmove(comm->lbc_buf, comm->lbc_buf + comm->lbc_buf_start,
+              comm->lbc_buf_end - comm->lbc_buf_start);
+      comm->lbc_buf_end -= comm->lbc_buf_start;
+      comm->lbc_buf_start = 0;
+    }
+
+    if (comm->lbc_buf_end == LB_COMM_BUF_SIZE) {
+      /*
+       * Overflowed the line. Drop it, and everything up to its newline
+       * when that arrives, so its tail isn't read as a line.
+       */
+      comm->lbc_buf_end = 0;
+      if (comm->lbc_buf_discard)
+        continue;
+      comm->lbc_buf_discard = true;
+      return LB_RETRY;
+    }
+
+    LB_TRACE1(comm__read__start, comm->lbc_type);
+    size_read = 0;
+    rc = comm->lbc_read_func(comm, comm->lbc_buf + comm->lbc_buf_end,
+                             LB_COMM_BUF_SIZE - comm->lbc_buf_end, &size_read);
+    LB_TRACE2(comm__read__done, rc, size_read);
+    if (rc != LB_OK) {
+      return rc;
+    }
+    comm->lbc_buf_end += size_read;
+  }
+}
+
+/**
+ * @brief Check whether a complete line is already buffered, so reading
+ * it won't touch the backend.
+ *
+ * @param comm The comm object to check.
+ *
+ * @return True if a complete line is buffered.
+ */
+bool
+lb_comm_line_buffered(struct lb_comm_t *comm)
+{
+  char *start = comm->lbc_buf + comm->lbc_buf_start;
+  char *end = comm->lbc_buf + comm->lbc_buf_end;
+  char *newline;
+
+  newline = memchr(start, '\n', (size_t)(end - start));
+  if (newline != NULL && comm->lbc_buf_discard) {
+    /* The first newline only ends a line being dropped. */
+    newline = memchr(newline + 1, '\n', (size_t)(end - newline - 1));
+  }
+
+  return newline != NULL;
+}
+
+/**
+ * @brief Read a power level from the comm. Records for other channels
+ * are skipped like malformed ones, use lb_comm_pump() to read them.
+ *
+ * @param comm The comm object to read.
+ * @param out_power The power level read.
+ *
+ * @return A status code. LB_RETRY if the line read wasn't a power level.
+ */
+int
+lb_comm_get_power(struct lb_comm_t *comm, lb_power_t *out_power)
+{
+  int rc;
+  unsigned int id = LB_CHANNEL_POWER;
+  char *line, *value_str;
+  union lb_channel_value_t value;
+
+  rc = lb_comm_read_line(comm, &line);
+  if (rc != LB_OK) {
+    return rc;
+  }
+
+  rc = lb_channel_split(line, &id, &value_str);
+  if (rc == LB_OK && id != LB_CHANNEL_POWER) {
+    rc = LB_NOT_FOUND;
+  }
+  if (rc == LB_OK) {
+    rc = lb_channel_parse(LB_CHANNEL_TYPE_POWER, value_str, &value);
+  }
+  LB_TRACE2(comm__parse, id, rc);
+  if (rc != LB_OK) {
+    return LB_RETRY;
+  }
+
+  *out_power = value.lbcv_power;
+
+  if (comm->lbc_failsafe != NULL) {
+    lb_failsafe_feed(comm->lbc_failsafe, comm->lbc_failsafe_source);
+  }
+
+  return LB_OK;
+}
+
+/**
+ * @brief Feed a failsafe source with every valid power level read.
+ *
+ * @param comm The comm object to watch.
+ * @param failsafe The failsafe to feed, or NULL to detach.
+ * @param source The failsafe source for this comm.
+ *
+ * @return A status code.
+ */
 int
-lb_comm_get_power(struct lb_comm_t *comm, float *out_power)
+lb_comm_failsafe_attach(struct lb_comm_t *comm,
+                        struct lb_failsafe_t *failsafe, int source)
 {
-  return comm->lbc_get_power_func(comm, out_power);
+  comm->lbc_failsafe = failsafe;
+  comm->lbc_failsafe_source = source;
+  return LB_OK;
 }
@@ -0,0 +1,597 @@
+/**
+ * @file failsafe.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "errors.h"
+#include "failsafe.h"
+#include "throttle.h"
+
+/**
+ * @brief A comm source being watched. Armed sources sit in one slot of
+ * the timer wheel, in a list threaded through the sources themselves.
+ */
+struct lb_failsafe_source_t {
+  struct lb_failsafe_source_t *lbfs_next;
+  struct lb_failsafe_source_t *lbfs_prev;
+  uint64_t lbfs_timeout_ns;
+  uint64_t lbfs_last_feed_ns;
+  uint64_t lbfs_rounds;
+  unsigned int lbfs_slot;
+  bool lbfs_used;
+  bool lbfs_armed;
+  bool lbfs_expired;
+};
+
+struct lb_failsafe_t {
+  struct lb_throttle_t *lbf_throttle;
+  struct lb_failsafe_profile_t lbf_profile;
+
+  struct lb_failsafe_source_t lbf_sources[LB_FAILSAFE_MAX_SOURCES];
+  struct lb_failsafe_source_t *lbf_wheel[LB_FAILSAFE_WHEEL_SLOTS];
+  /** The last wheel tick processed. **/
+  uint64_t lbf_tick;
+  bool lbf_clock_started;
+
+  unsigned int lbf_expired_count;
+  bool lbf_tripped;
+  bool lbf_zeroed;
+  uint64_t lbf_loss_ns;
+  uint64_t lbf_trip_ns;
+  lb_power_t lbf_trip_power;
+  lb_power_t lbf_commanded;
+  struct lb_failsafe_metrics_t lbf_metrics;
+
+  bool lbf_running;
+  pthread_t lbf_thread;
+  pthread_mutex_t lbf_mutex;
+  pthread_cond_t lbf_cond;
+};
+
+/**
+ * @brief Read CLOCK_MONOTONIC in nanoseconds.
+ *
+ * @return The current time in nanoseconds.
+ */
+static uint64_t
+lb_failsafe_now_ns()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Take a source out of the wheel.
+ *
+ * @param failsafe The failsafe the source belongs to.
+ * @param source The source to unlink.
+ */
+static void
+lb_failsafe_unlink(struct lb_failsafe_t *failsafe,
+                   struct lb_failsafe_source_t *source)
+{
+  if (!source->lbfs_armed)
+    return;
+
+  if (source->lbfs_prev != NULL) {
+    source->lbfs_prev->lbfs_next = source->lbfs_next;
+  } else {
+    failsafe->lbf_wheel[source->lbfs_slot] = source->lbfs_next;
+  }
+
+  if (source->lbfs_next != NULL)
+    source->lbfs_next->lbfs_prev = source->lbfs_prev;
+
+  source->lbfs_next = NULL;
+  source->lbfs_prev = NULL;
+  source->lbfs_armed = false;
+}
+
+/**
+ * @brief Put a source in the wheel slot for its deadline.
+ *
+ * @param failsafe The failsafe the source belongs to.
+ * @param source The source to schedule.
+ */
+static void
+lb_failsafe_schedule(struct lb_failsafe_t *failsafe,
+                     struct lb_failsafe_source_t *source)
+{
+  uint64_t deadline;
+
+  lb_failsafe_unlink(failsafe, source);
+
+  /* Round up, a source is never lost before its timeout. */
+  deadline = (source->lbfs_last_feed_ns + source->lbfs_timeout_ns +
+              LB_FAILSAFE_TICK_NSEC - 1) / LB_FAILSAFE_TICK_NSEC;
+  if (deadline <= failsafe->lbf_tick)
+    deadline = failsafe->lbf_tick + 1;
+
+  source->lbfs_slot = (unsigned int)(deadline % LB_FAILSAFE_WHEEL_SLOTS);
+  source->lbfs_rounds = (deadline - failsafe->lbf_tick - 1) /
+      LB_FAILSAFE_WHEEL_SLOTS;
+
+  source->lbfs_prev = NULL;
+  source->lbfs_next = failsafe->lbf_wheel[source->lbfs_slot];
+  if (source->lbfs_next != NULL)
+    source->lbfs_next->lbfs_prev = source;
+  failsafe->lbf_wheel[source->lbfs_slot] = source;
+  source->lbfs_armed = true;
+}
+
+/**
+ * @brief Mark a source lost, tripping the failsafe if it wasn't already.
+ *
+ * @param failsafe The failsafe to trip.
+ * @param source The source that was lost.
+ * @param now_ns The time the loss was noticed.
+ */
+static void
+lb_failsafe_expire(struct lb_failsafe_t *failsafe,
+                   struct lb_failsafe_source_t *source, uint64_t now_ns)
+{
+  lb_power_t current;
+
+  lb_failsafe_unlink(failsafe, source);
+  source->lbfs_expired = true;
+  failsafe->lbf_expired_count++;
+
+  if (failsafe->lbf_tripped)
+    return;
+
+  failsafe->lbf_tripped = true;
+  failsafe->lbf_zeroed = false;
+  failsafe->lbf_loss_ns = source->lbfs_last_feed_ns;
+  failsafe->lbf_trip_ns = now_ns;
+
+  /*
+   * Start from where the board actually is. If it is still ramping up
+   * to its request, holding the request would keep it accelerating
+   * after the remote is gone.
+   */
+  failsafe->lbf_trip_power = LB_POWER_C(0);
+  if (failsafe->lbf_throttle != NULL) {
+    lb_throttle_request_get(failsafe->lbf_throttle,
+                            &(failsafe->lbf_trip_power));
+    if (lb_throttle_current_get(failsafe->lbf_throttle, &current) == LB_OK &&
+        current < failsafe->lbf_trip_power)
+      failsafe->lbf_trip_power = current;
+  }
+  if (failsafe->lbf_trip_power < LB_POWER_C(0))
+    failsafe->lbf_trip_power = LB_POWER_C(0);
+  failsafe->lbf_commanded = failsafe->lbf_trip_power;
+  if (failsafe->lbf_throttle != NULL)
+    lb_throttle_request_set(failsafe->lbf_throttle,
+                            failsafe->lbf_trip_power);
+
+  failsafe->lbf_metrics.lbfm_trips++;
+  failsafe->lbf_metrics.lbfm_loss_to_trip_ns = now_ns - failsafe->lbf_loss_ns;
+}
+
+/**
+ * @brief Bring the throttle down along the profile while tripped.
+ *
+ * @param failsafe The failsafe to apply.
+ * @param now_ns The current time.
+ */
+static void
+lb_failsafe_apply(struct lb_failsafe_t *failsafe, uint64_t now_ns)
+{
+  uint64_t elapsed_ns, hold_ns, loss_to_zero;
+  lb_power_t power, drop, current;
+  struct lb_failsafe_metrics_t *metrics = &(failsafe->lbf_metrics);
+
+  if (!failsafe->lbf_tripped || failsafe->lbf_zeroed ||
+      failsafe->lbf_throttle == NULL)
+    return;
+
+  elapsed_ns = now_ns - failsafe->lbf_trip_ns;
+  hold_ns = (uint64_t)failsafe->lbf_profile.lbfp_hold_ms * 1000000ULL;
+
+  power = failsafe->lbf_trip_power;
+  if (elapsed_ns > hold_ns) {
+    drop = lb_power_scale(failsafe->lbf_profile.lbfp_decel_per_sec,
+                          elapsed_ns - hold_ns, 1000000000ULL);
+    power = drop >= power ? LB_POWER_C(0) : power - drop;
+  }
+
+  if (power != failsafe->lbf_commanded) {
+    lb_throttle_request_set(failsafe->lbf_throttle, power);
+    failsafe->lbf_commanded = power;
+  }
+
+  if (failsafe->lbf_commanded != LB_POWER_C(0))
+    return;
+
+  /*
+   * Make sure the board actually got there, not just the request. The
+   * readback takes the throttle's lock, so a tick can't be half written.
+   */
+  if (lb_throttle_current_get(failsafe->lbf_throttle, &current) != LB_OK ||
+      current != LB_POWER_C(0))
+    return;
+
+  failsafe->lbf_zeroed = true;
+  loss_to_zero = now_ns - failsafe->lbf_loss_ns;
+  metrics->lbfm_loss_to_zero_ns = loss_to_zero;
+  if (loss_to_zero > metrics->lbfm_max_loss_to_zero_ns)
+    metrics->lbfm_max_loss_to_zero_ns = loss_to_zero;
+}
+
+/**
+ * @brief Create a failsafe that brings a throttle down when a comm
+ * source goes quiet.
+ *
+ * @param throttle The throttle to protect, or NULL to only watch the
+ * sources.
+ *
+ * @return A new failsafe, or NULL on failure.
+ */
+struct lb_failsafe_t *
+lb_failsafe_new(struct lb_throttle_t *throttle)
+{
+  struct lb_failsafe_t *failsafe;
+  pthread_condattr_t cond_attr;
+
+  failsafe = calloc(1, sizeof(struct lb_failsafe_t));
+  if (failsafe == NULL) {
+    return NULL;
+  }
+
+  failsafe->lbf_throttle = throttle;
+  failsafe->lbf_profile.lbfp_hold_ms = 0;
+  failsafe->lbf_profile.lbfp_decel_per_sec = LB_POWER_C(20.0);
+
+  pthread_mutex_init(&(failsafe->lbf_mutex), NULL);
+
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&(failsafe->lbf_cond), &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  return failsafe;
+}
+
+/**
+ * @brief Delete a failsafe, stopping it first if it is running.
+ *
+ * @param failsafe The failsafe to delete.
+ */
+void
+lb_failsafe_delete(struct lb_failsafe_t *failsafe)
+{
+  lb_failsafe_stop(failsafe);
+
+  pthread_cond_destroy(&(failsafe->lbf_cond));
+  pthread_mutex_destroy(&(failsafe->lbf_mutex));
+  free(failsafe);
+}
+
+/**
+ * @brief Set how the failsafe brings the throttle down.
+ *
+ * @param failsafe The failsafe to change.
+ * @param profile The profile to use from the next trip on.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_profile_set(struct lb_failsafe_t *failsafe,
+                        const struct lb_failsafe_profile_t *profile)
+{
+  if (profile->lbfp_decel_per_sec <= LB_POWER_C(0))
+    return LB_PARSE_ERROR;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  failsafe->lbf_profile = *profile;
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+  return LB_OK;
+}
+
+/**
+ * @brief Start watching a comm source. A source isn't watched until it
+ * is first fed, so a link that never came up doesn't trip the failsafe.
+ *
+ * @param failsafe The failsafe to add the source to.
+ * @param timeout_ms How long the source may go without a valid sample.
+ * @param out_source The id of the new source.
+ *
+ * @return A status code. LB_NOT_FOUND if there are no free sources.
+ */
+int
+lb_failsafe_source_add(struct lb_failsafe_t *failsafe,
+                       unsigned int timeout_ms, int *out_source)
+{
+  int rc = LB_NOT_FOUND, i;
+  struct lb_failsafe_source_t *source;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  for (i = 0; i < LB_FAILSAFE_MAX_SOURCES; i++) {
+    source = &(failsafe->lbf_sources[i]);
+    if (source->lbfs_used)
+      continue;
+
+    memset(source, 0, sizeof(struct lb_failsafe_source_t));
+    source->lbfs_used = true;
+    source->lbfs_timeout_ns = (uint64_t)timeout_ms * 1000000ULL;
+    *out_source = i;
+    rc = LB_OK;
+    break;
+  }
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+
+  return rc;
+}
+
+/**
+ * @brief Stop watching a comm source.
+ *
+ * @param failsafe The failsafe to remove the source from.
+ * @param source_id The id of the source.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_source_remove(struct lb_failsafe_t *failsafe, int source_id)
+{
+  struct lb_failsafe_source_t *source;
+
+  if (source_id < 0 || source_id >= LB_FAILSAFE_MAX_SOURCES)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  source = &(failsafe->lbf_sources[source_id]);
+  lb_failsafe_unlink(failsafe, source);
+  if (source->lbfs_expired) {
+    failsafe->lbf_expired_count--;
+    if (failsafe->lbf_expired_count == 0)
+      failsafe->lbf_tripped = false;
+  }
+  source->lbfs_used = false;
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+
+  return LB_OK;
+}
+
+/**
+ * @brief Record a valid sample from a source, now.
+ *
+ * @param failsafe The failsafe watching the source.
+ * @param source The id of the source.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_feed(struct lb_failsafe_t *failsafe, int source)
+{
+  return lb_failsafe_feed_at(failsafe, source, lb_failsafe_now_ns());
+}
+
+/**
+ * @brief Record a valid sample from a source at a given time. Along with
+ * lb_failsafe_advance() this drives the failsafe on a simulated clock.
+ *
+ * @param failsafe The failsafe watching the source.
+ * @param source_id The id of the source.
+ * @param now_ns The time of the sample on CLOCK_MONOTONIC.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_feed_at(struct lb_failsafe_t *failsafe, int source_id,
+                    uint64_t now_ns)
+{
+  int rc = LB_OK;
+  struct lb_failsafe_source_t *source;
+
+  if (source_id < 0 || source_id >= LB_FAILSAFE_MAX_SOURCES)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  source = &(failsafe->lbf_sources[source_id]);
+  if (!source->lbfs_used) {
+    rc = LB_NOT_FOUND;
+    goto out;
+  }
+
+  if (!failsafe->lbf_clock_started) {
+    failsafe->lbf_tick = now_ns / LB_FAILSAFE_TICK_NSEC;
+    failsafe->lbf_clock_started = true;
+  }
+
+  /* The link is back. Stop bringing the throttle down once all are. */
+  if (source->lbfs_expired) {
+    source->lbfs_expired = false;
+    failsafe->lbf_expired_count--;
+    if (failsafe->lbf_expired_count == 0)
+      failsafe->lbf_tripped = false;
+  }
+
+  source->lbfs_last_feed_ns = now_ns;
+  lb_failsafe_schedule(failsafe, source);
+
+out:
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+  return rc;
+}
+
+/**
+ * @brief Move the timer wheel up to a time, tripping on any deadline
+ * passed, and step the throttle down if tripped. Each wheel tick only
+ * looks at the sources in one slot.
+ *
+ * @param failsafe The failsafe to advance.
+ * @param now_ns The time to advance to on CLOCK_MONOTONIC.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_advance(struct lb_failsafe_t *failsafe, uint64_t now_ns)
+{
+  uint64_t now_tick;
+  struct lb_failsafe_source_t *source, *next;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+
+  if (!failsafe->lbf_clock_started)
+    goto out;
+
+  now_tick = now_ns / LB_FAILSAFE_TICK_NSEC;
+  while (failsafe->lbf_tick < now_tick) {
+    failsafe->lbf_tick++;
+
+    source = failsafe->lbf_wheel[failsafe->lbf_tick % LB_FAILSAFE_WHEEL_SLOTS];
+    for (; source != NULL; source = next) {
+      next = source->lbfs_next;
+      if (source->lbfs_rounds > 0) {
+        source->lbfs_rounds--;
+      } else {
+        lb_failsafe_expire(failsafe, source, now_ns);
+      }
+    }
+  }
+
+  lb_failsafe_apply(failsafe, now_ns);
+
+out:
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+  return LB_OK;
+}
+
+/**
+ * @brief Advance the failsafe every tick until it is stopped.
+ *
+ * @param ctx The failsafe to run.
+ *
+ * @return NULL
+ */
+static void *
+lb_failsafe_runner(void *ctx)
+{
+  struct lb_failsafe_t *failsafe = ctx;
+  struct timespec deadline;
+  uint64_t deadline_ns;
+  bool running = true;
+
+  deadline_ns = lb_failsafe_now_ns();
+
+  while (running) {
+    lb_failsafe_advance(failsafe, lb_failsafe_now_ns());
+
+    deadline_ns += LB_FAILSAFE_TICK_NSEC;
+    deadline.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+
+    pthread_mutex_lock(&(failsafe->lbf_mutex));
+    while (failsafe->lbf_running &&
+           pthread_cond_timedwait(&(failsafe->lbf_cond),
+                                  &(failsafe->lbf_mutex),
+                                  &deadline) != ETIMEDOUT)
+      ;
+    running = failsafe->lbf_running;
+    pthread_mutex_unlock(&(failsafe->lbf_mutex));
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Start checking deadlines on a thread of the failsafe's own.
+ *
+ * @param failsafe The failsafe to start.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_start(struct lb_failsafe_t *failsafe)
+{
+  int rc = LB_OK;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  if (failsafe->lbf_running) {
+    rc = LB_THROTTLE_ERROR;
+    goto out;
+  }
+
+  failsafe->lbf_running = true;
+  if (pthread_create(&(failsafe->lbf_thread), NULL, lb_failsafe_runner,
+                     failsafe) != 0) {
+    failsafe->lbf_running = false;
+    rc = LB_THROTTLE_ERROR;
+  }
+
+out:
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+  return rc;
+}
+
+/**
+ * @brief Stop the failsafe's thread.
+ *
+ * @param failsafe The failsafe to stop.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_stop(struct lb_failsafe_t *failsafe)
+{
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  if (!failsafe->lbf_running) {
+    pthread_mutex_unlock(&(failsafe->lbf_mutex));
+    return LB_THROTTLE_ERROR;
+  }
+  failsafe->lbf_running = false;
+  pthread_cond_broadcast(&(failsafe->lbf_cond));
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+
+  pthread_join(failsafe->lbf_thread, NULL);
+  return LB_OK;
+}
+
+/**
+ * @brief Check whether a source has been lost.
+ *
+ * @param failsafe The failsafe to check.
+ *
+ * @return True if the failsafe is tripped.
+ */
+bool
+lb_failsafe_is_tripped(struct lb_failsafe_t *failsafe)
+{
+  bool tripped;
+
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  tripped = failsafe->lbf_tripped;
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+
+  return tripped;
+}
+
+/**
+ * @brief Get the failsafe's timing metrics.
+ *
+ * @param failsafe The failsafe to check.
+ * @param out_metrics The metrics to fill in.
+ *
+ * @return A status code.
+ */
+int
+lb_failsafe_metrics_get(struct lb_failsafe_t *failsafe,
+                        struct lb_failsafe_metrics_t *out_metrics)
+{
+  pthread_mutex_lock(&(failsafe->lbf_mutex));
+  *out_metrics = failsafe->lbf_metrics;
+  pthread_mutex_unlock(&(failsafe->lbf_mutex));
+  return LB_OK;
+}
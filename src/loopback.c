@@ -0,0 +1,248 @@
+/**
+ * @file loopback.c
+ * @brief A comm backed by a local socket pair, standing in for a remote
+ * in tests and benchmarks.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "comm.h"
+#include "comm_internal.h"
+#include "errors.h"
+
+/**
+ * @brief Get the size of the storage a loopback comm needs.
+ *
+ * @return The size of a loopback comm in bytes.
+ */
+size_t
+lb_comm_loopback_sizeof()
+{
+  return sizeof(struct lb_comm_loopback_storage_t);
+}
+
+/**
+ * @brief Initialize a loopback comm in caller provided storage. The
+ * storage must be at least lb_comm_loopback_sizeof() bytes and aligned
+ * to lb_comm_alignof().
+ *
+ * @param storage The storage to initialize the comm in.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_loopback_init(struct lb_comm_t *storage)
+{
+  struct lb_comm_loopback_storage_t *lo_storage;
+  struct lb_comm_t *comm;
+  struct lb_comm_loopback_t *lo_comm;
+
+  lo_storage = (struct lb_comm_loopback_storage_t *)storage;
+  comm = &(lo_storage->lbcs_comm);
+  lo_comm = &(lo_storage->lbcs_loopback);
+
+  lo_comm->lbc_lo_fds[0] = -1;
+  lo_comm->lbc_lo_fds[1] = -1;
+  lo_comm->lbc_lo_uring.lbu_active = false;
+
+  lb_comm_init(comm, LB_COMM_LOOPBACK, lo_comm);
+  comm->lbc_deinit_func = lb_comm_loopback_deinit;
+  comm->lbc_open_func = lb_comm_loopback_open;
+  comm->lbc_close_func = lb_comm_loopback_close;
+  comm->lbc_read_func = lb_comm_loopback_read;
+  comm->lbc_write_func = lb_comm_loopback_write;
+
+  return LB_OK;
+}
+
+/**
+ * @brief Create a new loopback comm.
+ *
+ * @return A new comm object, or NULL on failure.
+ */
+struct lb_comm_t *
+lb_comm_loopback_new()
+{
+  struct lb_comm_t *comm;
+
+  comm = malloc(lb_comm_loopback_sizeof());
+  if (comm == NULL) {
+    return NULL;
+  }
+
+  lb_comm_loopback_init(comm);
+  return comm;
+}
+
+/**
+ * @brief Get the socket to write lines to, for the comm to read. The
+ * comm's telemetry can be read back from the same socket.
+ *
+ * @param comm The loopback comm.
+ *
+ * @return The writer socket, or -1 if the comm isn't open.
+ */
+int
+lb_comm_loopback_writer(struct lb_comm_t *comm)
+{
+  struct lb_comm_loopback_t *lo_comm = comm->lbc_ctx;
+  assert(comm->lbc_type == LB_COMM_LOOPBACK);
+
+  return lo_comm->lbc_lo_fds[1];
+}
+
+/**
+ * @brief Tear down a loopback comm, closing it if it is open. Doesn't
+ * free the storage.
+ *
+ * @param comm The comm to tear down.
+ */
+int
+lb_comm_loopback_deinit(struct lb_comm_t *comm)
+{
+  struct lb_comm_loopback_t *lo_comm = comm->lbc_ctx;
+  assert(comm->lbc_type == LB_COMM_LOOPBACK);
+
+  if (lo_comm->lbc_lo_fds[0] >= 0) {
+    lb_comm_loopback_close(comm);
+  }
+
+  return LB_OK;
+}
+
+/**
+ * @brief Open the socket pair. Reads time out the same as a bluetooth
+ * comm's.
+ *
+ * @param comm The comm object to open.
+ *
+ * @return A status code. LB_COMM_ERROR if the comm is already open.
+ */
+int
+lb_comm_loopback_open(struct lb_comm_t *comm)
+{
+  struct lb_comm_loopback_t *lo_comm;
+  struct timeval timeout;
+
+  assert(comm->lbc_type == LB_COMM_LOOPBACK);
+  lo_comm = comm->lbc_ctx;
+
+  if (lo_comm->lbc_lo_fds[0] >= 0) {
+    return LB_COMM_ERROR;
+  }
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, lo_comm->lbc_lo_fds) != 0) {
+    lo_comm->lbc_lo_fds[0] = -1;
+    lo_comm->lbc_lo_fds[1] = -1;
+    return LB_COMM_ERROR;
+  }
+
+  timeout.tv_usec = 0;
+  timeout.tv_sec = 2;
+  setsockopt(lo_comm->lbc_lo_fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout,
+             sizeof(struct timeval));
+
+  /* Read the same way a bluetooth comm does, so tests cover both. */
+  lb_uring_init(&(lo_comm->lbc_lo_uring), lo_comm->lbc_lo_fds[0]);
+
+  return LB_OK;
+}
+
+/**
+ * @brief Close the socket pair.
+ *
+ * @param comm The comm object to close.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_loopback_close(struct lb_comm_t *comm)
+{
+  struct lb_comm_loopback_t *lo_comm;
+
+  assert(comm->lbc_type == LB_COMM_LOOPBACK);
+  lo_comm = comm->lbc_ctx;
+
+  lb_uring_deinit(&(lo_comm->lbc_lo_uring));
+  close(lo_comm->lbc_lo_fds[0]);
+  close(lo_comm->lbc_lo_fds[1]);
+  lo_comm->lbc_lo_fds[0] = -1;
+  lo_comm->lbc_lo_fds[1] = -1;
+
+  return LB_OK;
+}
+
+/**
+ * @brief Read from the socket pair, through io_uring when the kernel
+ * supports it.
+ *
+ * @param comm The comm object to read.
+ * @param buf The buffer to read into.
+ * @param len The size of the buffer.
+ * @param out_len The number of bytes read.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_loopback_read(struct lb_comm_t *comm, char *buf, size_t len,
+                      size_t *out_len)
+{
+  struct lb_comm_loopback_t *lo_comm;
+
+  assert(comm->lbc_type == LB_COMM_LOOPBACK);
+  lo_comm = comm->lbc_ctx;
+
+  if (lo_comm->lbc_lo_fds[0] < 0) {
+    return LB_COMM_ERROR;
+  }
+
+  return lb_uring_read(&(lo_comm->lbc_lo_uring), lo_comm->lbc_lo_fds[0],
+                       buf, len, out_len);
+}
+
+/**
+ * @brief Write to the socket pair without blocking.
+ *
+ * @param comm The comm object to write.
+ * @param buf The bytes to write.
+ * @param len The number of bytes to write.
+ * @param out_len The number of bytes written.
+ *
+ * @return A status code. LB_RETRY if the socket is full.
+ */
+int
+lb_comm_loopback_write(struct lb_comm_t *comm, const char *buf, size_t len,
+                       size_t *out_len)
+{
+  ssize_t size_written;
+  struct lb_comm_loopback_t *lo_comm;
+
+  assert(comm->lbc_type == LB_COMM_LOOPBACK);
+  lo_comm = comm->lbc_ctx;
+
+  *out_len = 0;
+  if (lo_comm->lbc_lo_fds[0] < 0) {
+    return LB_COMM_ERROR;
+  }
+
+  size_written = send(lo_comm->lbc_lo_fds[0], buf, len,
+                      MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (size_written < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return LB_RETRY;
+    }
+    return LB_COMM_ERROR;
+  }
+
+  *out_len = (size_t)size_written;
+  return LB_OK;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file power.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "errors.h"
+#include "power.h"
+
+/**
+ * @brief Convert a float to a power level. Only needed where a library
+ * hands us a float, like reading back a duty cycle.
+ *
+ * @param value The value to convert.
+ *
+ * @return The power level.
+ */
+lb_power_t
+lb_power_from_float(float value)
+{
+#ifdef LB_FIXED_POINT
+  return (lb_power_t)(value * 65536.0f + (value >= 0 ? 0.5f : -0.5f));
+#else
+  return value;
+#endif
+}
+
+/**
+ * @brief Parse a decimal power level, like "42.5". Parsing stops at the
+ * first character that isn't part of the number.
+ *
+ * @param str The string to parse.
+ * @param out_power The power level parsed.
+ *
+ * @return A status code.
+ */
+int
+lb_power_parse(const char *str, lb_power_t *out_power)
+{
+  return lb_power_parse_end(str, out_power, NULL);
+}
+
+/**
+ * @brief Parse a decimal power level, and find where it ends so callers
+ * can check what follows it.
+ *
+ * @param str The string to parse.
+ * @param out_power The power level parsed.
+ * @param out_end The first character after the number, or NULL.
+ *
+ * @return A status code.
+ */
+int
+lb_power_parse_end(const char *str, lb_power_t *out_power,
+                   const char **out_end)
+{
+#ifdef LB_FIXED_POINT
+  bool negative = false, digits = false;
+  int32_t whole = 0;
+  uint32_t frac = 0, frac_scale = 1;
+
+  while (isspace((unsigned char)*str))
+    str++;
+
+  if (*str == '-' || *str == '+') {
+    negative = *str == '-';
+    str++;
+  }
+
+  for (; isdigit((unsigned char)*str); str++) {
+    whole = whole * 10 + (*str - '0');
+    if (whole > INT16_MAX) {
+      return LB_PARSE_ERROR;
+    }
+    digits = true;
+  }
+
+  if (*str == '.') {
+    str++;
+    for (; isdigit((unsigned char)*str); str++) {
+      /* Past 6 digits the extra precision can't show up in Q16.16. */
+      if (frac_scale < 1000000) {
+        frac = frac * 10 + (uint32_t)(*str - '0');
+        frac_scale *= 10;
+      }
+      digits = true;
+    }
+  }
+
+  if (!digits) {
+    return LB_PARSE_ERROR;
+  }
+
+  if (out_end != NULL) {
+    *out_end = str;
+  }
+
+  *out_power = (lb_power_t)(((uint32_t)whole << LB_POWER_FRAC_BITS) +
+      (uint32_t)((((uint64_t)frac << LB_POWER_FRAC_BITS) + frac_scale / 2) /
+                 frac_scale));
+  if (negative) {
+    *out_power = -*out_power;
+  }
+  return LB_OK;
+#else
+  char *end;
+  float value;
+
+  value = strtof(str, &end);
+  if (end == str) {
+    return LB_PARSE_ERROR;
+  }
+
+  if (out_end != NULL) {
+    *out_end = end;
+  }
+
+  *out_power = value;
+  return LB_OK;
+#endif
+}
+
+/**
+ * @brief Multiply two power levels, where 1.0 is one.
+ *
+ * @param a The first power level.
+ * @param b The second power level.
+ *
+ * @return The product.
+ */
+lb_power_t
+lb_power_mul(lb_power_t a, lb_power_t b)
+{
+#ifdef LB_FIXED_POINT
+  return (lb_power_t)(((int64_t)a * (int64_t)b) >> LB_POWER_FRAC_BITS);
+#else
+  return a * b;
+#endif
+}
+
+/**
+ * @brief Divide one power level by another, where 1.0 is one.
+ *
+ * @param a The dividend.
+ * @param b The divisor. Must not be zero.
+ *
+ * @return The quotient.
+ */
+lb_power_t
+lb_power_div(lb_power_t a, lb_power_t b)
+{
+#ifdef LB_FIXED_POINT
+  return (lb_power_t)(((int64_t)a * (1 << LB_POWER_FRAC_BITS)) / b);
+#else
+  return a / b;
+#endif
+}
+
+/**
+ * @brief Scale a power level by a ratio, num / den.
+ *
+ * @param power The power level to scale.
+ * @param num The numerator of the ratio.
+ * @param den The denominator of the ratio. Must not be zero.
+ *
+ * @return The scaled power level.
+ */
+lb_power_t
+lb_power_scale(lb_power_t power, uint64_t num, uint64_t den)
+{
+#ifdef LB_FIXED_POINT
+  return (lb_power_t)(((int64_t)power * (int64_t)num) / (int64_t)den);
+#else
+  return (lb_power_t)((double)power * (double)num / (double)den);
+#endif
+}
@@ -0,0 +1,370 @@
+/**
+ * @file profile.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "errors.h"
+#include "profile.h"
+#include "profile_internal.h"
+#include "throttle_internal.h"
+
+static const char *lb_profile_phase_names[LB_PROFILE_PHASES] = {
+  [LB_PROFILE_LOCK_WAIT] = "lock_wait",
+  [LB_PROFILE_RAMP] = "ramp",
+  [LB_PROFILE_WRITE_LEFT] = "write_left",
+  [LB_PROFILE_WRITE_RIGHT] = "write_right",
+  [LB_PROFILE_SLEEP_OVERSHOOT] = "sleep_overshoot",
+};
+
+/**
+ * @brief Read a clock in nanoseconds.
+ *
+ * @param clock The clock to read.
+ *
+ * @return The time on the clock in nanoseconds.
+ */
+static uint64_t
+lb_profile_now_ns(clockid_t clock)
+{
+  struct timespec now;
+
+  clock_gettime(clock, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Start a CPU window on the calling thread.
+ *
+ * @param window The window to start.
+ * @param now_ns The current CLOCK_MONOTONIC time.
+ */
+void
+lb_cpu_window_start(struct lb_cpu_window_t *window, uint64_t now_ns)
+{
+  window->lbcw_start_ns = now_ns;
+  window->lbcw_start_cpu_ns = lb_profile_now_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+/**
+ * @brief Get the wall and CPU time since a window started. Call from
+ * the thread that started it.
+ *
+ * @param window The window to measure.
+ * @param now_ns The current CLOCK_MONOTONIC time.
+ * @param out_wall_ns The wall time the window covers.
+ * @param out_cpu_ns The CPU time the thread used in the window.
+ */
+void
+lb_cpu_window_elapsed(const struct lb_cpu_window_t *window, uint64_t now_ns,
+                      uint64_t *out_wall_ns, uint64_t *out_cpu_ns)
+{
+  *out_wall_ns = now_ns - window->lbcw_start_ns;
+  *out_cpu_ns = lb_profile_now_ns(CLOCK_THREAD_CPUTIME_ID) -
+      window->lbcw_start_cpu_ns;
+}
+
+/**
+ * @brief Check whether the profiler is recording. This is read on every
+ * tick, so it doesn't take a lock.
+ *
+ * @param profile The profiler to check.
+ *
+ * @return True if the profiler is recording.
+ */
+static bool
+lb_profile_enabled(struct lb_profile_t *profile)
+{
+  return __atomic_load_n(&(profile->lbpf_enabled), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Start a new open window.
+ *
+ * @param profile The profiler to start the window in.
+ * @param now_ns The current CLOCK_MONOTONIC time.
+ */
+static void
+lb_profile_window_start(struct lb_profile_t *profile, uint64_t now_ns)
+{
+  struct rusage usage;
+
+  memset(&(profile->lbpf_open), 0, sizeof(profile->lbpf_open));
+  lb_cpu_window_start(&(profile->lbpf_open_window), now_ns);
+
+  getrusage(RUSAGE_THREAD, &usage);
+  profile->lbpf_open_voluntary_csw = (uint64_t)usage.ru_nvcsw;
+  profile->lbpf_open_involuntary_csw = (uint64_t)usage.ru_nivcsw;
+  profile->lbpf_open_started = true;
+}
+
+/**
+ * @brief Close the open window and copy it into the ring.
+ *
+ * @param profile The profiler to close the window in.
+ * @param now_ns The current CLOCK_MONOTONIC time.
+ */
+static void
+lb_profile_window_close(struct lb_profile_t *profile, uint64_t now_ns)
+{
+  struct rusage usage;
+  struct lb_profile_report_t *open = &(profile->lbpf_open);
+
+  getrusage(RUSAGE_THREAD, &usage);
+
+  lb_cpu_window_elapsed(&(profile->lbpf_open_window), now_ns,
+                        &(open->lbpr_wall_ns), &(open->lbpr_cpu_ns));
+  open->lbpr_voluntary_csw = (uint64_t)usage.ru_nvcsw -
+      profile->lbpf_open_voluntary_csw;
+  open->lbpr_involuntary_csw = (uint64_t)usage.ru_nivcsw -
+      profile->lbpf_open_involuntary_csw;
+
+  pthread_mutex_lock(&(profile->lbpf_mutex));
+  profile->lbpf_ring[profile->lbpf_ring_next] = *open;
+  profile->lbpf_ring_next = (profile->lbpf_ring_next + 1) % LB_PROFILE_WINDOWS;
+  if (profile->lbpf_ring_count < LB_PROFILE_WINDOWS)
+    profile->lbpf_ring_count++;
+  pthread_mutex_unlock(&(profile->lbpf_mutex));
+}
+
+/**
+ * @brief Initialize a profiler. Profilers start disabled.
+ *
+ * @param profile The profiler to initialize.
+ */
+void
+lb_profile_init(struct lb_profile_t *profile)
+{
+  memset(profile, 0, sizeof(struct lb_profile_t));
+  pthread_mutex_init(&(profile->lbpf_mutex), NULL);
+}
+
+/**
+ * @brief Deinitialize a profiler.
+ *
+ * @param profile The profiler to deinitialize.
+ */
+void
+lb_profile_deinit(struct lb_profile_t *profile)
+{
+  pthread_mutex_destroy(&(profile->lbpf_mutex));
+}
+
+/**
+ * @brief Turn recording on or off. Turning it on clears the windows
+ * already recorded.
+ *
+ * @param profile The profiler to change.
+ * @param enable Whether to record.
+ */
+void
+lb_profile_set_enabled(struct lb_profile_t *profile, bool enable)
+{
+  if (enable) {
+    pthread_mutex_lock(&(profile->lbpf_mutex));
+    profile->lbpf_ring_next = 0;
+    profile->lbpf_ring_count = 0;
+    pthread_mutex_unlock(&(profile->lbpf_mutex));
+  }
+
+  __atomic_store_n(&(profile->lbpf_enabled), enable, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Get the start time of a phase.
+ *
+ * @param profile The profiler to record in.
+ *
+ * @return The current time, or 0 if the profiler isn't recording.
+ */
+uint64_t
+lb_profile_start(struct lb_profile_t *profile)
+{
+  if (!lb_profile_enabled(profile))
+    return 0;
+
+  return lb_profile_now_ns(CLOCK_MONOTONIC);
+}
+
+/**
+ * @brief Record a phase that started at start_ns and ends now.
+ *
+ * @param profile The profiler to record in.
+ * @param phase The phase that ended.
+ * @param start_ns The time from lb_profile_start().
+ */
+void
+lb_profile_record(struct lb_profile_t *profile,
+                  enum lb_profile_phase_t phase, uint64_t start_ns)
+{
+  if (start_ns == 0)
+    return;
+
+  lb_profile_record_ns(profile, phase,
+                       lb_profile_now_ns(CLOCK_MONOTONIC) - start_ns);
+}
+
+/**
+ * @brief Record a phase that lasted some number of nanoseconds.
+ *
+ * @param profile The profiler to record in.
+ * @param phase The phase to record.
+ * @param ns How long the phase lasted.
+ */
+void
+lb_profile_record_ns(struct lb_profile_t *profile,
+                     enum lb_profile_phase_t phase, uint64_t ns)
+{
+  struct lb_profile_phase_stats_t *stats;
+
+  if (!profile->lbpf_open_started || !lb_profile_enabled(profile))
+    return;
+
+  stats = &(profile->lbpf_open.lbpr_phases[phase]);
+  stats->lbps_count++;
+  stats->lbps_total_ns += ns;
+  if (ns > stats->lbps_max_ns)
+    stats->lbps_max_ns = ns;
+}
+
+/**
+ * @brief Count a tick, and roll the open window over once it has
+ * covered LB_PROFILE_WINDOW_NSEC.
+ *
+ * @param profile The profiler to record in.
+ */
+void
+lb_profile_tick_end(struct lb_profile_t *profile)
+{
+  uint64_t now_ns;
+
+  if (!lb_profile_enabled(profile)) {
+    profile->lbpf_open_started = false;
+    return;
+  }
+
+  now_ns = lb_profile_now_ns(CLOCK_MONOTONIC);
+  if (!profile->lbpf_open_started) {
+    lb_profile_window_start(profile, now_ns);
+    return;
+  }
+
+  profile->lbpf_open.lbpr_ticks++;
+
+  if (now_ns - profile->lbpf_open_window.lbcw_start_ns >=
+      LB_PROFILE_WINDOW_NSEC) {
+    lb_profile_window_close(profile, now_ns);
+    lb_profile_window_start(profile, now_ns);
+  }
+}
+
+/**
+ * @brief Get the name of a phase.
+ *
+ * @param phase The phase to name.
+ *
+ * @return The name of the phase, or NULL if it isn't a phase.
+ */
+const char *
+lb_profile_phase_name(enum lb_profile_phase_t phase)
+{
+  if ((unsigned int)phase >= LB_PROFILE_PHASES)
+    return NULL;
+
+  return lb_profile_phase_names[phase];
+}
+
+/**
+ * @brief Turn the tick profiler on or off.
+ *
+ * @param throttle The throttle to profile.
+ * @param enable Whether to profile.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_profile_enable(struct lb_throttle_t *throttle, bool enable)
+{
+  lb_profile_set_enabled(&(throttle->lbt_profile), enable);
+  return LB_OK;
+}
+
+/**
+ * @brief Get a completed profile window.
+ *
+ * @param throttle The throttle to get the profile of.
+ * @param age Which window to get, 0 is the most recent.
+ * @param out_report The report to fill in.
+ *
+ * @return A status code. LB_NOT_FOUND if there is no window that old.
+ */
+int
+lb_throttle_profile_get(struct lb_throttle_t *throttle, unsigned int age,
+                        struct lb_profile_report_t *out_report)
+{
+  int rc = LB_OK;
+  unsigned int index;
+  struct lb_profile_t *profile = &(throttle->lbt_profile);
+
+  pthread_mutex_lock(&(profile->lbpf_mutex));
+  if (age >= profile->lbpf_ring_count) {
+    rc = LB_NOT_FOUND;
+    goto out;
+  }
+
+  index = (profile->lbpf_ring_next + LB_PROFILE_WINDOWS - 1 - age) %
+      LB_PROFILE_WINDOWS;
+  *out_report = profile->lbpf_ring[index];
+
+out:
+  pthread_mutex_unlock(&(profile->lbpf_mutex));
+  return rc;
+}
+
+/**
+ * @brief Write every completed profile window to a file, newest first.
+ *
+ * @param throttle The throttle to dump the profile of.
+ * @param file The file to write to.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_profile_dump(struct lb_throttle_t *throttle, FILE *file)
+{
+  unsigned int age;
+  int phase;
+  struct lb_profile_report_t report;
+  struct lb_profile_phase_stats_t *stats;
+
+  for (age = 0;
+       lb_throttle_profile_get(throttle, age, &report) == LB_OK;
+       age++) {
+    fprintf(file, "window -%u: wall %" PRIu64 " us, cpu %" PRIu64
+            " us, ticks %" PRIu64 ", csw %" PRIu64 "/%" PRIu64 "\n",
+            age, report.lbpr_wall_ns / 1000, report.lbpr_cpu_ns / 1000,
+            report.lbpr_ticks, report.lbpr_voluntary_csw,
+            report.lbpr_involuntary_csw);
+
+    for (phase = 0; phase < LB_PROFILE_PHASES; phase++) {
+      stats = &(report.lbpr_phases[phase]);
+      fprintf(file, "  %-16s n %-8" PRIu64 " avg %-10" PRIu64
+              " max %" PRIu64 " ns\n",
+              lb_profile_phase_names[phase], stats->lbps_count,
+              stats->lbps_count ? stats->lbps_total_ns / stats->lbps_count
+                                : 0,
+              stats->lbps_max_ns);
+    }
+  }
+
+  return LB_OK;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file pwm_index.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <string.h>
+
+#include <libusp/pwm.h>
+
+#include "errors.h"
+#include "pwm_index.h"
+
+/**
+ * @brief Hash a pwm name with FNV-1a.
+ *
+ * @param name The name to hash.
+ *
+ * @return The hash of the name.
+ */
+static uint32_t
+lb_pwm_index_hash(const char *name)
+{
+  uint32_t hash = 2166136261u;
+
+  for (; *name != '\0'; name++) {
+    hash ^= (uint8_t)*name;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/**
+ * @brief Walk the controller's pwms once and index them by name. Each
+ * indexed pwm holds a reference until the index is cleared.
+ *
+ * @param index The index to build.
+ * @param controller The controller to get the pwms from.
+ *
+ * @return A status code.
+ */
+int
+lb_pwm_index_build(struct lb_pwm_index_t *index,
+                   struct usp_controller_t *controller)
+{
+  int rc = LB_OK;
+  struct usp_pwm_list_t *pwm_list;
+  struct usp_pwm_list_entry_t *pwm_entry;
+
+  lb_pwm_index_clear(index);
+
+  pwm_list = usp_controller_get_pwms(controller);
+  if (pwm_list == NULL) {
+    return LB_NOT_FOUND;
+  }
+
+  usp_pwm_list_foreach(pwm_list, pwm_entry)
+  {
+    struct usp_pwm_t *pwm;
+    uint32_t hash, slot;
+
+    if (index->lbpi_count == LB_PWM_INDEX_SLOTS) {
+      /* Keep what fits, lookups for the rest will miss. */
+      rc = LB_NOT_FOUND;
+      break;
+    }
+
+    pwm = usp_pwm_list_entry_get_pwm(pwm_entry);
+    hash = lb_pwm_index_hash(usp_pwm_get_name(pwm));
+
+    /* Open addressing, the table is never full here. */
+    slot = hash & (LB_PWM_INDEX_SLOTS - 1);
+    while (index->lbpi_entries[slot].lbpe_pwm != NULL) {
+      slot = (slot + 1) & (LB_PWM_INDEX_SLOTS - 1);
+    }
+
+    usp_pwm_ref(pwm);
+    index->lbpi_entries[slot].lbpe_hash = hash;
+    index->lbpi_entries[slot].lbpe_name = usp_pwm_get_name(pwm);
+    index->lbpi_entries[slot].lbpe_pwm = pwm;
+    index->lbpi_count++;
+  }
+  usp_pwm_list_unref(pwm_list);
+
+  index->lbpi_built = true;
+  return rc;
+}
+
+/**
+ * @brief Drop every pwm in the index.
+ *
+ * @param index The index to clear.
+ */
+void
+lb_pwm_index_clear(struct lb_pwm_index_t *index)
+{
+  size_t i;
+
+  for (i = 0; i < LB_PWM_INDEX_SLOTS; i++) {
+    if (index->lbpi_entries[i].lbpe_pwm != NULL) {
+      usp_pwm_unref(index->lbpi_entries[i].lbpe_pwm);
+    }
+  }
+
+  memset(index, 0, sizeof(struct lb_pwm_index_t));
+}
+
+/**
+ * @brief Find a pwm by name.
+ *
+ * @param index The index to search.
+ * @param name The name of the pwm.
+ *
+ * @return The pwm, or NULL if it isn't indexed. The caller must take its
+ * own reference to keep it.
+ */
+struct usp_pwm_t *
+lb_pwm_index_find(struct lb_pwm_index_t *index, const char *name)
+{
+  uint32_t hash, slot;
+  size_t probes;
+  struct lb_pwm_index_entry_t *entry;
+
+  hash = lb_pwm_index_hash(name);
+  slot = hash & (LB_PWM_INDEX_SLOTS - 1);
+
+  for (probes = 0; probes < LB_PWM_INDEX_SLOTS; probes++) {
+    entry = &(index->lbpi_entries[slot]);
+    if (entry->lbpe_pwm == NULL) {
+      break;
+    }
+
+    if (entry->lbpe_hash == hash && strcmp(entry->lbpe_name, name) == 0) {
+      return entry->lbpe_pwm;
+    }
+
+    slot = (slot + 1) & (LB_PWM_INDEX_SLOTS - 1);
+  }
+
+  return NULL;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file pwm_usp.c
+ * @brief The libusp pwm backend.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <libusp/pwm.h>
+
+#include <errno.h>
+
+#include "errors.h"
+#include "pwm_index.h"
+#include "throttle_internal.h"
+
+/**
+ * @brief Look up the throttle's pwms by name.
+ *
+ * @param throttle The throttle to find the pwms of.
+ *
+ * @return A status code.
+ */
+static int
+lb_pwm_usp_open(struct lb_throttle_t *throttle)
+{
+  int i;
+  bool reindexed = false;
+  struct usp_pwm_t *pwm;
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    if (throttle->lbt_pwms[i] != NULL) {
+      continue;
+    }
+
+    pwm = lb_pwm_index_find(&(throttle->lbt_pwm_index),
+                            throttle->lbt_pwm_names[i]);
+    if (pwm == NULL && !reindexed) {
+      /* The pwm may have shown up since we last looked. */
+      lb_pwm_index_build(&(throttle->lbt_pwm_index),
+                         throttle->lbt_pwm_controller);
+      reindexed = true;
+      pwm = lb_pwm_index_find(&(throttle->lbt_pwm_index),
+                              throttle->lbt_pwm_names[i]);
+    }
+
+    if (pwm == NULL) {
+      return LB_NOT_FOUND;
+    }
+
+    usp_pwm_ref(pwm);
+    throttle->lbt_pwms[i] = pwm;
+  }
+
+  return LB_OK;
+}
+
+/**
+ * @brief Drop the throttle's pwms and its controller.
+ *
+ * @param throttle The throttle to tear down the pwms of.
+ *
+ * @return A status code.
+ */
+static int
+lb_pwm_usp_deinit(struct lb_throttle_t *throttle)
+{
+  int i;
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    if(throttle->lbt_pwms[i] != NULL)
+      usp_pwm_unref(throttle->lbt_pwms[i]);
+  }
+
+  lb_pwm_index_clear(&(throttle->lbt_pwm_index));
+  usp_controller_delete(throttle->lbt_pwm_controller);
+
+  return LB_OK;
+}
+
+static int
+lb_pwm_usp_enable(struct lb_throttle_t *throttle, int channel)
+{
+  if (usp_pwm_enable(throttle->lbt_pwms[channel]) != USP_OK) {
+    return LB_PWM_ERROR;
+  }
+  return LB_OK;
+}
+
+static int
+lb_pwm_usp_disable(struct lb_throttle_t *throttle, int channel)
+{
+  if (usp_pwm_disable(throttle->lbt_pwms[channel]) != USP_OK) {
+    return LB_PWM_ERROR;
+  }
+  return LB_OK;
+}
+
+static int
+lb_pwm_usp_set(struct lb_throttle_t *throttle, int channel, lb_power_t duty)
+{
+  errno = 0;
+
+  /* libusp only takes floats, convert at the last moment. */
+  if (usp_pwm_set_duty_cycle(throttle->lbt_pwms[channel],
+                             LB_POWER_TO_FLOAT(duty)) != USP_OK) {
+    /* A busy or interrupted sysfs write is worth another try. */
+    if (errno == EAGAIN || errno == EBUSY || errno == EINTR) {
+      return LB_RETRY;
+    }
+    return LB_PWM_ERROR;
+  }
+  return LB_OK;
+}
+
+static int
+lb_pwm_usp_get(struct lb_throttle_t *throttle, int channel,
+               lb_power_t *out_duty)
+{
+  float duty = 0.0f;
+
+  if (usp_pwm_get_duty_cycle(throttle->lbt_pwms[channel], &duty) != USP_OK) {
+    return LB_PWM_ERROR;
+  }
+
+  *out_duty = LB_POWER_FROM_FLOAT(duty);
+  return LB_OK;
+}
+
+const struct lb_pwm_ops_t lb_pwm_usp_ops = {
+  .lbp_open_func = lb_pwm_usp_open,
+  .lbp_deinit_func = lb_pwm_usp_deinit,
+  .lbp_enable_func = lb_pwm_usp_enable,
+  .lbp_disable_func = lb_pwm_usp_disable,
+  .lbp_set_func = lb_pwm_usp_set,
+  .lbp_get_func = lb_pwm_usp_get,
+};
@@ -0,0 +1,364 @@
+/**
+ * @file sim.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "sim.h"
+#include "throttle_internal.h"
+
+#define LB_SIM_GRAVITY 9.81
+#define LB_SIM_AIR_DENSITY 1.225
+
+struct lb_sim_t {
+  struct lb_sim_params_t lbs_params;
+  struct lb_sim_state_t lbs_state;
+
+  /** What the throttle asked for. **/
+  bool lbs_enabled[LB_THROTTLE_CHANNELS];
+  lb_power_t lbs_duty[LB_THROTTLE_CHANNELS];
+
+  /** What the ESCs are actually doing, from 0 to 1. **/
+  double lbs_esc_duty[LB_THROTTLE_CHANNELS];
+
+  pthread_mutex_t lbs_mutex;
+};
+
+/**
+ * @brief Fill in parameters for a typical board: a 10s battery, two
+ * belt driven motors and a 75kg rider.
+ *
+ * @param params The parameters to fill in.
+ */
+void
+lb_sim_params_default(struct lb_sim_params_t *params)
+{
+  params->lbsp_esc_tau = 0.05;
+
+  params->lbsp_motor_resistance = 0.05;
+  params->lbsp_motor_kt = 0.05;
+  params->lbsp_motor_max_current = 30.0;
+
+  params->lbsp_gear_ratio = 2.2;
+  params->lbsp_wheel_radius = 0.045;
+
+  params->lbsp_mass = 85.0;
+  params->lbsp_grade = 0.0;
+  params->lbsp_rolling_coeff = 0.015;
+  params->lbsp_drag_area = 0.5;
+
+  params->lbsp_battery_voltage = 42.0;
+  params->lbsp_battery_empty_voltage = 33.0;
+  params->lbsp_battery_resistance = 0.15;
+  params->lbsp_battery_capacity = 10.0;
+
+  params->lbsp_step = 0.001;
+}
+
+/**
+ * @brief Check parameters can be simulated. Everything the physics
+ * divides by must be positive, and the step must be, or stepping would
+ * never finish.
+ *
+ * @param params The parameters to check.
+ *
+ * @return True if the parameters are usable.
+ */
+static bool
+lb_sim_params_valid(const struct lb_sim_params_t *params)
+{
+  const double values[] = {
+    params->lbsp_esc_tau, params->lbsp_motor_resistance,
+    params->lbsp_motor_kt, params->lbsp_motor_max_current,
+    params->lbsp_gear_ratio, params->lbsp_wheel_radius, params->lbsp_mass,
+    params->lbsp_grade, params->lbsp_rolling_coeff, params->lbsp_drag_area,
+    params->lbsp_battery_voltage, params->lbsp_battery_empty_voltage,
+    params->lbsp_battery_resistance, params->lbsp_battery_capacity,
+    params->lbsp_step,
+  };
+  size_t i;
+
+  for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    if (!isfinite(values[i])) {
+      return false;
+    }
+  }
+
+  return params->lbsp_step > 0.0 && params->lbsp_esc_tau > 0.0 &&
+    params->lbsp_motor_resistance > 0.0 && params->lbsp_wheel_radius > 0.0 &&
+    params->lbsp_mass > 0.0 && params->lbsp_battery_capacity > 0.0;
+}
+
+/**
+ * @brief Create a new simulated board, at rest with a full battery.
+ *
+ * @param params The physical parameters of the board.
+ *
+ * @return A new simulator, or NULL on failure or invalid parameters.
+ */
+struct lb_sim_t *
+lb_sim_new(const struct lb_sim_params_t *params)
+{
+  struct lb_sim_t *sim;
+
+  if (!lb_sim_params_valid(params)) {
+    return NULL;
+  }
+
+  sim = calloc(sizeof(struct lb_sim_t), 1);
+  if (sim == NULL) {
+    return NULL;
+  }
+
+  sim->lbs_params = *params;
+  pthread_mutex_init(&(sim->lbs_mutex), NULL);
+  lb_sim_reset(sim);
+
+  return sim;
+}
+
+/**
+ * @brief Delete a simulator. Delete any throttle driving it first.
+ *
+ * @param sim The simulator to delete.
+ */
+void
+lb_sim_delete(struct lb_sim_t *sim)
+{
+  pthread_mutex_destroy(&(sim->lbs_mutex));
+  free(sim);
+}
+
+/**
+ * @brief Put the board back at rest with a full battery. The duty
+ * cycles the throttle last set are kept.
+ *
+ * @param sim The simulator to reset.
+ */
+void
+lb_sim_reset(struct lb_sim_t *sim)
+{
+  int i;
+
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  memset(&(sim->lbs_state), 0, sizeof(struct lb_sim_state_t));
+  sim->lbs_state.lbss_voltage = sim->lbs_params.lbsp_battery_voltage;
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    sim->lbs_esc_duty[i] = 0.0;
+  }
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+}
+
+/**
+ * @brief Advance the physics by one small step.
+ *
+ * @param sim The simulator to advance.
+ * @param dt The step in seconds.
+ */
+static void
+lb_sim_integrate(struct lb_sim_t *sim, double dt)
+{
+  int i;
+  double soc, open_voltage, omega, back_emf, target, motor_current;
+  double force = 0.0, battery_current = 0.0, resist, accel, theta;
+  const struct lb_sim_params_t *p = &(sim->lbs_params);
+  struct lb_sim_state_t *s = &(sim->lbs_state);
+
+  soc = 1.0 - s->lbss_charge_used / p->lbsp_battery_capacity;
+  soc = soc < 0.0 ? 0.0 : soc;
+  open_voltage = p->lbsp_battery_empty_voltage +
+    (p->lbsp_battery_voltage - p->lbsp_battery_empty_voltage) * soc;
+
+  omega = s->lbss_speed / p->lbsp_wheel_radius * p->lbsp_gear_ratio;
+  back_emf = p->lbsp_motor_kt * omega;
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    target = sim->lbs_enabled[i] ? LB_POWER_TO_FLOAT(sim->lbs_duty[i]) / 100.0
+                                 : 0.0;
+    target = target < 0.0 ? 0.0 : (target > 1.0 ? 1.0 : target);
+    sim->lbs_esc_duty[i] += (target - sim->lbs_esc_duty[i]) *
+      fmin(1.0, dt / p->lbsp_esc_tau);
+
+    /* Sag lags a step behind, which is plenty at millisecond steps. */
+    motor_current = (sim->lbs_esc_duty[i] * s->lbss_voltage - back_emf) /
+      p->lbsp_motor_resistance;
+    motor_current = fmax(0.0, fmin(motor_current, p->lbsp_motor_max_current));
+
+    force += p->lbsp_motor_kt * motor_current * p->lbsp_gear_ratio /
+      p->lbsp_wheel_radius;
+    battery_current += motor_current * sim->lbs_esc_duty[i];
+  }
+
+  s->lbss_current = battery_current;
+  s->lbss_voltage = open_voltage - battery_current * p->lbsp_battery_resistance;
+  if (battery_current > s->lbss_peak_current) {
+    s->lbss_peak_current = battery_current;
+  }
+
+  theta = atan(p->lbsp_grade);
+  resist = p->lbsp_mass * LB_SIM_GRAVITY * sin(theta) +
+    0.5 * LB_SIM_AIR_DENSITY * p->lbsp_drag_area * s->lbss_speed *
+    s->lbss_speed;
+  if (s->lbss_speed > 0.0 || force > 0.0) {
+    resist += p->lbsp_rolling_coeff * p->lbsp_mass * LB_SIM_GRAVITY *
+      cos(theta);
+  }
+
+  accel = (force - resist) / p->lbsp_mass;
+  s->lbss_speed += accel * dt;
+  if (s->lbss_speed < 0.0) {
+    /* The rider puts a foot down rather than roll backwards. */
+    s->lbss_speed = 0.0;
+  }
+
+  s->lbss_distance += s->lbss_speed * dt;
+  s->lbss_charge_used += battery_current * dt / 3600.0;
+}
+
+/**
+ * @brief Advance the simulation. This runs as fast as the host can go,
+ * so a whole ride takes a fraction of a second.
+ *
+ * @param sim The simulator to advance.
+ * @param nsec The simulated time to advance by, in nanoseconds.
+ */
+void
+lb_sim_step(struct lb_sim_t *sim, uint64_t nsec)
+{
+  double remaining, dt;
+
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  remaining = (double)nsec * 1e-9;
+  while (remaining > 0.0) {
+    dt = fmin(sim->lbs_params.lbsp_step, remaining);
+    lb_sim_integrate(sim, dt);
+    remaining -= dt;
+  }
+  sim->lbs_state.lbss_time_ns += nsec;
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+}
+
+/**
+ * @brief Get the simulated state of the board.
+ *
+ * @param sim The simulator.
+ * @param out_state The state of the board.
+ */
+void
+lb_sim_state_get(struct lb_sim_t *sim, struct lb_sim_state_t *out_state)
+{
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  *out_state = sim->lbs_state;
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+}
+
+static int
+lb_pwm_sim_open(struct lb_throttle_t *throttle)
+{
+  (void)throttle;
+  return LB_OK;
+}
+
+static int
+lb_pwm_sim_deinit(struct lb_throttle_t *throttle)
+{
+  /* The caller owns the simulator. */
+  (void)throttle;
+  return LB_OK;
+}
+
+static int
+lb_pwm_sim_enable(struct lb_throttle_t *throttle, int channel)
+{
+  struct lb_sim_t *sim = throttle->lbt_pwm_ctx;
+
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  sim->lbs_enabled[channel] = true;
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+  return LB_OK;
+}
+
+static int
+lb_pwm_sim_disable(struct lb_throttle_t *throttle, int channel)
+{
+  struct lb_sim_t *sim = throttle->lbt_pwm_ctx;
+
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  sim->lbs_enabled[channel] = false;
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+  return LB_OK;
+}
+
+static int
+lb_pwm_sim_set(struct lb_throttle_t *throttle, int channel, lb_power_t duty)
+{
+  int rc = LB_OK;
+  struct lb_sim_t *sim = throttle->lbt_pwm_ctx;
+
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  if (sim->lbs_enabled[channel]) {
+    sim->lbs_duty[channel] = duty;
+  } else {
+    /* Like sysfs, a disabled pwm won't take a duty cycle. */
+    rc = LB_PWM_ERROR;
+  }
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+  return rc;
+}
+
+static int
+lb_pwm_sim_get(struct lb_throttle_t *throttle, int channel,
+               lb_power_t *out_duty)
+{
+  struct lb_sim_t *sim = throttle->lbt_pwm_ctx;
+
+  pthread_mutex_lock(&(sim->lbs_mutex));
+  *out_duty = sim->lbs_duty[channel];
+  pthread_mutex_unlock(&(sim->lbs_mutex));
+  return LB_OK;
+}
+
+static const struct lb_pwm_ops_t lb_pwm_sim_ops = {
+  .lbp_open_func = lb_pwm_sim_open,
+  .lbp_deinit_func = lb_pwm_sim_deinit,
+  .lbp_enable_func = lb_pwm_sim_enable,
+  .lbp_disable_func = lb_pwm_sim_disable,
+  .lbp_set_func = lb_pwm_sim_set,
+  .lbp_get_func = lb_pwm_sim_get,
+};
+
+/**
+ * @brief Create a throttle that drives a simulated board instead of
+ * real pwms. Start it like any other throttle, or call lb_throttle_tick
+ * and lb_sim_step in a loop to run faster than real time.
+ *
+ * @param sim The simulator to drive.
+ *
+ * @return A new throttle, or NULL on failure.
+ */
+struct lb_throttle_t *
+lb_throttle_sim_new(struct lb_sim_t *sim)
+{
+  struct lb_throttle_t *throttle;
+
+  throttle = malloc(sizeof(struct lb_throttle_t));
+  if (throttle == NULL) {
+    return NULL;
+  }
+
+  if (lb_throttle_backend_init(throttle, &lb_pwm_sim_ops, sim) != LB_OK) {
+    free(throttle);
+    return NULL;
+  }
+
+  return throttle;
+}
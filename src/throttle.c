@@ -9,47 +9,312 @@
 
 #include <assert.h>
 #include <errno.h>
-#include <math.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <unistd.h>
 
 #include <libusp/pwm.h>
 
+#include "channel.h"
 #include "errors.h"
 #include "throttle.h"
 #include "throttle_internal.h"
+#include "trace.h"
 
 /**
- * @brief Actually create a new throttle based on input parameters.
+ * @brief Get an absolute CLOCK_MONOTONIC deadline some time from now.
  *
- * @param pwm_left The name of the left pwm.
- * @param pwm_right The name of the right pwm.
+ * @param deadline The deadline to fill in.
+ * @param nsec The number of nanoseconds from now.
+ */
+static void
+lb_throttle_deadline(struct timespec *deadline, uint64_t nsec)
+{
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+
+  nsec += (uint64_t)deadline->tv_nsec;
+  deadline->tv_sec += (time_t)(nsec / 1000000000ULL);
+  deadline->tv_nsec = (long)(nsec % 1000000000ULL);
+}
+
+/**
+ * @brief Read a clock in nanoseconds.
+ *
+ * @param clock The clock to read.
  *
- * @return A new throttle.
+ * @return The time on the clock in nanoseconds.
  */
-struct lb_throttle_t *
-lb_throttle_internal_new(const char *pwm_left, const char *pwm_right)
+static uint64_t
+lb_throttle_now_ns(clockid_t clock)
 {
-  struct lb_throttle_t *throttle;
-  throttle = calloc(sizeof(struct lb_throttle_t), 1);
+  struct timespec now;
 
-  throttle->lbt_pwm_controller = usp_controller_new();
+  clock_gettime(clock, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Get the configured tick period.
+ *
+ * @param throttle The throttle to check.
+ *
+ * @return The tick period in nanoseconds.
+ */
+static uint64_t
+lb_throttle_tick_ns(struct lb_throttle_t *throttle)
+{
+  uint64_t tick_ns;
+
+  tick_ns = lb_throttle_config_acquire(throttle)->lbtc_tick_ns;
+  lb_throttle_config_release(throttle);
+
+  return tick_ns;
+}
+
+/**
+ * @brief Get the shortest period the adaptive runner may tick at, given
+ * what writing the pwms has been costing. Call with the lock held.
+ *
+ * @param throttle The throttle to check.
+ *
+ * @return The floor period in nanoseconds.
+ */
+static uint64_t
+lb_throttle_floor_ns(struct lb_throttle_t *throttle)
+{
+  uint64_t floor_ns, tick_ns = lb_throttle_tick_ns(throttle);
+
+  floor_ns = throttle->lbt_write_ns * LB_THROTTLE_ADAPTIVE_WRITE_FACTOR;
+  if (floor_ns < LB_THROTTLE_ADAPTIVE_MIN_NSEC)
+    floor_ns = LB_THROTTLE_ADAPTIVE_MIN_NSEC;
+  if (floor_ns > tick_ns)
+    floor_ns = tick_ns;
+
+  return floor_ns;
+}
+
+/**
+ * @brief Work out how far the next tick may ramp. In adaptive mode the
+ * step is scaled by the time since the last tick, so the acceleration
+ * per second is the same at any tick rate.
+ *
+ * @param throttle The throttle to prepare.
+ * @param elapsed_ns The time since the last tick.
+ */
+static void
+lb_throttle_step_prepare(struct lb_throttle_t *throttle, uint64_t elapsed_ns)
+{
+  uint64_t tick_ns = lb_throttle_tick_ns(throttle);
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+
+  if (throttle->lbt_tick_mode == LB_THROTTLE_TICK_FIXED) {
+    throttle->lbt_step_ns = tick_ns;
+  } else if (throttle->lbt_ramping) {
+    if (elapsed_ns > tick_ns)
+      elapsed_ns = tick_ns;
+    throttle->lbt_step_ns = elapsed_ns;
+  } else {
+    /*
+     * A ramp is only starting, so the time spent steady doesn't count
+     * towards it.
+     */
+    throttle->lbt_step_ns = lb_throttle_floor_ns(throttle);
+  }
+
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+}
+
+/**
+ * @brief Pick the period for the next tick, and get its deadline.
+ *
+ * Fixed mode keeps an absolute schedule so ticks don't drift. Adaptive
+ * mode drops straight to the floor period when a ramp starts, and backs
+ * off by half again each tick once steady, up to the keepalive period.
+ *
+ * @param throttle The throttle to schedule.
+ * @param deadline_ns The deadline of the tick that just ran.
+ * @param now_ns The current time.
+ *
+ * @return The deadline for the next tick.
+ */
+static uint64_t
+lb_throttle_schedule(struct lb_throttle_t *throttle, uint64_t deadline_ns,
+                     uint64_t now_ns)
+{
+  uint64_t period_ns, tick_ns = lb_throttle_tick_ns(throttle);
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+
+  if (throttle->lbt_tick_mode == LB_THROTTLE_TICK_FIXED) {
+    period_ns = tick_ns;
+    deadline_ns += period_ns;
+    if (deadline_ns < now_ns)
+      deadline_ns = now_ns + period_ns;
+  } else {
+    if (throttle->lbt_ramping) {
+      period_ns = lb_throttle_floor_ns(throttle);
+    } else {
+      period_ns = throttle->lbt_period_ns + throttle->lbt_period_ns / 2;
+      if (period_ns > LB_THROTTLE_ADAPTIVE_KEEPALIVE_NSEC)
+        period_ns = LB_THROTTLE_ADAPTIVE_KEEPALIVE_NSEC;
+    }
+    deadline_ns = now_ns + period_ns;
+  }
+
+  throttle->lbt_period_ns = period_ns;
+
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+  return deadline_ns;
+}
+
+/**
+ * @brief Get the size of the storage a throttle needs.
+ *
+ * @return The size of a throttle in bytes.
+ */
+size_t
+lb_throttle_sizeof()
+{
+  return sizeof(struct lb_throttle_t);
+}
+
+/**
+ * @brief Get the alignment the storage for a throttle needs.
+ *
+ * @return The alignment of a throttle in bytes.
+ */
+size_t
+lb_throttle_alignof()
+{
+  return _Alignof(struct lb_throttle_t);
+}
+
+/**
+ * @brief Initialize a throttle that drives a pwm backend.
+ *
+ * @param throttle The storage to initialize the throttle in.
+ * @param ops The pwm backend to drive.
+ * @param ctx The context for the pwm backend.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_backend_init(struct lb_throttle_t *throttle,
+                         const struct lb_pwm_ops_t *ops, void *ctx)
+{
+  pthread_condattr_t cond_attr;
+
+  memset(throttle, 0, sizeof(struct lb_throttle_t));
+
+  throttle->lbt_pwm_ops = ops;
+  throttle->lbt_pwm_ctx = ctx;
 
   pthread_mutex_init(&(throttle->lbt_mutex), NULL);
+  pthread_mutex_init(&(throttle->lbt_config_mutex), NULL);
+  lb_profile_init(&(throttle->lbt_profile));
 
-  throttle->lbt_pwm_left_name = pwm_left;
-  throttle->lbt_pwm_right_name = pwm_right;
+  lb_throttle_config_default(&(throttle->lbt_config_initial));
+  throttle->lbt_config = &(throttle->lbt_config_initial);
+
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&(throttle->lbt_cond), &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
 
   throttle->lbt_running = false;
-  throttle->lbt_max_accel = LB_THROTTLE_MAX_ACCEL;
+  throttle->lbt_live = false;
+  throttle->lbt_tick_mode = LB_THROTTLE_TICK_FIXED;
+  throttle->lbt_step_ns = throttle->lbt_config->lbtc_tick_ns;
+  throttle->lbt_period_ns = throttle->lbt_config->lbtc_tick_ns;
   throttle->lbt_current_power = 0;
   throttle->lbt_target_power = 0;
 
+  return LB_OK;
+}
+
+/**
+ * @brief Actually initialize a libusp throttle based on input parameters.
+ *
+ * @param throttle The storage to initialize the throttle in.
+ * @param pwm_left The name of the left pwm.
+ * @param pwm_right The name of the right pwm.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_internal_init(struct lb_throttle_t *throttle,
+                          const char *pwm_left, const char *pwm_right)
+{
+  int rc;
+
+  rc = lb_throttle_backend_init(throttle, &lb_pwm_usp_ops, NULL);
+  if (rc != LB_OK) {
+    return rc;
+  }
+
+  throttle->lbt_pwm_controller = usp_controller_new();
+  if (throttle->lbt_pwm_controller == NULL) {
+    lb_profile_deinit(&(throttle->lbt_profile));
+    pthread_cond_destroy(&(throttle->lbt_cond));
+    pthread_mutex_destroy(&(throttle->lbt_config_mutex));
+    pthread_mutex_destroy(&(throttle->lbt_mutex));
+    return LB_PWM_ERROR;
+  }
+
+  /*
+   * Index the pwms now, so starting is just a lookup. If they don't
+   * exist yet, start will index them again.
+   */
+  lb_pwm_index_build(&(throttle->lbt_pwm_index),
+                     throttle->lbt_pwm_controller);
+
+  throttle->lbt_pwm_names[LB_THROTTLE_LEFT] = pwm_left;
+  throttle->lbt_pwm_names[LB_THROTTLE_RIGHT] = pwm_right;
+
+  return LB_OK;
+}
+
+/**
+ * @brief Actually create a new throttle based on input parameters.
+ *
+ * @param pwm_left The name of the left pwm.
+ * @param pwm_right The name of the right pwm.
+ *
+ * @return A new throttle, or NULL on failure.
+ */
+struct lb_throttle_t *
+lb_throttle_internal_new(const char *pwm_left, const char *pwm_right)
+{
+  struct lb_throttle_t *throttle;
+
+  throttle = malloc(sizeof(struct lb_throttle_t));
+  if (throttle == NULL) {
+    return NULL;
+  }
+
+  if (lb_throttle_internal_init(throttle, pwm_left, pwm_right) != LB_OK) {
+    free(throttle);
+    return NULL;
+  }
+
   return throttle;
 }
 
+/**
+ * @brief Initialize a test throttle in caller provided storage.
+ *
+ * @param storage The storage to initialize the throttle in.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_test_init(struct lb_throttle_t *storage)
+{
+  return lb_throttle_internal_init(storage, "test_pwm0", "test_pwm1");
+}
+
 /**
  * @brief Create a new test throttle.
  *
@@ -61,10 +326,25 @@ lb_throttle_test_new()
   return lb_throttle_internal_new("test_pwm0", "test_pwm1");
 }
 
+/**
+ * @brief Initialize a throttle in caller provided storage. The storage
+ * must be at least lb_throttle_sizeof() bytes and aligned to
+ * lb_throttle_alignof().
+ *
+ * @param storage The storage to initialize the throttle in.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_init(struct lb_throttle_t *storage)
+{
+  return lb_throttle_internal_init(storage, "odc1_pwm0", "odc1_pwm1");
+}
+
 /**
  * @brief Create a new throttle.
  *
- * @return A new throttle.
+ * @return A new throttle, or NULL on failure.
  */
 struct lb_throttle_t *
 lb_throttle_new()
@@ -73,22 +353,38 @@ lb_throttle_new()
 }
 
 /**
- * @brief Delete a throttle.
+ * @brief Tear down a throttle without freeing its storage. Stops the
+ * throttle if it is still running.
  *
- * @param throttle The throttle to delete.
+ * @param throttle The throttle to tear down.
  */
 void
-lb_throttle_delete(struct lb_throttle_t *throttle)
+lb_throttle_deinit(struct lb_throttle_t *throttle)
 {
-  lb_throttle_set_running(throttle, false);
-  usp_controller_delete(throttle->lbt_pwm_controller);
+  if (lb_throttle_get_running(throttle)) {
+    lb_throttle_stop(throttle);
+  }
 
-  if(throttle->lbt_pwm_left != NULL)
-    usp_pwm_unref(throttle->lbt_pwm_left);
+  throttle->lbt_pwm_ops->lbp_deinit_func(throttle);
 
-  if(throttle->lbt_pwm_right != NULL)
-    usp_pwm_unref(throttle->lbt_pwm_right);
+  if (throttle->lbt_config != &(throttle->lbt_config_initial))
+    free(throttle->lbt_config);
 
+  lb_profile_deinit(&(throttle->lbt_profile));
+  pthread_cond_destroy(&(throttle->lbt_cond));
+  pthread_mutex_destroy(&(throttle->lbt_config_mutex));
+  pthread_mutex_destroy(&(throttle->lbt_mutex));
+}
+
+/**
+ * @brief Delete a throttle.
+ *
+ * @param throttle The throttle to delete.
+ */
+void
+lb_throttle_delete(struct lb_throttle_t *throttle)
+{
+  lb_throttle_deinit(throttle);
   free(throttle);
 }
 
@@ -103,9 +399,6 @@ int
 lb_throttle_start(struct lb_throttle_t *throttle)
 {
   int rc;
-  struct usp_pwm_list_t *pwm_list;
-  struct usp_pwm_list_entry_t *pwm_entry;
-  struct usp_pwm_t *pwm;
 
   pthread_mutex_lock(&(throttle->lbt_mutex));
   if (throttle->lbt_running) {
@@ -113,36 +406,17 @@ lb_throttle_start(struct lb_throttle_t *throttle)
     goto out;
   }
 
-  pwm_list = usp_controller_get_pwms(throttle->lbt_pwm_controller);
-  if (pwm_list == NULL) {
-    rc = LB_NOT_FOUND;
-    goto out;
-  }
-
-  usp_pwm_list_foreach(pwm_list, pwm_entry)
-  {
-    const char *name;
-    pwm = usp_pwm_list_entry_get_pwm(pwm_entry);
-    name = usp_pwm_get_name(pwm);
-
-    if (strcmp(name, throttle->lbt_pwm_left_name) == 0) {
-      usp_pwm_ref(pwm);
-      throttle->lbt_pwm_left = pwm;
-    } else if (strcmp(name, throttle->lbt_pwm_right_name) == 0) {
-      usp_pwm_ref(pwm);
-      throttle->lbt_pwm_right = pwm;
-    }
-  }
-  usp_pwm_list_unref(pwm_list);
-
-  if (throttle->lbt_pwm_left == NULL || throttle->lbt_pwm_right == NULL) {
-    rc = LB_NOT_FOUND;
+  rc = throttle->lbt_pwm_ops->lbp_open_func(throttle);
+  if (rc != LB_OK) {
     goto out;
   }
 
   throttle->lbt_running = true;
+  throttle->lbt_live = false;
   throttle->lbt_current_power = 0;
   throttle->lbt_target_power = 0;
+  throttle->lbt_fault.lbtf_state = LB_THROTTLE_FAULT_OK;
+  throttle->lbt_pwms_stopped = false;
 
   pthread_create(&(throttle->lbt_thread), NULL, lb_throttle_runner, throttle);
 
@@ -174,6 +448,7 @@ lb_throttle_stop(struct lb_throttle_t *throttle)
   }
 
   throttle->lbt_running = false;
+  pthread_cond_broadcast(&(throttle->lbt_cond));
   pthread_mutex_unlock(&(throttle->lbt_mutex));
 
   pthread_join(throttle->lbt_thread, &ret_val);
@@ -213,7 +488,125 @@ lb_throttle_set_running(struct lb_throttle_t *throttle, bool running)
 {
   pthread_mutex_lock(&(throttle->lbt_mutex));
   throttle->lbt_running = running;
+  pthread_cond_broadcast(&(throttle->lbt_cond));
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+}
+
+/**
+ * @brief Wait for some time, or until the throttle is stopped.
+ *
+ * @param throttle The throttle to wait on.
+ * @param nsec The longest time to wait in nanoseconds.
+ *
+ * @return The running state of the throttle after waiting.
+ */
+bool
+lb_throttle_wait(struct lb_throttle_t *throttle, uint64_t nsec)
+{
+  bool running;
+  struct timespec deadline;
+
+  lb_throttle_deadline(&deadline, nsec);
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  while (throttle->lbt_running &&
+         pthread_cond_timedwait(&(throttle->lbt_cond),
+                                &(throttle->lbt_mutex),
+                                &deadline) != ETIMEDOUT)
+    ;
+  running = throttle->lbt_running;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  return running;
+}
+
+/**
+ * @brief Sleep until a deadline, until the throttle is stopped, or until
+ * the runner is asked to wake up early.
+ *
+ * @param throttle The throttle to sleep on.
+ * @param deadline_ns The CLOCK_MONOTONIC deadline in nanoseconds.
+ *
+ * @return The running state of the throttle after sleeping.
+ */
+bool
+lb_throttle_sleep_until(struct lb_throttle_t *throttle, uint64_t deadline_ns)
+{
+  bool running;
+  struct timespec deadline;
+
+  deadline.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+  deadline.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  while (throttle->lbt_running && !throttle->lbt_wakeup &&
+         pthread_cond_timedwait(&(throttle->lbt_cond),
+                                &(throttle->lbt_mutex),
+                                &deadline) != ETIMEDOUT)
+    ;
+  throttle->lbt_wakeup = false;
+  running = throttle->lbt_running;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  return running;
+}
+
+/**
+ * @brief Check whether the throttle is live, that is, its pwms are
+ * enabled and it is driving them.
+ *
+ * @param throttle The throttle to check.
+ *
+ * @return True if the throttle is live.
+ */
+bool
+lb_throttle_is_live(struct lb_throttle_t *throttle)
+{
+  bool live;
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  live = throttle->lbt_live;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  return live;
+}
+
+/**
+ * @brief Wait for a started throttle to go live.
+ *
+ * @param throttle The throttle to wait on.
+ * @param timeout_ms The longest time to wait in milliseconds.
+ *
+ * @return LB_OK once live, LB_RETRY on timeout, or LB_THROTTLE_ERROR if
+ * the throttle isn't running.
+ */
+int
+lb_throttle_wait_live(struct lb_throttle_t *throttle, unsigned int timeout_ms)
+{
+  int rc;
+  struct timespec deadline;
+
+  lb_throttle_deadline(&deadline, (uint64_t)timeout_ms * 1000000ULL);
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  while (throttle->lbt_running && !throttle->lbt_live) {
+    if (pthread_cond_timedwait(&(throttle->lbt_cond),
+                               &(throttle->lbt_mutex),
+                               &deadline) == ETIMEDOUT) {
+      break;
+    }
+  }
+
+  if (throttle->lbt_live) {
+    rc = LB_OK;
+  } else if (throttle->lbt_running) {
+    rc = LB_RETRY;
+  } else {
+    rc = LB_THROTTLE_ERROR;
+  }
   pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  return rc;
 }
 
 /**
@@ -227,57 +620,324 @@ void *
 lb_throttle_runner(void *ctx)
 {
   int rc;
-  struct timespec sleep_in, sleep_out;
-  struct timespec *sleep_in_ptr, *sleep_out_ptr, *sleep_tmp_ptr;
+  uint64_t now_ns, last_ns, deadline_ns;
+  uint64_t wall_ns, cpu_ns;
+  struct lb_cpu_window_t window;
   struct lb_throttle_t *throttle = ctx;
   assert(throttle != NULL);
   bool running;
+  uint64_t backoff = LB_THROTTLE_START_BACKOFF_MIN_NSEC;
 
+  /*
+   * The pwms may not be ready right after boot. Retry quickly at first,
+   * backing off so a missing device doesn't spin.
+   */
   while (((running = lb_throttle_get_running(throttle)) == true) &&
          ((rc = lb_throttle_start_pwms(throttle)) != 0)) {
-    sleep(1);
+    lb_throttle_wait(throttle, backoff);
+    backoff *= 2;
+    if (backoff > LB_THROTTLE_START_BACKOFF_MAX_NSEC)
+      backoff = LB_THROTTLE_START_BACKOFF_MAX_NSEC;
   }
 
   if (!running)
     goto out;
 
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  throttle->lbt_live = true;
+  pthread_cond_broadcast(&(throttle->lbt_cond));
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  last_ns = lb_throttle_now_ns(CLOCK_MONOTONIC);
+  deadline_ns = last_ns;
+  lb_cpu_window_start(&window, last_ns);
+
   while (lb_throttle_get_running(throttle) == true) {
-    pthread_mutex_lock(&(throttle->lbt_mutex));
-
-    if (throttle->lbt_current_power != throttle->lbt_target_power) {
-      float diff = throttle->lbt_target_power - throttle->lbt_current_power;
-      float current_power = throttle->lbt_current_power;
-
-      if (fabsf(diff) > LB_THROTTLE_MAX_ACCEL) {
-        current_power = diff > 0 ? current_power + LB_THROTTLE_MAX_ACCEL
-                                 : current_power - LB_THROTTLE_MAX_ACCEL;
-      }
-
-      /* XXX: Handle failing to set the power better. */
-      rc = lb_throttle_current_set(throttle, current_power);
-      if(rc == LB_OK) {
-        throttle->lbt_current_power = current_power;
-      } else {
-        throttle->lbt_current_power = 0.0f;
-      }
+    now_ns = lb_throttle_now_ns(CLOCK_MONOTONIC);
+    lb_throttle_step_prepare(throttle, now_ns - last_ns);
+    last_ns = now_ns;
+
+    LB_TRACE1(tick__start, throttle->lbt_ticks);
+    rc = lb_throttle_tick(throttle);
+    LB_TRACE1(tick__end, rc);
+
+    now_ns = lb_throttle_now_ns(CLOCK_MONOTONIC);
+    if (now_ns - window.lbcw_start_ns >= LB_THROTTLE_CPU_WINDOW_NSEC) {
+      lb_cpu_window_elapsed(&window, now_ns, &wall_ns, &cpu_ns);
+      pthread_mutex_lock(&(throttle->lbt_mutex));
+      throttle->lbt_cpu_ns_per_sec = cpu_ns * 1000000000ULL / wall_ns;
+      pthread_mutex_unlock(&(throttle->lbt_mutex));
+      lb_cpu_window_start(&window, now_ns);
     }
-    pthread_mutex_unlock(&(throttle->lbt_mutex));
 
-    sleep_in.tv_sec = LB_THROTTLE_SEC_SLEEP;
-    sleep_in.tv_nsec = LB_THROTTLE_NSEC_SLEEP;
+    deadline_ns = lb_throttle_schedule(throttle, deadline_ns, now_ns);
+    lb_throttle_sleep_until(throttle, deadline_ns);
+
+    /*
+     * Only late wakeups are overshoot. The start time is 0 when the
+     * profiler is off, so nothing is recorded.
+     */
+    now_ns = lb_profile_start(&(throttle->lbt_profile));
+    if (now_ns > deadline_ns)
+      lb_profile_record_ns(&(throttle->lbt_profile),
+                           LB_PROFILE_SLEEP_OVERSHOOT, now_ns - deadline_ns);
+  }
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  throttle->lbt_live = false;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+out:
+  return NULL;
+}
+
+/**
+ * @brief Turn the pwms off after a fault. The throttle isn't live again
+ * until recovery turns them back on. Call with the throttle's mutex
+ * held.
+ *
+ * @param throttle The throttle that faulted.
+ */
+static void
+lb_throttle_fault_stop_pwms(struct lb_throttle_t *throttle)
+{
+  lb_throttle_stop_pwms(throttle);
+  throttle->lbt_pwms_stopped = true;
+  throttle->lbt_current_power = LB_POWER_C(0);
+  throttle->lbt_live = false;
+  pthread_cond_broadcast(&(throttle->lbt_cond));
+}
+
+/**
+ * @brief Note a failed pwm write. Transient faults leave the pwms as
+ * they are for the next tick to retry, anything else turns them off
+ * until they can be enabled again. Call with the throttle's mutex held.
+ *
+ * @param throttle The throttle that faulted.
+ * @param channel The channel that failed.
+ * @param rc The status code of the failure.
+ */
+static void
+lb_throttle_fault_raise(struct lb_throttle_t *throttle, int channel, int rc)
+{
+  struct lb_throttle_fault_t *fault = &(throttle->lbt_fault);
+
+  if (fault->lbtf_state == LB_THROTTLE_FAULT_OK)
+    throttle->lbt_recover_attempt = 0;
+
+  fault->lbtf_state = LB_THROTTLE_FAULT_RECOVERING;
+  fault->lbtf_channel = channel;
+  fault->lbtf_rc = rc;
+
+  if (rc == LB_RETRY) {
+    fault->lbtf_transient++;
+  } else {
+    fault->lbtf_persistent++;
+    lb_throttle_fault_stop_pwms(throttle);
+  }
+}
 
-    sleep_in_ptr = &sleep_in;
-    sleep_out_ptr = &sleep_out;
+/**
+ * @brief Take one step at recovering from a pwm fault. Re-enables the
+ * pwms if they were turned off, then resumes from what they really
+ * hold, so the next ticks ramp up from there rather than jumping. Gives
+ * up after LB_THROTTLE_RECOVER_TICKS steps. Call with the throttle's
+ * mutex held.
+ *
+ * @param throttle The throttle to recover.
+ *
+ * @return A status code.
+ */
+static int
+lb_throttle_recover(struct lb_throttle_t *throttle)
+{
+  int rc, i, channel = 0;
+  bool matches = true;
+  lb_power_t power, restore, diff;
+  const struct lb_throttle_config_t *config;
+  struct lb_throttle_fault_t *fault = &(throttle->lbt_fault);
+
+  if (fault->lbtf_state == LB_THROTTLE_FAULT_FAILED)
+    return LB_PWM_ERROR;
+
+  throttle->lbt_recover_attempt++;
+
+  if (throttle->lbt_pwms_stopped) {
+    rc = lb_throttle_start_pwms(throttle);
+    if (rc != LB_OK)
+      goto retry;
+    throttle->lbt_pwms_stopped = false;
+
+    /* A throttle ticked by hand, without the runner, isn't live. */
+    throttle->lbt_live = throttle->lbt_running;
+    pthread_cond_broadcast(&(throttle->lbt_cond));
+  }
 
-    while ((rc = nanosleep(sleep_in_ptr, sleep_out_ptr)) == EINTR) {
-      sleep_tmp_ptr = sleep_in_ptr;
-      sleep_in_ptr = sleep_out_ptr;
-      sleep_out_ptr = sleep_tmp_ptr;
+  /*
+   * A failed write may have landed on some channels and not others.
+   * Trust the hardware, and if it disagrees with what we wrote, resume
+   * from the lowest channel.
+   */
+  restore = throttle->lbt_written_power;
+  config = lb_throttle_config_acquire(throttle);
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    power = LB_POWER_C(0);
+    rc = throttle->lbt_pwm_ops->lbp_get_func(throttle, i, &power);
+    if (rc != LB_OK) {
+      channel = i;
+      lb_throttle_config_release(throttle);
+      goto fault;
     }
+
+    diff = power - throttle->lbt_written[i];
+    if (diff > LB_THROTTLE_READBACK_TOLERANCE ||
+        diff < -LB_THROTTLE_READBACK_TOLERANCE)
+      matches = false;
+
+    /*
+     * The pwm reads back a duty cycle, work back through the curve and
+     * the trim to the power it was written for.
+     */
+    power = lb_calib_invert(&(config->lbtc_calib[i]), power);
+    power = lb_power_div(power, config->lbtc_trim[i]);
+    if (power < restore)
+      restore = power;
+  }
+  lb_throttle_config_release(throttle);
+
+  if (matches)
+    restore = throttle->lbt_written_power;
+  if (restore < LB_POWER_C(0))
+    restore = LB_POWER_C(0);
+
+  rc = lb_throttle_channels_set(throttle, restore, NULL, &channel);
+  if (rc != LB_OK)
+    goto fault;
+
+  throttle->lbt_current_power = restore;
+  fault->lbtf_state = LB_THROTTLE_FAULT_OK;
+  fault->lbtf_recoveries++;
+  fault->lbtf_recover_ticks = throttle->lbt_recover_attempt;
+  if (fault->lbtf_recover_ticks > fault->lbtf_recover_ticks_max)
+    fault->lbtf_recover_ticks_max = fault->lbtf_recover_ticks;
+  return LB_OK;
+
+fault:
+  lb_throttle_fault_raise(throttle, channel, rc);
+retry:
+  if (throttle->lbt_recover_attempt >= LB_THROTTLE_RECOVER_TICKS) {
+    fault->lbtf_state = LB_THROTTLE_FAULT_FAILED;
+    lb_throttle_fault_stop_pwms(throttle);
   }
+  return LB_PWM_ERROR;
+}
+
+/**
+ * @brief Move the throttle one step towards the requested power. The
+ * runner calls this every tick. Simulations may call it directly
+ * instead of starting the runner, to run faster than real time.
+ *
+ * @param throttle The throttle to step.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_tick(struct lb_throttle_t *throttle)
+{
+  int rc = LB_OK, channel;
+  lb_power_t current_power, target_power, max_step;
+  uint64_t start_ns, write_ns, phase_ns;
+  struct lb_profile_t *profile = &(throttle->lbt_profile);
+  const struct lb_throttle_config_t *config;
+
+  config = lb_throttle_config_acquire(throttle);
+
+  phase_ns = lb_profile_start(profile);
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  lb_profile_record(profile, LB_PROFILE_LOCK_WAIT, phase_ns);
+
+  throttle->lbt_ticks++;
+
+  if (throttle->lbt_fault.lbtf_state != LB_THROTTLE_FAULT_OK) {
+    throttle->lbt_fault.lbtf_lost_ticks++;
+    rc = lb_throttle_recover(throttle);
+    throttle->lbt_ramping =
+        throttle->lbt_fault.lbtf_state == LB_THROTTLE_FAULT_RECOVERING;
+    goto out;
+  }
+
+  /* Off is always allowed, or the failsafe couldn't stop the board. */
+  target_power = throttle->lbt_target_power;
+  if (target_power <= LB_POWER_C(0))
+    target_power = LB_POWER_C(0);
+  else if (target_power < config->lbtc_power_min)
+    target_power = config->lbtc_power_min;
+  if (target_power > config->lbtc_power_max)
+    target_power = config->lbtc_power_max;
+
+  if (throttle->lbt_current_power != target_power) {
+    phase_ns = lb_profile_start(profile);
+
+    max_step = lb_power_scale(config->lbtc_ramp_per_sec,
+                              throttle->lbt_step_ns, 1000000000ULL);
+
+    current_power = lb_throttle_ramp(throttle->lbt_current_power,
+                                     target_power, max_step);
+
+    lb_profile_record(profile, LB_PROFILE_RAMP, phase_ns);
+
+    start_ns = lb_throttle_now_ns(CLOCK_MONOTONIC);
+
+    rc = lb_throttle_channels_set(throttle, current_power, profile,
+                                  &channel);
+    if(rc == LB_OK) {
+      throttle->lbt_current_power = current_power;
+    } else {
+      lb_throttle_fault_raise(throttle, channel, rc);
+    }
+
+    /* Smooth the write cost so one slow write doesn't stall ramps. */
+    write_ns = lb_throttle_now_ns(CLOCK_MONOTONIC) - start_ns;
+    if (throttle->lbt_write_ns == 0) {
+      throttle->lbt_write_ns = write_ns;
+    } else {
+      throttle->lbt_write_ns = throttle->lbt_write_ns -
+          throttle->lbt_write_ns / 8 + write_ns / 8;
+    }
+  }
+
+  throttle->lbt_ramping = throttle->lbt_current_power != target_power;
 
 out:
-  return NULL;
+  lb_profile_tick_end(profile);
+
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+  lb_throttle_config_release(throttle);
+  return rc;
+}
+
+/**
+ * @brief Step a power level towards a target, changing it by no more
+ * than max_accel.
+ *
+ * @param current The current power level.
+ * @param target The power level to ramp towards.
+ * @param max_accel The largest change allowed in a single step.
+ *
+ * @return The next power level.
+ */
+lb_power_t
+lb_throttle_ramp(lb_power_t current, lb_power_t target, lb_power_t max_accel)
+{
+  lb_power_t diff = target - current;
+
+  if (diff > max_accel) {
+    return current + max_accel;
+  } else if (diff < -max_accel) {
+    return current - max_accel;
+  }
+
+  return target;
 }
 
 /**
@@ -289,14 +949,202 @@ out:
  * @return A status code.
  */
 int
-lb_throttle_request_set(struct lb_throttle_t *throttle, float power)
+lb_throttle_request_set(struct lb_throttle_t *throttle, lb_power_t power)
 {
+  LB_TRACE1(request__set, LB_TRACE_POWER(power));
+
   pthread_mutex_lock(&(throttle->lbt_mutex));
   throttle->lbt_target_power = power;
+  if (throttle->lbt_tick_mode == LB_THROTTLE_TICK_ADAPTIVE &&
+      throttle->lbt_current_power != power) {
+    /* The runner may be in a long keepalive sleep, start ramping now. */
+    throttle->lbt_wakeup = true;
+    pthread_cond_broadcast(&(throttle->lbt_cond));
+  }
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+  return LB_OK;
+}
+
+/**
+ * @brief Choose how the runner schedules its ticks.
+ *
+ * @param throttle The throttle to change.
+ * @param mode The scheduling mode.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_tick_mode_set(struct lb_throttle_t *throttle,
+                          enum lb_throttle_tick_mode_t mode)
+{
+  if (mode != LB_THROTTLE_TICK_FIXED && mode != LB_THROTTLE_TICK_ADAPTIVE)
+    return LB_THROTTLE_ERROR;
+
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  throttle->lbt_tick_mode = mode;
+  throttle->lbt_period_ns = lb_throttle_tick_ns(throttle);
+  throttle->lbt_wakeup = true;
+  pthread_cond_broadcast(&(throttle->lbt_cond));
   pthread_mutex_unlock(&(throttle->lbt_mutex));
   return LB_OK;
 }
 
+/**
+ * @brief Get a snapshot of how the runner is ticking.
+ *
+ * @param throttle The throttle to check.
+ * @param out_stats The stats to fill in.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_tick_stats_get(struct lb_throttle_t *throttle,
+                           struct lb_throttle_tick_stats_t *out_stats)
+{
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  out_stats->lbts_period_ns = throttle->lbt_period_ns;
+  out_stats->lbts_write_ns = throttle->lbt_write_ns;
+  out_stats->lbts_cpu_ns_per_sec = throttle->lbt_cpu_ns_per_sec;
+  out_stats->lbts_ticks = throttle->lbt_ticks;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+  return LB_OK;
+}
+
+/**
+ * @brief Fill in the default throttle config.
+ *
+ * @param config The config to fill in.
+ */
+void
+lb_throttle_config_default(struct lb_throttle_config_t *config)
+{
+  int i;
+
+  config->lbtc_ramp_per_sec = lb_power_scale(LB_THROTTLE_MAX_ACCEL,
+                                             1000000000ULL,
+                                             LB_THROTTLE_PERIOD_NSEC);
+  config->lbtc_tick_ns = LB_THROTTLE_PERIOD_NSEC;
+  config->lbtc_power_min = LB_POWER_C(0);
+  config->lbtc_power_max = LB_POWER_C(100);
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    config->lbtc_trim[i] = LB_POWER_C(1.0);
+    lb_calib_linear(&(config->lbtc_calib[i]));
+  }
+}
+
+/**
+ * @brief Pin the published config for reading. This never blocks; pair
+ * it with lb_throttle_config_release once done with the snapshot.
+ *
+ * @param throttle The throttle to read the config of.
+ *
+ * @return The current config snapshot.
+ */
+const struct lb_throttle_config_t *
+lb_throttle_config_acquire(struct lb_throttle_t *throttle)
+{
+  /*
+   * Count in before loading the pointer. A writer swaps the pointer
+   * before waiting on the count, so whichever snapshot is loaded here
+   * stays alive until the release.
+   */
+  __atomic_add_fetch(&(throttle->lbt_config_readers), 1, __ATOMIC_SEQ_CST);
+  return __atomic_load_n(&(throttle->lbt_config), __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Unpin a config snapshot from lb_throttle_config_acquire.
+ *
+ * @param throttle The throttle the config was read from.
+ */
+void
+lb_throttle_config_release(struct lb_throttle_t *throttle)
+{
+  __atomic_sub_fetch(&(throttle->lbt_config_readers), 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Publish a new config. The runner picks it up on its next tick
+ * without being stopped, and readers never wait on a writer.
+ *
+ * @param throttle The throttle to configure.
+ * @param config The config to publish. It is copied.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_config_set(struct lb_throttle_t *throttle,
+                       const struct lb_throttle_config_t *config)
+{
+  int i;
+  struct lb_throttle_config_t *snapshot, *old;
+
+  if (config->lbtc_ramp_per_sec <= LB_POWER_C(0) ||
+      config->lbtc_tick_ns < LB_THROTTLE_TICK_MIN_NSEC ||
+      config->lbtc_tick_ns > LB_THROTTLE_TICK_MAX_NSEC ||
+      config->lbtc_power_min < LB_POWER_C(0) ||
+      config->lbtc_power_min > config->lbtc_power_max ||
+      config->lbtc_power_max > LB_POWER_C(100)) {
+    return LB_THROTTLE_ERROR;
+  }
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    if (config->lbtc_trim[i] <= LB_POWER_C(0) ||
+        config->lbtc_trim[i] > LB_POWER_C(2.0) ||
+        !lb_calib_valid(&(config->lbtc_calib[i])))
+      return LB_THROTTLE_ERROR;
+  }
+
+  snapshot = malloc(sizeof(*snapshot));
+  if (snapshot == NULL)
+    return LB_THROTTLE_ERROR;
+  *snapshot = *config;
+
+  /* Writers are serialized, so only one old snapshot is ever draining. */
+  pthread_mutex_lock(&(throttle->lbt_config_mutex));
+
+  old = __atomic_exchange_n(&(throttle->lbt_config), snapshot,
+                            __ATOMIC_SEQ_CST);
+
+  /*
+   * Readers only hold a snapshot for a tick, so this grace period is
+   * short. New readers already see the new snapshot.
+   */
+  while (__atomic_load_n(&(throttle->lbt_config_readers),
+                         __ATOMIC_SEQ_CST) != 0)
+    sched_yield();
+
+  if (old != &(throttle->lbt_config_initial))
+    free(old);
+
+  pthread_mutex_unlock(&(throttle->lbt_config_mutex));
+
+  /* Let an idle adaptive runner notice a new tick period or clamp. */
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  throttle->lbt_wakeup = true;
+  pthread_cond_broadcast(&(throttle->lbt_cond));
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  return LB_OK;
+}
+
+/**
+ * @brief Get a copy of the published config.
+ *
+ * @param throttle The throttle to read the config of.
+ * @param out_config The config to fill in.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_config_get(struct lb_throttle_t *throttle,
+                       struct lb_throttle_config_t *out_config)
+{
+  *out_config = *lb_throttle_config_acquire(throttle);
+  lb_throttle_config_release(throttle);
+  return LB_OK;
+}
+
 /**
  * @brief Get the value of the requested power level.
  *
@@ -306,7 +1154,7 @@ lb_throttle_request_set(struct lb_throttle_t *throttle, float power)
  * @return A status code.
  */
 int
-lb_throttle_request_get(struct lb_throttle_t *throttle, float *out_power)
+lb_throttle_request_get(struct lb_throttle_t *throttle, lb_power_t *out_power)
 {
   pthread_mutex_lock(&(throttle->lbt_mutex));
   *out_power = throttle->lbt_target_power;
@@ -315,7 +1163,8 @@ lb_throttle_request_get(struct lb_throttle_t *throttle, float *out_power)
 }
 
 /**
- * @brief Set the current power level of a throttle.
+ * @brief Set the current power level of a throttle. A failed write is
+ * raised as a fault, for the next tick to recover from.
  *
  * @param throttle The throttle to set the power level of.
  * @param power The power level to set as a percentage.
@@ -323,31 +1172,97 @@ lb_throttle_request_get(struct lb_throttle_t *throttle, float *out_power)
  * @return A status code.
  */
 int
-lb_throttle_current_set(struct lb_throttle_t *throttle, float power)
+lb_throttle_current_set(struct lb_throttle_t *throttle, lb_power_t power)
 {
-  int rc;
+  int rc, channel;
 
-  rc = usp_pwm_set_duty_cycle(throttle->lbt_pwm_left, power);
-  if (rc != USP_OK) {
-    goto out;
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  rc = lb_throttle_channels_set(throttle, power, NULL, &channel);
+  if (rc != LB_OK) {
+    lb_throttle_fault_raise(throttle, channel, rc);
+    rc = LB_PWM_ERROR;
   }
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
 
-  rc = usp_pwm_set_duty_cycle(throttle->lbt_pwm_right, power);
-  if (rc != USP_OK) {
-    goto out;
+  return rc;
+}
+
+/* Each channel's write is profiled as the phase LB_PROFILE_WRITE_LEFT + i. */
+_Static_assert(LB_THROTTLE_LEFT == 0 &&
+               LB_PROFILE_WRITE_RIGHT ==
+               LB_PROFILE_WRITE_LEFT + LB_THROTTLE_CHANNELS - 1,
+               "Every channel needs its own write phase.");
+
+/**
+ * @brief Write a power level to every channel, scaled by the channel's
+ * trim and mapped through its calibration curve. Stops at the first
+ * failed write, leaving what to do about it to the caller. Call with
+ * the throttle's mutex held.
+ *
+ * @param throttle The throttle to set the power level of.
+ * @param power The power level to set as a percentage.
+ * @param profile The profiler to time each write in, or NULL.
+ * @param out_channel The channel that failed, or NULL.
+ *
+ * @return A status code. LB_RETRY if the failure was transient.
+ */
+int
+lb_throttle_channels_set(struct lb_throttle_t *throttle, lb_power_t power,
+                         struct lb_profile_t *profile, int *out_channel)
+{
+  int rc = LB_OK, i;
+  uint64_t phase_ns = 0;
+  lb_power_t written[LB_THROTTLE_CHANNELS];
+  const struct lb_throttle_config_t *config;
+
+  config = lb_throttle_config_acquire(throttle);
+
+  /* Work out every channel's duty cycle up front, then write them. */
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    written[i] = lb_power_mul(power, config->lbtc_trim[i]);
+    if (written[i] > LB_POWER_C(100))
+      written[i] = LB_POWER_C(100);
   }
+  lb_calib_apply(config->lbtc_calib, written, LB_THROTTLE_CHANNELS);
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    if (profile != NULL)
+      phase_ns = lb_profile_start(profile);
+
+    LB_TRACE2(pwm__write, i, LB_TRACE_POWER(written[i]));
+    rc = throttle->lbt_pwm_ops->lbp_set_func(throttle, i, written[i]);
+    LB_TRACE2(pwm__write__done, i, rc);
+
+    if (profile != NULL)
+      lb_profile_record(profile, LB_PROFILE_WRITE_LEFT + i, phase_ns);
+
+    if (rc != LB_OK) {
+      goto out;
+    }
+    throttle->lbt_written[i] = written[i];
+  }
+  throttle->lbt_written_power = power;
 
 out:
-  if(rc != 0) {
-    rc = LB_PWM_ERROR;
-    lb_throttle_stop_pwms(throttle);
+  lb_throttle_config_release(throttle);
+
+  if(rc != LB_OK) {
+    if (rc != LB_RETRY)
+      rc = LB_PWM_ERROR;
+    if (out_channel != NULL)
+      *out_channel = i;
   }
 
   return rc;
 }
 
 /**
- * @brief Get the current power level of a throttle.
+ * @brief Get the current power level of a throttle. Each channel is read
+ * back and checked against what was written to it, so trimmed channels
+ * still agree on a single power level. Takes the throttle's lock, so it
+ * is safe to call from other threads while the runner ticks. A failed
+ * or mismatched readback is raised as a fault, for the next tick to
+ * recover from.
  *
  * @param throttle The throttle to get the power level of.
  * @param out_power The power level of the throttle as a percentage.
@@ -355,65 +1270,139 @@ out:
  * @return A status code.
  */
 int
-lb_throttle_current_get(struct lb_throttle_t *throttle, float *out_power)
+lb_throttle_current_get(struct lb_throttle_t *throttle, lb_power_t *out_power)
 {
-  int rc;
-  float power_left, power_right;
-  power_left = power_right = 0.0f;
+  int rc = LB_OK, i;
+  lb_power_t power, diff;
 
-  rc = usp_pwm_get_duty_cycle(throttle->lbt_pwm_left, &power_left);
-  if(rc != USP_OK) {
-    goto out;
-  }
+  pthread_mutex_lock(&(throttle->lbt_mutex));
 
-  rc = usp_pwm_get_duty_cycle(throttle->lbt_pwm_right, &power_right);
-  if(rc != USP_OK) {
-    goto out;
-  }
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    power = LB_POWER_C(0);
+    rc = throttle->lbt_pwm_ops->lbp_get_func(throttle, i, &power);
+    if(rc != LB_OK) {
+      goto out;
+    }
 
-  if(power_left != power_right) {
-    rc = LB_PWM_ERROR;
-    goto out;
+    diff = power - throttle->lbt_written[i];
+    if(diff > LB_THROTTLE_READBACK_TOLERANCE ||
+       diff < -LB_THROTTLE_READBACK_TOLERANCE) {
+      rc = LB_PWM_ERROR;
+      goto out;
+    }
   }
 
 out:
   if(rc != 0) {
+    lb_throttle_fault_raise(throttle, i, rc);
     rc = LB_PWM_ERROR;
-    lb_throttle_stop_pwms(throttle);
   } else {
-    *out_power = power_left;
+    *out_power = throttle->lbt_written_power;
   }
 
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
   return rc;
 }
 
 /**
- * @brief Set the speeds on the pwms to 0, then disable them.
+ * @brief Queue the throttle's power level, request and fault state as
+ * telemetry on a comm. They go out with the comm's next uplink flush.
  *
- * @param throttle The throttle to stop_pwms out.
+ * @param throttle The throttle to report on.
+ * @param comm The comm to send the telemetry on.
+ *
+ * @return A status code.
  */
 int
-lb_throttle_start_pwms(struct lb_throttle_t *throttle)
+lb_throttle_telemetry_publish(struct lb_throttle_t *throttle,
+                              struct lb_comm_t *comm)
 {
   int rc;
+  union lb_channel_value_t power, request, fault;
 
-  rc = usp_pwm_enable(throttle->lbt_pwm_left);
-  if (rc != 0) {
-    goto out;
-  }
-  rc = usp_pwm_enable(throttle->lbt_pwm_right);
-  if (rc != 0) {
-    goto out;
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  power.lbcv_power = throttle->lbt_written_power;
+  request.lbcv_power = throttle->lbt_target_power;
+  fault.lbcv_int = (int32_t)throttle->lbt_fault.lbtf_state;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+
+  rc = lb_comm_uplink_publish(comm, LB_THROTTLE_TELEMETRY_POWER,
+                              LB_CHANNEL_TYPE_POWER, &power);
+  if (rc == LB_OK)
+    rc = lb_comm_uplink_publish(comm, LB_THROTTLE_TELEMETRY_REQUEST,
+                                LB_CHANNEL_TYPE_POWER, &request);
+  if (rc == LB_OK)
+    rc = lb_comm_uplink_publish(comm, LB_THROTTLE_TELEMETRY_FAULT,
+                                LB_CHANNEL_TYPE_INT, &fault);
+
+  return rc;
+}
+
+/**
+ * @brief Get the fault state of a throttle.
+ *
+ * @param throttle The throttle to check.
+ * @param out_fault The fault state and counters.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_fault_get(struct lb_throttle_t *throttle,
+                      struct lb_throttle_fault_t *out_fault)
+{
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  *out_fault = throttle->lbt_fault;
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+  return LB_OK;
+}
+
+/**
+ * @brief Let a failed throttle try to recover again, from the next tick.
+ *
+ * @param throttle The throttle to clear.
+ *
+ * @return A status code.
+ */
+int
+lb_throttle_fault_clear(struct lb_throttle_t *throttle)
+{
+  pthread_mutex_lock(&(throttle->lbt_mutex));
+  if (throttle->lbt_fault.lbtf_state == LB_THROTTLE_FAULT_FAILED) {
+    throttle->lbt_fault.lbtf_state = LB_THROTTLE_FAULT_RECOVERING;
+    throttle->lbt_recover_attempt = 0;
+    throttle->lbt_wakeup = true;
+    pthread_cond_broadcast(&(throttle->lbt_cond));
   }
+  pthread_mutex_unlock(&(throttle->lbt_mutex));
+  return LB_OK;
+}
 
-  rc = usp_pwm_set_duty_cycle(throttle->lbt_pwm_left, 0.0f);
-  if (rc != 0) {
-    goto out;
+/**
+ * @brief Enable the pwms, then set their speeds to 0.
+ *
+ * @param throttle The throttle to start the pwms of.
+ */
+int
+lb_throttle_start_pwms(struct lb_throttle_t *throttle)
+{
+  int rc = LB_OK, i;
+  const struct lb_pwm_ops_t *ops = throttle->lbt_pwm_ops;
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    rc = ops->lbp_enable_func(throttle, i);
+    if (rc != LB_OK) {
+      goto out;
+    }
   }
-  rc = usp_pwm_set_duty_cycle(throttle->lbt_pwm_right, 0.0f);
-  if (rc != 0) {
-    goto out;
+
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    rc = ops->lbp_set_func(throttle, i, LB_POWER_C(0));
+    if (rc != LB_OK) {
+      goto out;
+    }
+    throttle->lbt_written[i] = LB_POWER_C(0);
   }
+  throttle->lbt_written_power = LB_POWER_C(0);
 
 out:
   if (rc != 0) {
@@ -432,25 +1421,23 @@ out:
 int
 lb_throttle_stop_pwms(struct lb_throttle_t *throttle)
 {
-  int rc, rc_out = LB_OK;
+  int rc, rc_out = LB_OK, i;
+  const struct lb_pwm_ops_t *ops = throttle->lbt_pwm_ops;
 
-  rc = usp_pwm_set_duty_cycle(throttle->lbt_pwm_left, 0.0f);
-  if (rc != 0) {
-    rc_out = LB_PWM_ERROR;
-  }
-  rc = usp_pwm_set_duty_cycle(throttle->lbt_pwm_right, 0.0f);
-  if (rc != 0) {
-    rc_out = LB_PWM_ERROR;
-  }
-
-  rc = usp_pwm_disable(throttle->lbt_pwm_left);
-  if (rc != 0) {
-    rc_out = LB_PWM_ERROR;
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    rc = ops->lbp_set_func(throttle, i, LB_POWER_C(0));
+    if (rc != LB_OK) {
+      rc_out = LB_PWM_ERROR;
+    }
+    throttle->lbt_written[i] = LB_POWER_C(0);
   }
+  throttle->lbt_written_power = LB_POWER_C(0);
 
-  rc = usp_pwm_disable(throttle->lbt_pwm_right);
-  if (rc != 0) {
-    rc_out = LB_PWM_ERROR;
+  for (i = 0; i < LB_THROTTLE_CHANNELS; i++) {
+    rc = ops->lbp_disable_func(throttle, i);
+    if (rc != LB_OK) {
+      rc_out = LB_PWM_ERROR;
+    }
   }
 
   return rc_out;
@@ -0,0 +1,25 @@
+/**
+ * @file trace.c
+ * @brief The semaphores behind the static tracepoints. The tracer finds
+ * them through the probe notes and bumps them while it is attached.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include "trace.h"
+
+#ifdef LB_HAVE_SDT
+
+#define LB_TRACE_DEFINE(name)                                                 \
+  volatile unsigned short LB_TRACE_SEMAPHORE(name)                            \
+      __attribute__((section(".probes"))) = 0;
+LB_TRACE_PROBES(LB_TRACE_DEFINE)
+#undef LB_TRACE_DEFINE
+
+#else
+
+/* Keep the translation unit from being empty. */
+typedef int lb_trace_unused_t;
+
+#endif
@@ -0,0 +1,222 @@
+/**
+ * @file uplink.c
+ * @brief Telemetry sent back to the remote over the comm link.
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "channel.h"
+#include "comm.h"
+#include "comm_internal.h"
+#include "errors.h"
+
+/**
+ * @brief Get the time on the monotonic clock.
+ *
+ * @return The time in nanoseconds.
+ */
+static uint64_t
+lb_uplink_now_ns()
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Format one record the same way the remote sends them, so the
+ * remote can route it through its own channel registry.
+ *
+ * @param id The channel id.
+ * @param slot The slot holding the value.
+ * @param buf The buffer to format into.
+ * @param len The room left in the buffer.
+ *
+ * @return The length of the record, or 0 if it doesn't fit.
+ */
+static size_t
+lb_uplink_format(unsigned int id, const struct lb_comm_uplink_slot_t *slot,
+                 char *buf, size_t len)
+{
+  int size;
+  const union lb_channel_value_t *value = &(slot->lbcus_value);
+
+  switch (slot->lbcus_type) {
+  case LB_CHANNEL_TYPE_POWER:
+    size = snprintf(buf, len, "%u:%.2f\n", id,
+                    (double)LB_POWER_TO_FLOAT(value->lbcv_power));
+    break;
+  case LB_CHANNEL_TYPE_FLOAT:
+    size = snprintf(buf, len, "%u:%g\n", id, (double)value->lbcv_float);
+    break;
+  case LB_CHANNEL_TYPE_INT:
+    size = snprintf(buf, len, "%u:%d\n", id, (int)value->lbcv_int);
+    break;
+  case LB_CHANNEL_TYPE_BOOL:
+    size = snprintf(buf, len, "%u:%d\n", id, value->lbcv_bool ? 1 : 0);
+    break;
+  default:
+    return 0;
+  }
+
+  if (size < 0 || (size_t)size >= len)
+    return 0;
+
+  return (size_t)size;
+}
+
+/**
+ * @brief Queue a telemetry value for the remote. Only the newest value
+ * per channel id is kept, so publishing never blocks or grows memory no
+ * matter how slow the link is.
+ *
+ * @param comm The comm to send on.
+ * @param id The channel id, from 0 up to LB_CHANNELS_MAX.
+ * @param type The type of the value.
+ * @param value The value.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_uplink_publish(struct lb_comm_t *comm, unsigned int id,
+                       enum lb_channel_type_t type,
+                       const union lb_channel_value_t *value)
+{
+  struct lb_comm_uplink_t *uplink = &(comm->lbc_uplink);
+  struct lb_comm_uplink_slot_t *slot;
+
+  if (id >= LB_CHANNELS_MAX)
+    return LB_NOT_FOUND;
+
+  pthread_mutex_lock(&(uplink->lbcu_mutex));
+  slot = &(uplink->lbcu_slots[id]);
+  if (slot->lbcus_dirty)
+    uplink->lbcu_stats.lbus_coalesced++;
+  slot->lbcus_dirty = true;
+  slot->lbcus_type = type;
+  slot->lbcus_value = *value;
+  pthread_mutex_unlock(&(uplink->lbcu_mutex));
+
+  return LB_OK;
+}
+
+/**
+ * @brief Send as much pending telemetry as the link takes right now.
+ * Finishes the frame in flight first, then builds a new one from the
+ * dirty slots if the rate limit allows. Never blocks on the link.
+ *
+ * @param comm The comm to send on.
+ *
+ * @return A status code. LB_RETRY if the link is full and a frame is
+ * still waiting.
+ */
+int
+lb_comm_uplink_flush(struct lb_comm_t *comm)
+{
+  int rc = LB_OK;
+  unsigned int id;
+  size_t size, records = 0;
+  uint64_t now_ns;
+  struct lb_comm_uplink_t *uplink = &(comm->lbc_uplink);
+  struct lb_comm_uplink_slot_t *slot;
+
+  if (comm->lbc_write_func == NULL)
+    return LB_NOT_SUPPORTED;
+
+  pthread_mutex_lock(&(uplink->lbcu_mutex));
+
+  if (uplink->lbcu_out_start == uplink->lbcu_out_end) {
+    now_ns = lb_uplink_now_ns();
+    if (uplink->lbcu_last_ns != 0 &&
+        now_ns - uplink->lbcu_last_ns < uplink->lbcu_interval_ns)
+      goto out;
+
+    uplink->lbcu_out_start = 0;
+    uplink->lbcu_out_end = 0;
+    for (id = 0; id < LB_CHANNELS_MAX; id++) {
+      slot = &(uplink->lbcu_slots[id]);
+      if (!slot->lbcus_dirty)
+        continue;
+
+      size = lb_uplink_format(id, slot,
+                              uplink->lbcu_out + uplink->lbcu_out_end,
+                              LB_COMM_UPLINK_BUF_SIZE - uplink->lbcu_out_end);
+      if (size == 0)
+        break;
+
+      /* Anything that didn't fit stays dirty for the next frame. */
+      slot->lbcus_dirty = false;
+      uplink->lbcu_out_end += size;
+      records++;
+    }
+
+    if (records == 0)
+      goto out;
+
+    uplink->lbcu_last_ns = now_ns;
+    uplink->lbcu_stats.lbus_frames++;
+    uplink->lbcu_stats.lbus_records += records;
+  }
+
+  rc = comm->lbc_write_func(comm, uplink->lbcu_out + uplink->lbcu_out_start,
+                            uplink->lbcu_out_end - uplink->lbcu_out_start,
+                            &size);
+  if (rc == LB_COMM_ERROR) {
+    /* The frame is lost with the link, start clean on the next one. */
+    uplink->lbcu_out_start = 0;
+    uplink->lbcu_out_end = 0;
+    goto out;
+  }
+
+  uplink->lbcu_out_start += size;
+  uplink->lbcu_stats.lbus_bytes += size;
+  if (uplink->lbcu_out_start != uplink->lbcu_out_end) {
+    uplink->lbcu_stats.lbus_blocked++;
+    rc = LB_RETRY;
+  }
+
+out:
+  pthread_mutex_unlock(&(uplink->lbcu_mutex));
+  return rc;
+}
+
+/**
+ * @brief Set the shortest time between telemetry frames.
+ *
+ * @param comm The comm to change.
+ * @param interval_ns The interval in nanoseconds, 0 for no limit.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_uplink_interval_set(struct lb_comm_t *comm, uint64_t interval_ns)
+{
+  pthread_mutex_lock(&(comm->lbc_uplink.lbcu_mutex));
+  comm->lbc_uplink.lbcu_interval_ns = interval_ns;
+  pthread_mutex_unlock(&(comm->lbc_uplink.lbcu_mutex));
+  return LB_OK;
+}
+
+/**
+ * @brief Get a snapshot of the telemetry counters.
+ *
+ * @param comm The comm to check.
+ * @param out_stats The counters to fill in.
+ *
+ * @return A status code.
+ */
+int
+lb_comm_uplink_stats_get(struct lb_comm_t *comm,
+                         struct lb_comm_uplink_stats_t *out_stats)
+{
+  pthread_mutex_lock(&(comm->lbc_uplink.lbcu_mutex));
+  *out_stats = comm->lbc_uplink.lbcu_stats;
+  pthread_mutex_unlock(&(comm->lbc_uplink.lbcu_mutex));
+  return LB_OK;
+}
@@ -0,0 +1,270 @@
+/**
+ * @file uring.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "errors.h"
+#include "uring.h"
+
+#ifdef LB_HAVE_IO_URING
+
+/**
+ * @brief The buffer group our receive buffers are registered under.
+ */
+#define LB_URING_BGID 0
+
+/**
+ * @brief Hand a receive buffer back to the kernel.
+ *
+ * @param uring The engine the buffer belongs to.
+ * @param bid The id of the buffer.
+ */
+static void
+lb_uring_recycle(struct lb_uring_t *uring, uint16_t bid)
+{
+  io_uring_buf_ring_add(uring->lbu_buf_ring, uring->lbu_bufs[bid],
+                        LB_URING_BUF_SIZE, bid,
+                        io_uring_buf_ring_mask(LB_URING_BUFS), 0);
+  io_uring_buf_ring_advance(uring->lbu_buf_ring, 1);
+}
+
+/**
+ * @brief Submit the multishot receive. It stays armed until the kernel
+ * runs out of buffers or the socket fails.
+ *
+ * @param uring The engine to arm.
+ *
+ * @return A status code.
+ */
+static int
+lb_uring_arm(struct lb_uring_t *uring)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = io_uring_get_sqe(&(uring->lbu_ring));
+  if (sqe == NULL) {
+    return LB_COMM_ERROR;
+  }
+
+  io_uring_prep_recv_multishot(sqe, uring->lbu_fd, NULL, 0, 0);
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = LB_URING_BGID;
+
+  if (io_uring_submit(&(uring->lbu_ring)) < 0) {
+    return LB_COMM_ERROR;
+  }
+
+  uring->lbu_armed = true;
+  return LB_OK;
+}
+
+#endif /* LB_HAVE_IO_URING */
+
+/**
+ * @brief Set up an io_uring engine for reading a socket.
+ *
+ * @param uring The engine to set up.
+ * @param fd The socket to read.
+ *
+ * @return LB_OK, or LB_NOT_SUPPORTED when io_uring isn't available, in
+ * which case the caller should read the socket itself.
+ */
+int
+lb_uring_init(struct lb_uring_t *uring, int fd)
+{
+#ifdef LB_HAVE_IO_URING
+  int rc, i;
+
+  memset(uring, 0, sizeof(struct lb_uring_t));
+  uring->lbu_fd = fd;
+
+  /* Old kernels and seccomp filters both fail here. */
+  rc = io_uring_queue_init(LB_URING_BUFS, &(uring->lbu_ring), 0);
+  if (rc < 0) {
+    return LB_NOT_SUPPORTED;
+  }
+
+  uring->lbu_buf_ring = io_uring_setup_buf_ring(&(uring->lbu_ring),
+                                                LB_URING_BUFS, LB_URING_BGID,
+                                                0, &rc);
+  if (uring->lbu_buf_ring == NULL) {
+    io_uring_queue_exit(&(uring->lbu_ring));
+    return LB_NOT_SUPPORTED;
+  }
+
+  for (i = 0; i < LB_URING_BUFS; i++) {
+    io_uring_buf_ring_add(uring->lbu_buf_ring, uring->lbu_bufs[i],
+                          LB_URING_BUF_SIZE, (unsigned short)i,
+                          io_uring_buf_ring_mask(LB_URING_BUFS), i);
+  }
+  io_uring_buf_ring_advance(uring->lbu_buf_ring, LB_URING_BUFS);
+
+  uring->lbu_active = true;
+  if (lb_uring_arm(uring) != LB_OK) {
+    lb_uring_deinit(uring);
+    return LB_NOT_SUPPORTED;
+  }
+
+  return LB_OK;
+#else
+  (void)fd;
+  memset(uring, 0, sizeof(struct lb_uring_t));
+  return LB_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Tear down an io_uring engine. Safe to call on an engine that
+ * failed to set up.
+ *
+ * @param uring The engine to tear down.
+ */
+void
+lb_uring_deinit(struct lb_uring_t *uring)
+{
+#ifdef LB_HAVE_IO_URING
+  if (uring->lbu_active) {
+    io_uring_free_buf_ring(&(uring->lbu_ring), uring->lbu_buf_ring,
+                           LB_URING_BUFS, LB_URING_BGID);
+    io_uring_queue_exit(&(uring->lbu_ring));
+  }
+#endif
+  uring->lbu_active = false;
+}
+
+/**
+ * @brief Read whatever the socket has received, waiting for it if
+ * nothing has arrived yet.
+ *
+ * @param uring The engine to read from.
+ * @param buf The buffer to read into.
+ * @param len The size of the buffer.
+ * @param out_len The number of bytes read.
+ *
+ * @return A status code. LB_NOT_SUPPORTED means the kernel can't do a
+ * multishot receive, and the caller should fall back to read().
+ */
+int
+lb_uring_recv(struct lb_uring_t *uring, char *buf, size_t len,
+              size_t *out_len)
+{
+#ifdef LB_HAVE_IO_URING
+  int rc, res;
+  unsigned int flags;
+  struct io_uring_cqe *cqe;
+  struct __kernel_timespec timeout;
+
+  if (!uring->lbu_active) {
+    return LB_NOT_SUPPORTED;
+  }
+
+  while (!uring->lbu_pending) {
+    if (!uring->lbu_armed && lb_uring_arm(uring) != LB_OK) {
+      return LB_COMM_ERROR;
+    }
+
+    timeout.tv_sec = LB_URING_TIMEOUT_SEC;
+    timeout.tv_nsec = 0;
+
+    /* Doesn't enter the kernel when a completion is already waiting. */
+    rc = io_uring_wait_cqe_timeout(&(uring->lbu_ring), &cqe, &timeout);
+    if (rc < 0) {
+      return LB_COMM_ERROR;
+    }
+
+    res = cqe->res;
+    flags = cqe->flags;
+    io_uring_cqe_seen(&(uring->lbu_ring), cqe);
+
+    if (!(flags & IORING_CQE_F_MORE)) {
+      uring->lbu_armed = false;
+    }
+
+    if (res == -EINVAL || res == -EOPNOTSUPP) {
+      /* No multishot receive on this kernel. */
+      return LB_NOT_SUPPORTED;
+    } else if (res == -ENOBUFS) {
+      /* We were slow to hand buffers back, just rearm. */
+      continue;
+    } else if (res <= 0) {
+      return LB_COMM_ERROR;
+    }
+
+    uring->lbu_pending = true;
+    uring->lbu_pending_bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+    uring->lbu_pending_off = 0;
+    uring->lbu_pending_len = (size_t)res;
+  }
+
+  *out_len = uring->lbu_pending_len - uring->lbu_pending_off;
+  if (*out_len > len) {
+    *out_len = len;
+  }
+
+  memcpy(buf, uring->lbu_bufs[uring->lbu_pending_bid] +
+         uring->lbu_pending_off, *out_len);
+  uring->lbu_pending_off += *out_len;
+
+  if (uring->lbu_pending_off == uring->lbu_pending_len) {
+    lb_uring_recycle(uring, uring->lbu_pending_bid);
+    uring->lbu_pending = false;
+  }
+
+  return LB_OK;
+#else
+  (void)uring;
+  (void)buf;
+  (void)len;
+  (void)out_len;
+  return LB_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Read a socket through an io_uring engine when it is active,
+ * and with read() otherwise. An engine the kernel turns down is torn
+ * down, so every later read goes straight to read().
+ *
+ * @param uring The engine set up on the socket.
+ * @param fd The socket to read.
+ * @param buf The buffer to read into.
+ * @param len The size of the buffer.
+ * @param out_len The number of bytes read.
+ *
+ * @return A status code.
+ */
+int
+lb_uring_read(struct lb_uring_t *uring, int fd, char *buf, size_t len,
+              size_t *out_len)
+{
+  int rc;
+  ssize_t size_read;
+
+  if (uring->lbu_active) {
+    rc = lb_uring_recv(uring, buf, len, out_len);
+    if (rc != LB_NOT_SUPPORTED) {
+      return rc;
+    }
+
+    /* The kernel turned us down, read the socket directly from now on. */
+    lb_uring_deinit(uring);
+  }
+
+  size_read = read(fd, buf, len);
+  if (size_read <= 0) {
+    /*
+     * Failed reading somewhere. This is probably a socket error.
+     */
+    return LB_COMM_ERROR;
+  }
+
+  *out_len = (size_t)size_read;
+  return LB_OK;
+}
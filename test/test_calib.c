@@ -0,0 +1,213 @@
+/*
+ * @file test_calib.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "calib.h"
+#include "errors.h"
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+/* Interpolation error, well under what a pwm can resolve. */
+#define TEST_CALIB_TOLERANCE LB_POWER_C(0.05)
+
+static bool
+test_calib_near(lb_power_t actual, lb_power_t expected)
+{
+  lb_power_t diff = actual - expected;
+  return diff <= TEST_CALIB_TOLERANCE && diff >= -TEST_CALIB_TOLERANCE;
+}
+
+START_TEST(test_calib_curve)
+{
+  int rc, i;
+  lb_power_t power, duty, last = LB_POWER_C(0);
+  struct lb_calib_t calib;
+  struct lb_calib_params_t params;
+
+  lb_calib_linear(&calib);
+  fail_if(lb_calib_eval(&calib, LB_POWER_C(33.3)) != LB_POWER_C(33.3),
+          "Linear curve changed the power.");
+
+  lb_calib_params_default(&params);
+  params.lbcp_dead_zone = LB_POWER_C(10);
+  params.lbcp_duty_max = LB_POWER_C(90);
+  rc = lb_calib_curve(&calib, &params);
+  fail_if(rc != LB_OK, "Failed to build a dead zone curve.");
+  fail_if(!lb_calib_valid(&calib), "Built an invalid curve.");
+  fail_if(lb_calib_eval(&calib, LB_POWER_C(0)) != LB_POWER_C(0),
+          "Zero power should stay off.");
+  fail_if(!test_calib_near(lb_calib_eval(&calib, LB_POWER_C(50)),
+                           LB_POWER_C(50)), "Dead zone curve is off.");
+  fail_if(!test_calib_near(lb_calib_eval(&calib, LB_POWER_C(100)),
+                           LB_POWER_C(90)), "Duty max wasn't applied.");
+  fail_if(!test_calib_near(lb_calib_eval(&calib, LB_POWER_C(150)),
+                           LB_POWER_C(90)), "Power over full wasn't clamped.");
+
+  /* Every power should come back from the duty cycle it maps to. */
+  for (i = 1; i <= 100; i++) {
+    power = LB_POWER_C(1) * i;
+    duty = lb_calib_eval(&calib, power);
+    fail_if(duty < last, "Curve went down.");
+    fail_if(!test_calib_near(lb_calib_invert(&calib, duty), power),
+            "Inverting the curve is off.");
+    last = duty;
+  }
+
+  params.lbcp_expo = LB_POWER_C(1.0);
+  rc = lb_calib_curve(&calib, &params);
+  fail_if(rc != LB_OK, "Failed to build an expo curve.");
+  fail_if(!test_calib_near(lb_calib_eval(&calib, LB_POWER_C(50)),
+                           LB_POWER_C(20)), "Expo curve is off.");
+
+  params.lbcp_dead_zone = LB_POWER_C(95);
+  rc = lb_calib_curve(&calib, &params);
+  fail_if(rc == LB_OK, "Accepted a dead zone above the duty max.");
+}
+END_TEST
+
+START_TEST(test_calib_load)
+{
+  int rc, fd;
+  char path[] = "/tmp/test_calib_XXXXXX";
+  const char *table = "# power duty\n0 0\n\n20, 15\n100\t100";
+  const char *broken = "0 0\n50 40\n60 30\n";
+  struct lb_calib_t calib;
+
+  fd = mkstemp(path);
+  fail_if(fd < 0, "Failed to create a calibration file.");
+  fail_if(write(fd, table, strlen(table)) != (ssize_t)strlen(table),
+          "Failed to write the calibration file.");
+
+  rc = lb_calib_load(&calib, path);
+  fail_if(rc != LB_OK, "Failed to load the calibration file.");
+  fail_if(!test_calib_near(lb_calib_eval(&calib, LB_POWER_C(10)),
+                           LB_POWER_C(7.5)), "Loaded curve is off low.");
+  fail_if(!test_calib_near(lb_calib_eval(&calib, LB_POWER_C(60)),
+                           LB_POWER_C(57.5)), "Loaded curve is off high.");
+
+  /* Duty cycles that go down are refused. */
+  fail_if(ftruncate(fd, 0) != 0, "Failed to truncate the file.");
+  fail_if(pwrite(fd, broken, strlen(broken), 0) != (ssize_t)strlen(broken),
+          "Failed to write the calibration file.");
+  rc = lb_calib_load(&calib, path);
+  fail_if(rc == LB_OK, "Loaded a curve that goes down.");
+
+  close(fd);
+  unlink(path);
+
+  rc = lb_calib_load(&calib, path);
+  fail_if(rc != LB_NOT_FOUND, "Loaded a missing file.");
+}
+END_TEST
+
+START_TEST(test_calib_table)
+{
+  int rc;
+  struct lb_calib_t calib;
+  lb_power_t powers[] = { LB_POWER_C(0), LB_POWER_C(50), LB_POWER_C(100) };
+  lb_power_t idle[] = { LB_POWER_C(5), LB_POWER_C(50), LB_POWER_C(100) };
+  lb_power_t full[] = { LB_POWER_C(100), LB_POWER_C(100), LB_POWER_C(100) };
+  lb_power_t off[] = { LB_POWER_C(0), LB_POWER_C(0), LB_POWER_C(0) };
+  lb_power_t late[] = { LB_POWER_C(0), LB_POWER_C(0), LB_POWER_C(80) };
+
+  /* Zero power has to be off, and full power has to be more than off. */
+  rc = lb_calib_table(&calib, powers, idle, 3);
+  fail_if(rc == LB_OK, "Accepted a table that idles above zero.");
+  rc = lb_calib_table(&calib, powers, full, 3);
+  fail_if(rc == LB_OK, "Accepted a table that is always full.");
+  rc = lb_calib_table(&calib, powers, off, 3);
+  fail_if(rc == LB_OK, "Accepted a table that is always off.");
+
+  rc = lb_calib_table(&calib, powers, late, 3);
+  fail_if(rc != LB_OK, "Failed to build a table with a dead band.");
+  fail_if(!lb_calib_valid(&calib), "Built an invalid table.");
+
+  /* The same goes for curves filled in by hand. */
+  calib.lbc_duty[0] = LB_POWER_C(1);
+  fail_if(lb_calib_valid(&calib), "Accepted a curve that idles above zero.");
+  memset(&calib, 0, sizeof(calib));
+  fail_if(lb_calib_valid(&calib), "Accepted a curve that is always off.");
+}
+END_TEST
+
+START_TEST(test_calib_throttle)
+{
+  int rc, i;
+  lb_power_t power;
+  struct lb_sim_params_t params;
+  struct lb_calib_params_t curve;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_throttle_config_t config;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_start_pwms(throttle);
+
+  lb_throttle_config_get(throttle, &config);
+  config.lbtc_ramp_per_sec = LB_POWER_C(100);
+  lb_calib_params_default(&curve);
+  curve.lbcp_dead_zone = LB_POWER_C(10);
+  lb_calib_curve(&(config.lbtc_calib[LB_THROTTLE_RIGHT]), &curve);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc != 0, "Failed to set a calibrated config.");
+
+  lb_throttle_request_set(throttle, LB_POWER_C(50));
+  for (i = 0; i < 10; i++)
+    lb_throttle_tick(throttle);
+
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0, "Calibrated channel failed readback.");
+  fail_if(power != LB_POWER_C(50), "Throttle didn't reach the target.");
+  fail_if(throttle->lbt_written[LB_THROTTLE_LEFT] != LB_POWER_C(50),
+          "Uncalibrated channel was changed.");
+  fail_if(!test_calib_near(throttle->lbt_written[LB_THROTTLE_RIGHT],
+                           LB_POWER_C(55)), "Calibration wasn't applied.");
+
+  config.lbtc_calib[LB_THROTTLE_RIGHT].lbc_duty[1] = LB_POWER_C(120);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc == 0, "Accepted an invalid curve.");
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+Suite *
+suite_calib_new()
+{
+  Suite *suite = suite_create("suite_calib");
+
+  TCase *case_cc = tcase_create("test_calib_curve");
+  tcase_add_test(case_cc, test_calib_curve);
+  tcase_add_test(case_cc, test_calib_load);
+  tcase_add_test(case_cc, test_calib_table);
+  tcase_add_test(case_cc, test_calib_throttle);
+
+  suite_add_tcase(suite, case_cc);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_calib_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
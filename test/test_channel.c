@@ -0,0 +1,426 @@
+/*
+ * @file test_channel.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/socket.h>
+
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "channel.h"
+#include "comm.h"
+#include "errors.h"
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+#include "uring.h"
+
+#define CHANNEL_VOLTAGE 1
+#define CHANNEL_MODE 2
+
+static void
+test_channel_count(unsigned int id, const union lb_channel_value_t *value,
+                   void *ctx)
+{
+  int *count = ctx;
+
+  (void)id;
+  (void)value;
+  (*count)++;
+}
+
+START_TEST(test_channel_dispatch)
+{
+  int rc, count = 0;
+  char record[32];
+  uint32_t seq;
+  union lb_channel_value_t value;
+  struct lb_channels_t *channels = lb_channels_new();
+
+  rc = lb_channels_register(channels, CHANNEL_VOLTAGE, LB_CHANNEL_TYPE_FLOAT,
+                            LB_CHANNEL_LATEST);
+  fail_if(rc != 0, "Failed to register a channel.");
+  rc = lb_channels_register(channels, CHANNEL_MODE, LB_CHANNEL_TYPE_INT,
+                            LB_CHANNEL_QUEUE);
+  fail_if(rc != 0, "Failed to register a channel.");
+  rc = lb_channels_subscribe(channels, CHANNEL_MODE, test_channel_count,
+                             &count);
+  fail_if(rc != 0, "Failed to subscribe.");
+
+  rc = lb_channels_latest_get(channels, LB_CHANNEL_POWER, &value, NULL);
+  fail_if(rc != LB_RETRY, "Power channel had a value before any record.");
+
+  /* Bare numbers are power levels. */
+  strcpy(record, "42");
+  rc = lb_channels_dispatch(channels, record);
+  fail_if(rc != 0, "Failed to dispatch a power record.");
+  rc = lb_channels_latest_get(channels, LB_CHANNEL_POWER, &value, &seq);
+  fail_if(rc != 0 || value.lbcv_power != LB_POWER_C(42) || seq != 1,
+          "Power channel has the wrong value.");
+
+  strcpy(record, "1:36.5");
+  lb_channels_dispatch(channels, record);
+  strcpy(record, "1:37.5");
+  lb_channels_dispatch(channels, record);
+  rc = lb_channels_latest_get(channels, CHANNEL_VOLTAGE, &value, &seq);
+  fail_if(rc != 0 || value.lbcv_float != 37.5f || seq != 2,
+          "Latest channel didn't keep the newest value.");
+
+  strcpy(record, "2:1");
+  lb_channels_dispatch(channels, record);
+  strcpy(record, "2:3");
+  lb_channels_dispatch(channels, record);
+  fail_if(count != 2, "Subscriber saw %d values.", count);
+
+  rc = lb_channels_queue_pop(channels, CHANNEL_MODE, &value);
+  fail_if(rc != 0 || value.lbcv_int != 1, "Queue is out of order.");
+  rc = lb_channels_queue_pop(channels, CHANNEL_MODE, &value);
+  fail_if(rc != 0 || value.lbcv_int != 3, "Queue is out of order.");
+  rc = lb_channels_queue_pop(channels, CHANNEL_MODE, &value);
+  fail_if(rc != LB_RETRY, "Popped from an empty queue.");
+
+  strcpy(record, "9:1");
+  rc = lb_channels_dispatch(channels, record);
+  fail_if(rc != LB_NOT_FOUND, "Dispatched to an unregistered channel.");
+  strcpy(record, "1:volts");
+  rc = lb_channels_dispatch(channels, record);
+  fail_if(rc != LB_PARSE_ERROR, "Dispatched a malformed record.");
+  fail_if(lb_channels_dropped(channels) != 2, "Drops weren't counted.");
+
+  lb_channels_delete(channels);
+}
+END_TEST
+
+START_TEST(test_channel_pump)
+{
+  int rc;
+  const char *burst = "2:1\n2:2\n1:40\n55\n2:3\n";
+  union lb_channel_value_t value;
+  struct lb_channels_t *channels = lb_channels_new();
+  struct lb_comm_t *comm = lb_comm_loopback_new();
+
+  lb_channels_register(channels, CHANNEL_VOLTAGE, LB_CHANNEL_TYPE_FLOAT,
+                       LB_CHANNEL_LATEST);
+  lb_channels_register(channels, CHANNEL_MODE, LB_CHANNEL_TYPE_INT,
+                       LB_CHANNEL_QUEUE);
+
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  fail_if(write(lb_comm_loopback_writer(comm), burst, strlen(burst)) !=
+          (ssize_t)strlen(burst), "Failed to write the burst.");
+
+  /* One pump handles the whole burst. */
+  rc = lb_comm_pump(comm, channels);
+  fail_if(rc != 0, "Failed to pump the comm.");
+
+  rc = lb_channels_latest_get(channels, LB_CHANNEL_POWER, &value, NULL);
+  fail_if(rc != 0 || value.lbcv_power != LB_POWER_C(55),
+          "Power wasn't routed.");
+  rc = lb_channels_latest_get(channels, CHANNEL_VOLTAGE, &value, NULL);
+  fail_if(rc != 0 || value.lbcv_float != 40.0f, "Voltage wasn't routed.");
+  rc = lb_channels_queue_pop(channels, CHANNEL_MODE, &value);
+  fail_if(rc != 0 || value.lbcv_int != 1, "Mode queue is out of order.");
+
+  lb_comm_delete(comm);
+  lb_channels_delete(channels);
+}
+END_TEST
+
+START_TEST(test_channel_uplink)
+{
+  int rc, writer;
+  char buf[64];
+  ssize_t size;
+  union lb_channel_value_t value;
+  struct lb_comm_uplink_stats_t stats;
+  struct lb_channels_t *channels = lb_channels_new();
+  struct lb_comm_t *comm = lb_comm_loopback_new();
+
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  writer = lb_comm_loopback_writer(comm);
+
+  value.lbcv_float = 36.5f;
+  lb_comm_uplink_publish(comm, CHANNEL_VOLTAGE, LB_CHANNEL_TYPE_FLOAT, &value);
+  value.lbcv_float = 36.0f;
+  lb_comm_uplink_publish(comm, CHANNEL_VOLTAGE, LB_CHANNEL_TYPE_FLOAT, &value);
+  value.lbcv_int = 3;
+  lb_comm_uplink_publish(comm, CHANNEL_MODE, LB_CHANNEL_TYPE_INT, &value);
+
+  /* Telemetry goes out behind the inbound power level. */
+  fail_if(write(writer, "50\n", 3) != 3, "Failed to write power.");
+  rc = lb_comm_pump(comm, channels);
+  fail_if(rc != 0, "Failed to pump the comm.");
+
+  size = recv(writer, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+  fail_if(size <= 0, "No telemetry was sent.");
+  buf[size] = '\0';
+  fail_if(strcmp(buf, "1:36\n2:3\n") != 0, "Telemetry frame is wrong.");
+
+  /* Too soon for another frame. */
+  value.lbcv_float = 37.0f;
+  lb_comm_uplink_publish(comm, CHANNEL_VOLTAGE, LB_CHANNEL_TYPE_FLOAT, &value);
+  lb_comm_uplink_flush(comm);
+  fail_if(recv(writer, buf, sizeof(buf), MSG_DONTWAIT) > 0,
+          "Telemetry wasn't rate limited.");
+
+  lb_comm_uplink_interval_set(comm, 0);
+  rc = lb_comm_uplink_flush(comm);
+  fail_if(rc != 0, "Failed to flush telemetry.");
+  size = recv(writer, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+  fail_if(size <= 0, "Held telemetry wasn't sent.");
+  buf[size] = '\0';
+  fail_if(strcmp(buf, "1:37\n") != 0, "Held telemetry is wrong.");
+
+  lb_comm_uplink_stats_get(comm, &stats);
+  fail_if(stats.lbus_frames != 2 || stats.lbus_records != 3,
+          "Frame counts are off.");
+  fail_if(stats.lbus_coalesced != 1, "Coalesced count is off.");
+
+  lb_comm_delete(comm);
+  lb_channels_delete(channels);
+}
+END_TEST
+
+START_TEST(test_channel_telemetry)
+{
+  int rc, i, writer;
+  char buf[64];
+  ssize_t size;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_channels_t *channels = lb_channels_new();
+  struct lb_comm_t *comm = lb_comm_loopback_new();
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_start_pwms(throttle);
+  lb_throttle_request_set(throttle, LB_POWER_C(20));
+  for (i = 0; i < 5; i++)
+    lb_throttle_tick(throttle);
+
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  writer = lb_comm_loopback_writer(comm);
+  lb_comm_uplink_interval_set(comm, 0);
+
+  rc = lb_throttle_telemetry_publish(throttle, comm);
+  fail_if(rc != 0, "Failed to publish throttle telemetry.");
+
+  /* Nothing comes in, but the telemetry still goes out. */
+  shutdown(writer, SHUT_WR);
+  rc = lb_comm_pump(comm, channels);
+  fail_if(rc == 0, "Pumped a closed link.");
+  size = recv(writer, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+  fail_if(size <= 0, "Telemetry wasn't flushed after a failed read.");
+  buf[size] = '\0';
+  fail_if(strcmp(buf, "13:10.00\n14:20.00\n15:0\n") != 0,
+          "Throttle telemetry is wrong.");
+
+  lb_comm_delete(comm);
+  lb_channels_delete(channels);
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_channel_get_power)
+{
+  int rc, writer;
+  unsigned int id;
+  char record[32], *value_str;
+  lb_power_t power;
+  union lb_channel_value_t value;
+  struct lb_comm_t *comm = lb_comm_loopback_new();
+  const char *stream = "1:36.5\n2:3\n0:40\n1:36.5abc\n55abc\n:5\n25 \n";
+
+  /* Values must be the whole record. */
+  fail_if(lb_channel_parse(LB_CHANNEL_TYPE_FLOAT, "36.5abc", &value) == 0,
+          "Parsed a float with trailing text.");
+  fail_if(lb_channel_parse(LB_CHANNEL_TYPE_POWER, "36.5abc", &value) == 0,
+          "Parsed a power with trailing text.");
+  rc = lb_channel_parse(LB_CHANNEL_TYPE_INT, " 12 ", &value);
+  fail_if(rc != 0 || value.lbcv_int != 12, "Whitespace wasn't allowed.");
+  strcpy(record, ":5");
+  fail_if(lb_channel_split(record, &id, &value_str) == 0,
+          "Split a record without a channel id.");
+  strcpy(record, "12:5");
+  rc = lb_channel_split(record, &id, &value_str);
+  fail_if(rc != 0 || id != 12 || strcmp(value_str, "5") != 0,
+          "Split a record wrong.");
+
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  writer = lb_comm_loopback_writer(comm);
+  fail_if(write(writer, stream, strlen(stream)) != (ssize_t)strlen(stream),
+          "Failed to write the stream.");
+
+  /* Only the power channel's records are power levels. */
+  fail_if(lb_comm_get_power(comm, &power) != LB_RETRY,
+          "Read another channel as power.");
+  fail_if(lb_comm_get_power(comm, &power) != LB_RETRY,
+          "Read another channel as power.");
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != 0 || power != LB_POWER_C(40), "Missed a power record.");
+  fail_if(lb_comm_get_power(comm, &power) != LB_RETRY,
+          "Read a record with trailing text.");
+  fail_if(lb_comm_get_power(comm, &power) != LB_RETRY,
+          "Read a bare value with trailing text.");
+  fail_if(lb_comm_get_power(comm, &power) != LB_RETRY,
+          "Read a record without a channel id.");
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != 0 || power != LB_POWER_C(25), "Missed a bare power level.");
+
+  lb_comm_delete(comm);
+}
+END_TEST
+
+START_TEST(test_channel_overflow)
+{
+  int rc, writer;
+  char line[160];
+  lb_power_t power;
+  struct lb_comm_t *comm = lb_comm_loopback_new();
+
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  writer = lb_comm_loopback_writer(comm);
+  rc = lb_comm_open(comm);
+  fail_if(rc == 0, "Opened a loopback comm twice.");
+  fail_if(lb_comm_loopback_writer(comm) != writer, "Reopen lost the writer.");
+
+  /* The tail of a line too long to buffer mustn't be read as a line. */
+  memset(line, ' ', sizeof(line));
+  memcpy(line + sizeof(line) - 3, "55\n", 3);
+  fail_if(write(writer, line, sizeof(line)) != (ssize_t)sizeof(line),
+          "Failed to write the long line.");
+  fail_if(write(writer, "42\n", 3) != 3, "Failed to write power.");
+
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != LB_RETRY, "Overlong line wasn't dropped.");
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != 0, "Failed to read the line after the long one.");
+  fail_if(power != LB_POWER_C(42), "Read the tail of the long line.");
+
+  lb_comm_delete(comm);
+}
+END_TEST
+
+START_TEST(test_channel_reopen)
+{
+  int rc, writer, i;
+  char buf[64];
+  lb_power_t power;
+  union lb_channel_value_t value = { .lbcv_int = 0 };
+  struct lb_comm_t *comm = lb_comm_loopback_new();
+
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  lb_comm_uplink_interval_set(comm, 0);
+
+  /* The link drops partway through a line. */
+  writer = lb_comm_loopback_writer(comm);
+  fail_if(write(writer, "5", 1) != 1, "Failed to write power.");
+  shutdown(writer, SHUT_WR);
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != LB_COMM_ERROR, "Dropped link wasn't an error.");
+
+  /* And partway through a telemetry frame, with nobody reading. */
+  for (i = 0; i < 100000; i++) {
+    value.lbcv_int = i;
+    lb_comm_uplink_publish(comm, 1, LB_CHANNEL_TYPE_INT, &value);
+    if (lb_comm_uplink_flush(comm) == LB_RETRY)
+      break;
+  }
+  fail_if(i == 100000, "Failed to fill the link.");
+
+  lb_comm_close(comm);
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to reopen the loopback comm.");
+
+  /* Neither half carries over to the new connection. */
+  writer = lb_comm_loopback_writer(comm);
+  fail_if(write(writer, "0\n", 2) != 2, "Failed to write power.");
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != 0, "Failed to read power after reopening.");
+  fail_if(power != LB_POWER_C(0), "Partial line joined the next one.");
+
+  rc = lb_comm_uplink_flush(comm);
+  fail_if(rc != LB_OK, "Flush failed after reopening.");
+  fail_if(recv(writer, buf, sizeof(buf), MSG_DONTWAIT) >= 0,
+          "Rest of the old frame was sent on the new link.");
+
+  lb_comm_delete(comm);
+}
+END_TEST
+
+START_TEST(test_channel_uring_fallback)
+{
+  int rc, fds[2];
+  char buf[16];
+  size_t len;
+  struct lb_uring_t uring;
+
+  rc = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  fail_if(rc != 0, "Failed to create a socket pair.");
+
+  /* Reads work whether or not the kernel has io_uring. */
+  rc = lb_uring_init(&uring, fds[0]);
+  fail_if(rc != LB_OK && uring.lbu_active, "Failed engine was left active.");
+  fail_if(write(fds[1], "12\n", 3) != 3, "Failed to write.");
+  rc = lb_uring_read(&uring, fds[0], buf, sizeof(buf), &len);
+  fail_if(rc != LB_OK || len != 3 || memcmp(buf, "12\n", 3) != 0,
+          "Failed to read through the engine.");
+
+  /* Without an engine, reads fall back to read(). */
+  lb_uring_deinit(&uring);
+  fail_if(uring.lbu_active, "Engine is still active.");
+  fail_if(write(fds[1], "34\n", 3) != 3, "Failed to write.");
+  rc = lb_uring_read(&uring, fds[0], buf, sizeof(buf), &len);
+  fail_if(rc != LB_OK || len != 3 || memcmp(buf, "34\n", 3) != 0,
+          "Failed to read through the fallback.");
+
+  close(fds[1]);
+  rc = lb_uring_read(&uring, fds[0], buf, sizeof(buf), &len);
+  fail_if(rc != LB_COMM_ERROR, "Closed socket wasn't an error.");
+  close(fds[0]);
+}
+END_TEST
+
+Suite *
+suite_channel_new()
+{
+  Suite *suite = suite_create("suite_channel");
+
+  TCase *case_cd = tcase_create("test_channel_demux");
+  tcase_add_test(case_cd, test_channel_dispatch);
+  tcase_add_test(case_cd, test_channel_pump);
+  tcase_add_test(case_cd, test_channel_uplink);
+  tcase_add_test(case_cd, test_channel_telemetry);
+  tcase_add_test(case_cd, test_channel_get_power);
+  tcase_add_test(case_cd, test_channel_overflow);
+  tcase_add_test(case_cd, test_channel_reopen);
+  tcase_add_test(case_cd, test_channel_uring_fallback);
+
+  suite_add_tcase(suite, case_cd);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_channel_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
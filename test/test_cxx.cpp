@@ -0,0 +1,122 @@
+/*
+ * @file test_cxx.cpp
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <check.h>
+
+#include <array>
+
+#include "errors.h"
+#include "throttle.hpp"
+
+namespace {
+
+using test_config = lb::throttle_config<3, LB_THROTTLE_NSEC_SLEEP, 20>;
+using test_ramp = lb::ramp<test_config>;
+
+/* The ramp is constexpr, so its limits can be checked at compile time. */
+static_assert(test_ramp::limit == LB_POWER_C(2.0),
+              "20% a second over 100ms ticks should be 2% a tick.");
+static_assert(test_ramp::step(LB_POWER_C(0), LB_POWER_C(100)) ==
+              LB_POWER_C(2.0), "Ramped up by more than the limit.");
+static_assert(test_ramp::step(LB_POWER_C(50), LB_POWER_C(0)) ==
+              LB_POWER_C(48.0), "Ramped down by more than the limit.");
+static_assert(test_ramp::step(LB_POWER_C(99), LB_POWER_C(100)) ==
+              LB_POWER_C(100), "Didn't settle on the target.");
+
+/* Records writes, and fails the ones it's told to. */
+struct test_pwm {
+  std::array<lb_power_t, 3> duty{};
+  unsigned int writes = 0;
+  int fail_channel = -1;
+
+  int
+  set(std::size_t channel, lb_power_t value)
+  {
+    if (static_cast<int>(channel) == fail_channel)
+      return LB_PWM_ERROR;
+    duty[channel] = value;
+    writes++;
+    return LB_OK;
+  }
+};
+
+} // namespace
+
+START_TEST(test_cxx_static_throttle)
+{
+  int rc, i;
+  lb::static_throttle<test_config, test_pwm> throttle{test_pwm{}};
+
+  throttle.request_set(LB_POWER_C(150));
+  fail_if(throttle.request()[0] != LB_POWER_C(100),
+          "Request wasn't clamped.");
+
+  throttle.request_set(LB_POWER_C(10));
+  rc = throttle.request_set(1, LB_POWER_C(4));
+  fail_if(rc != LB_OK, "Failed to request one channel.");
+  rc = throttle.request_set(3, LB_POWER_C(4));
+  fail_if(rc == LB_OK, "Requested a channel that doesn't exist.");
+
+  for (i = 0; i < 5; i++) {
+    rc = throttle.tick();
+    fail_if(rc != LB_OK, "Tick failed.");
+  }
+  fail_if(throttle.pwm().duty[0] != LB_POWER_C(10), "Channel 0 is off.");
+  fail_if(throttle.pwm().duty[1] != LB_POWER_C(4), "Channel 1 is off.");
+  fail_if(throttle.pwm().writes != 12, "Wrote channels that didn't move.");
+
+  /* A failed write is retried once the pwm comes back. */
+  throttle.request_set(2, LB_POWER_C(12));
+  throttle.pwm().fail_channel = 2;
+  rc = throttle.tick();
+  fail_if(rc != LB_PWM_ERROR, "Failed write wasn't reported.");
+  fail_if(throttle.current()[2] != LB_POWER_C(10),
+          "Failed write was counted as written.");
+  throttle.pwm().fail_channel = -1;
+  rc = throttle.tick();
+  fail_if(rc != LB_OK || throttle.pwm().duty[2] != LB_POWER_C(12),
+          "Failed write wasn't retried.");
+
+  /* A longer outage picks the ramp up from the last write, not past it. */
+  throttle.request_set(2, LB_POWER_C(100));
+  throttle.pwm().fail_channel = 2;
+  for (i = 0; i < 10; i++) {
+    rc = throttle.tick();
+    fail_if(rc != LB_PWM_ERROR, "Failed write wasn't reported.");
+  }
+  throttle.pwm().fail_channel = -1;
+  rc = throttle.tick();
+  fail_if(rc != LB_OK, "Tick failed after the outage.");
+  fail_if(throttle.pwm().duty[2] != LB_POWER_C(12) + test_ramp::limit,
+          "Recovered write jumped past the ramp limit.");
+}
+END_TEST
+
+Suite *
+suite_cxx_new()
+{
+  Suite *suite = suite_create("suite_cxx");
+
+  TCase *case_st = tcase_create("test_cxx_static_throttle");
+  tcase_add_test(case_st, test_cxx_static_throttle);
+
+  suite_add_tcase(suite, case_st);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_cxx_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
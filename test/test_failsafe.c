@@ -0,0 +1,267 @@
+/*
+ * @file test_failsafe.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "comm.h"
+#include "failsafe.h"
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+#define MS 1000000ULL
+#define T0 (10000ULL * MS)
+
+START_TEST(test_failsafe_deadline)
+{
+  int rc, source;
+  struct lb_failsafe_t *failsafe = lb_failsafe_new(NULL);
+
+  rc = lb_failsafe_source_add(failsafe, 50, &source);
+  fail_if(rc != 0, "Failed to add a source.");
+
+  /* Not watched until it is fed. */
+  lb_failsafe_advance(failsafe, T0);
+  fail_if(lb_failsafe_is_tripped(failsafe), "Tripped on an unfed source.");
+
+  lb_failsafe_feed_at(failsafe, source, T0);
+  lb_failsafe_advance(failsafe, T0 + 49 * MS);
+  fail_if(lb_failsafe_is_tripped(failsafe), "Tripped before the deadline.");
+
+  /* Keep feeding it well past a full turn of the wheel. */
+  for (uint64_t t = T0 + 40 * MS; t < T0 + 2000 * MS; t += 40 * MS) {
+    lb_failsafe_feed_at(failsafe, source, t);
+    lb_failsafe_advance(failsafe, t + 39 * MS);
+    fail_if(lb_failsafe_is_tripped(failsafe), "Tripped on a fed source.");
+  }
+
+  lb_failsafe_source_remove(failsafe, source);
+  lb_failsafe_delete(failsafe);
+}
+END_TEST
+
+START_TEST(test_failsafe_rounds)
+{
+  int source;
+  struct lb_failsafe_t *failsafe = lb_failsafe_new(NULL);
+
+  /* Longer than the wheel, so it has to count down rounds. */
+  lb_failsafe_source_add(failsafe, 1000, &source);
+  lb_failsafe_feed_at(failsafe, source, T0);
+
+  lb_failsafe_advance(failsafe, T0 + 999 * MS);
+  fail_if(lb_failsafe_is_tripped(failsafe), "Tripped a round early.");
+  lb_failsafe_advance(failsafe, T0 + 1000 * MS);
+  fail_if(!lb_failsafe_is_tripped(failsafe), "Didn't trip at the deadline.");
+
+  lb_failsafe_delete(failsafe);
+}
+END_TEST
+
+START_TEST(test_failsafe_ramp_down)
+{
+  int rc, source, i;
+  uint64_t t;
+  lb_power_t power;
+  struct lb_failsafe_profile_t profile;
+  struct lb_failsafe_metrics_t metrics;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_failsafe_t *failsafe;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_start_pwms(throttle);
+
+  lb_throttle_request_set(throttle, LB_POWER_C(10));
+  for (i = 0; i < 5; i++)
+    lb_throttle_tick(throttle);
+
+  failsafe = lb_failsafe_new(throttle);
+  profile.lbfp_hold_ms = 0;
+  profile.lbfp_decel_per_sec = LB_POWER_C(20);
+  rc = lb_failsafe_profile_set(failsafe, &profile);
+  fail_if(rc != 0, "Failed to set the profile.");
+
+  lb_failsafe_source_add(failsafe, 50, &source);
+  lb_failsafe_feed_at(failsafe, source, T0);
+  lb_failsafe_advance(failsafe, T0 + 50 * MS);
+  fail_if(!lb_failsafe_is_tripped(failsafe), "Didn't trip.");
+
+  lb_failsafe_metrics_get(failsafe, &metrics);
+  fail_if(metrics.lbfm_trips != 1, "Trip wasn't counted.");
+  fail_if(metrics.lbfm_loss_to_trip_ns != 50 * MS,
+          "Loss to trip was %llu ns.",
+          (unsigned long long)metrics.lbfm_loss_to_trip_ns);
+
+  for (t = T0 + 150 * MS; t < T0 + 2000 * MS; t += 100 * MS) {
+    lb_failsafe_advance(failsafe, t);
+    lb_throttle_tick(throttle);
+  }
+
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0 || power != LB_POWER_C(0), "Throttle didn't stop.");
+
+  lb_failsafe_metrics_get(failsafe, &metrics);
+  fail_if(metrics.lbfm_loss_to_zero_ns < 500 * MS ||
+          metrics.lbfm_loss_to_zero_ns > 1000 * MS,
+          "Loss to zero was %llu ns.",
+          (unsigned long long)metrics.lbfm_loss_to_zero_ns);
+
+  /* A valid sample ends the trip. */
+  lb_failsafe_feed_at(failsafe, source, t);
+  fail_if(lb_failsafe_is_tripped(failsafe), "Still tripped after a sample.");
+
+  lb_failsafe_delete(failsafe);
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_failsafe_mid_ramp)
+{
+  int rc, source, i;
+  uint64_t t;
+  lb_power_t power, trip_power;
+  struct lb_failsafe_profile_t profile;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_failsafe_t *failsafe;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_start_pwms(throttle);
+
+  /* Part of the way up to full power when the link drops. */
+  lb_throttle_request_set(throttle, LB_POWER_C(100));
+  for (i = 0; i < 10; i++)
+    lb_throttle_tick(throttle);
+  lb_throttle_current_get(throttle, &trip_power);
+  fail_if(trip_power >= LB_POWER_C(100), "Ramp didn't limit the start.");
+
+  failsafe = lb_failsafe_new(throttle);
+  profile.lbfp_hold_ms = 300;
+  profile.lbfp_decel_per_sec = LB_POWER_C(20);
+  lb_failsafe_profile_set(failsafe, &profile);
+
+  lb_failsafe_source_add(failsafe, 50, &source);
+  lb_failsafe_feed_at(failsafe, source, T0);
+  lb_failsafe_advance(failsafe, T0 + 50 * MS);
+  fail_if(!lb_failsafe_is_tripped(failsafe), "Didn't trip.");
+
+  /* Held, then brought down, but never faster than where it was. */
+  for (t = T0 + 150 * MS; t < T0 + 3000 * MS; t += 100 * MS) {
+    lb_failsafe_advance(failsafe, t);
+    lb_throttle_tick(throttle);
+    rc = lb_throttle_current_get(throttle, &power);
+    fail_if(rc != 0, "Readback failed.");
+    fail_if(power > trip_power, "Board sped up after the trip.");
+  }
+  fail_if(power != LB_POWER_C(0), "Throttle didn't stop.");
+
+  lb_failsafe_delete(failsafe);
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_failsafe_loopback)
+{
+  int rc, source, i, writer;
+  lb_power_t power;
+  struct lb_failsafe_metrics_t metrics;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_failsafe_t *failsafe;
+  struct lb_comm_t *comm;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_tick_mode_set(throttle, LB_THROTTLE_TICK_ADAPTIVE);
+  rc = lb_throttle_start(throttle);
+  fail_if(rc != 0, "Failed to start throttle.");
+
+  failsafe = lb_failsafe_new(throttle);
+  lb_failsafe_source_add(failsafe, 30, &source);
+  rc = lb_failsafe_start(failsafe);
+  fail_if(rc != 0, "Failed to start the failsafe.");
+
+  comm = lb_comm_loopback_new();
+  fail_if(comm == NULL, "Failed to create a loopback comm.");
+  rc = lb_comm_open(comm);
+  fail_if(rc != 0, "Failed to open the loopback comm.");
+  lb_comm_failsafe_attach(comm, failsafe, source);
+
+  writer = lb_comm_loopback_writer(comm);
+  fail_if(write(writer, "10\n", 3) != 3, "Failed to write a sample.");
+  rc = lb_comm_get_power(comm, &power);
+  fail_if(rc != 0, "Failed to read a sample.");
+  fail_if(power != LB_POWER_C(10), "Read the wrong sample.");
+  lb_throttle_request_set(throttle, power);
+
+  /* The remote goes quiet, wait for the board to stop. */
+  for (i = 0; i < 300; i++) {
+    lb_failsafe_metrics_get(failsafe, &metrics);
+    if (metrics.lbfm_loss_to_zero_ns != 0)
+      break;
+    usleep(10000);
+  }
+
+  fail_if(metrics.lbfm_trips != 1, "Failsafe didn't trip.");
+  fail_if(metrics.lbfm_loss_to_trip_ns < 30 * MS ||
+          metrics.lbfm_loss_to_trip_ns > 250 * MS,
+          "Loss to trip was %llu ns.",
+          (unsigned long long)metrics.lbfm_loss_to_trip_ns);
+  fail_if(metrics.lbfm_loss_to_zero_ns == 0, "Board never stopped.");
+
+  lb_comm_delete(comm);
+  lb_failsafe_delete(failsafe);
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+Suite *
+suite_failsafe_new()
+{
+  Suite *suite = suite_create("suite_failsafe");
+
+  TCase *case_fw = tcase_create("test_failsafe_wheel");
+  tcase_add_test(case_fw, test_failsafe_deadline);
+  tcase_add_test(case_fw, test_failsafe_rounds);
+  tcase_add_test(case_fw, test_failsafe_ramp_down);
+  tcase_add_test(case_fw, test_failsafe_mid_ramp);
+
+  TCase *case_fl = tcase_create("test_failsafe_loopback");
+  tcase_set_timeout(case_fl, 10);
+  tcase_add_test(case_fl, test_failsafe_loopback);
+
+  suite_add_tcase(suite, case_fw);
+  suite_add_tcase(suite, case_fl);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_failsafe_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
@@ -0,0 +1,313 @@
+/*
+ * @file test_lbd.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <check.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "errors.h"
+#include "lbd_proto.h"
+
+/* Long enough for a loaded machine, short enough to fail a hung test. */
+#define TEST_LBD_TIMEOUT_SEC 5
+
+/* Full batches to send at once, answers to more than lbd buffers. */
+#define TEST_LBD_BATCHES 48
+
+/* What lbd's end of the pair holds, so its answers back up quickly. */
+#define TEST_LBD_SNDBUF 4096
+
+/* Frames this test expects never hold more than a batch. */
+struct test_lbd_frame_t {
+  struct lbd_frame_header_t tlf_header;
+  struct lbd_response_t tlf_records[LBD_BATCH_MAX];
+};
+
+/**
+ * @brief Start lbd on a simulated board, serving one end of a socket
+ * pair.
+ *
+ * @return The other end of the pair.
+ */
+static int
+test_lbd_start(pid_t *out_pid)
+{
+  int fds[2], sndbuf = TEST_LBD_SNDBUF;
+  char fd_arg[16];
+  struct timeval timeout;
+
+  fail_if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0,
+          "Failed to create a socket pair.");
+  setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+  *out_pid = fork();
+  fail_if(*out_pid < 0, "Failed to fork.");
+  if (*out_pid == 0) {
+    /* A failed test mustn't leave lbd holding the test runner's output. */
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    close(fds[0]);
+    snprintf(fd_arg, sizeof(fd_arg), "%d", fds[1]);
+    execl(LBD_PATH, "lbd", "-S", "-c", fd_arg, (char *)NULL);
+    _exit(127);
+  }
+  close(fds[1]);
+
+  timeout.tv_sec = TEST_LBD_TIMEOUT_SEC;
+  timeout.tv_usec = 0;
+  setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  return fds[0];
+}
+
+/**
+ * @brief Stop lbd, and check it shut down cleanly.
+ */
+static void
+test_lbd_stop(pid_t pid, int fd)
+{
+  int status;
+
+  close(fd);
+  kill(pid, SIGTERM);
+  fail_if(waitpid(pid, &status, 0) != pid, "Failed to wait for lbd.");
+  fail_if(!WIFEXITED(status) || WEXITSTATUS(status) != 0,
+          "lbd didn't exit cleanly.");
+}
+
+static void
+test_lbd_send(int fd, const struct lbd_command_t *commands, uint16_t count)
+{
+  struct lbd_frame_header_t header = {
+    .lbfh_version = LBD_PROTO_VERSION,
+    .lbfh_flags = 0,
+    .lbfh_count = count,
+  };
+  size_t size = count * sizeof(*commands);
+
+  fail_if(send(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header),
+          "Failed to send a header.");
+  fail_if(send(fd, commands, size, 0) != (ssize_t)size,
+          "Failed to send a batch.");
+}
+
+/**
+ * @brief Read one whole frame.
+ *
+ * @return The number of bytes read, 0 if lbd hung up.
+ */
+static ssize_t
+test_lbd_recv(int fd, struct test_lbd_frame_t *frame)
+{
+  ssize_t size;
+  size_t records;
+
+  size = recv(fd, &(frame->tlf_header), sizeof(frame->tlf_header),
+              MSG_WAITALL);
+  if (size <= 0)
+    return size;
+  fail_if(size != (ssize_t)sizeof(frame->tlf_header), "Short header.");
+  fail_if(frame->tlf_header.lbfh_version != LBD_PROTO_VERSION,
+          "Wrong protocol version.");
+  fail_if(frame->tlf_header.lbfh_count > LBD_BATCH_MAX, "Frame too big.");
+
+  records = frame->tlf_header.lbfh_count * sizeof(struct lbd_response_t);
+  if (records == 0)
+    return size;
+  fail_if(recv(fd, frame->tlf_records, records, MSG_WAITALL) !=
+          (ssize_t)records, "Short frame.");
+  return size + (ssize_t)records;
+}
+
+/**
+ * @brief Read frames until one that isn't events, checking it answers
+ * the given number of commands.
+ */
+static void
+test_lbd_recv_responses(int fd, struct test_lbd_frame_t *frame,
+                        uint16_t count)
+{
+  do {
+    fail_if(test_lbd_recv(fd, frame) <= 0, "No response from lbd.");
+  } while (frame->tlf_header.lbfh_flags & LBD_FRAME_EVENTS);
+
+  fail_if(frame->tlf_header.lbfh_count != count,
+          "Wrong number of responses.");
+}
+
+START_TEST(test_lbd_batch)
+{
+  int fd;
+  pid_t pid;
+  struct test_lbd_frame_t frame;
+  struct lbd_command_t commands[] = {
+    { .lbdc_seq = 1, .lbdc_op = LBD_OP_PING },
+    { .lbdc_seq = 2, .lbdc_op = LBD_OP_REQUEST_SET, .lbdc_value = 2500 },
+    { .lbdc_seq = 3, .lbdc_op = LBD_OP_REQUEST_GET },
+    { .lbdc_seq = 4, .lbdc_op = LBD_OP_REQUEST_SET, .lbdc_value = 10001 },
+    { .lbdc_seq = 5, .lbdc_op = 99 },
+  };
+
+  fd = test_lbd_start(&pid);
+
+  test_lbd_send(fd, commands, 5);
+  test_lbd_recv_responses(fd, &frame, 5);
+  fail_if(frame.tlf_records[0].lbdr_seq != 1 ||
+          frame.tlf_records[0].lbdr_op != LBD_OP_PING ||
+          frame.tlf_records[0].lbdr_status != LB_OK, "Ping failed.");
+  fail_if(frame.tlf_records[1].lbdr_seq != 2 ||
+          frame.tlf_records[1].lbdr_status != LB_OK,
+          "Failed to set the request.");
+  fail_if(frame.tlf_records[2].lbdr_seq != 3 ||
+          frame.tlf_records[2].lbdr_value != 2500,
+          "Request wasn't read back in order.");
+  fail_if(frame.tlf_records[3].lbdr_status != LB_PARSE_ERROR,
+          "Accepted a request over full power.");
+  fail_if(frame.tlf_records[4].lbdr_seq != 5 ||
+          frame.tlf_records[4].lbdr_status != LB_NOT_SUPPORTED,
+          "Accepted an unknown op.");
+
+  test_lbd_stop(pid, fd);
+}
+END_TEST
+
+START_TEST(test_lbd_subscribe)
+{
+  int fd;
+  bool seen = false;
+  pid_t pid;
+  struct test_lbd_frame_t frame;
+  struct lbd_command_t set = {
+    .lbdc_seq = 1, .lbdc_op = LBD_OP_REQUEST_SET, .lbdc_value = 1000,
+  };
+  struct lbd_command_t subscribe = {
+    .lbdc_seq = 2, .lbdc_op = LBD_OP_SUBSCRIBE,
+    .lbdc_value = LBD_EVENT_REQUEST,
+  };
+
+  fd = test_lbd_start(&pid);
+
+  test_lbd_send(fd, &set, 1);
+  test_lbd_recv_responses(fd, &frame, 1);
+
+  /* The current state comes ahead of the answer to the subscribe. */
+  test_lbd_send(fd, &subscribe, 1);
+  fail_if(test_lbd_recv(fd, &frame) <= 0, "No events from lbd.");
+  fail_if(!(frame.tlf_header.lbfh_flags & LBD_FRAME_EVENTS) ||
+          frame.tlf_header.lbfh_count != 1 ||
+          frame.tlf_records[0].lbdr_op != LBD_EVENT_REQUEST ||
+          frame.tlf_records[0].lbdr_value != 1000,
+          "Subscriber didn't start with the current state.");
+  test_lbd_recv_responses(fd, &frame, 1);
+  fail_if(frame.tlf_records[0].lbdr_seq != 2 ||
+          frame.tlf_records[0].lbdr_status != LB_OK,
+          "Failed to subscribe.");
+
+  /* Changes are pushed, whoever made them. */
+  set.lbdc_seq = 3;
+  set.lbdc_value = 4000;
+  test_lbd_send(fd, &set, 1);
+  while (!seen) {
+    fail_if(test_lbd_recv(fd, &frame) <= 0, "Change wasn't pushed.");
+    seen = (frame.tlf_header.lbfh_flags & LBD_FRAME_EVENTS) &&
+           frame.tlf_records[0].lbdr_value == 4000;
+  }
+
+  test_lbd_stop(pid, fd);
+}
+END_TEST
+
+START_TEST(test_lbd_half_close)
+{
+  int fd, i, j;
+  pid_t pid;
+  struct test_lbd_frame_t frame;
+  struct lbd_command_t commands[LBD_BATCH_MAX];
+
+  fd = test_lbd_start(&pid);
+
+  /*
+   * Send more than lbd can answer without blocking, then shut the
+   * sending side. Every batch still gets its answer before lbd hangs up.
+   */
+  for (i = 0; i < TEST_LBD_BATCHES; i++) {
+    for (j = 0; j < LBD_BATCH_MAX; j++) {
+      memset(&commands[j], 0, sizeof(commands[j]));
+      commands[j].lbdc_seq = (uint32_t)(i * LBD_BATCH_MAX + j);
+      commands[j].lbdc_op = LBD_OP_PING;
+    }
+    test_lbd_send(fd, commands, LBD_BATCH_MAX);
+  }
+  shutdown(fd, SHUT_WR);
+
+  for (i = 0; i < TEST_LBD_BATCHES; i++) {
+    test_lbd_recv_responses(fd, &frame, LBD_BATCH_MAX);
+    fail_if(frame.tlf_records[LBD_BATCH_MAX - 1].lbdr_seq !=
+            (uint32_t)((i + 1) * LBD_BATCH_MAX - 1),
+            "Batches were answered out of order.");
+  }
+  fail_if(test_lbd_recv(fd, &frame) != 0,
+          "Half closed client wasn't hung up on.");
+
+  test_lbd_stop(pid, fd);
+}
+END_TEST
+
+START_TEST(test_lbd_protocol_error)
+{
+  int fd;
+  pid_t pid;
+  struct test_lbd_frame_t frame;
+  struct lbd_frame_header_t header = {
+    .lbfh_version = LBD_PROTO_VERSION + 1,
+  };
+
+  fd = test_lbd_start(&pid);
+
+  /* A client that breaks protocol is hung up on. */
+  fail_if(send(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header),
+          "Failed to send a header.");
+  fail_if(test_lbd_recv(fd, &frame) != 0,
+          "Client wasn't dropped for a bad version.");
+
+  test_lbd_stop(pid, fd);
+}
+END_TEST
+
+Suite *
+suite_lbd_new()
+{
+  Suite *suite = suite_create("suite_lbd");
+
+  TCase *case_lp = tcase_create("test_lbd_protocol");
+  tcase_add_test(case_lp, test_lbd_batch);
+  tcase_add_test(case_lp, test_lbd_subscribe);
+  tcase_add_test(case_lp, test_lbd_half_close);
+  tcase_add_test(case_lp, test_lbd_protocol_error);
+
+  suite_add_tcase(suite, case_lp);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_lbd_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
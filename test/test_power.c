@@ -0,0 +1,78 @@
+/*
+ * @file test_power.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <check.h>
+
+#include "errors.h"
+#include "power.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+START_TEST(test_power_parse)
+{
+  int rc;
+  lb_power_t power;
+
+  rc = lb_power_parse("50\n", &power);
+  fail_if(rc != LB_OK, "Failed to parse a whole number.");
+  fail_if(power != LB_POWER_C(50), "Parsed power was not the expected value.");
+
+  rc = lb_power_parse("33.3\n", &power);
+  fail_if(rc != LB_OK, "Failed to parse a decimal.");
+  fail_if(power != LB_POWER_C(33.3),
+          "Parsed power was not the expected value.");
+
+  rc = lb_power_parse("-2.5", &power);
+  fail_if(rc != LB_OK, "Failed to parse a negative number.");
+  fail_if(power != LB_POWER_C(-2.5),
+          "Parsed power was not the expected value.");
+
+  rc = lb_power_parse("full\n", &power);
+  fail_if(rc == LB_OK, "Parsed a power level out of garbage.");
+}
+END_TEST
+
+START_TEST(test_power_ramp)
+{
+  lb_power_t power;
+
+  power = lb_throttle_ramp(LB_POWER_C(0), LB_POWER_C(100), LB_POWER_C(2));
+  fail_if(power != LB_POWER_C(2), "Ramped up by more than the limit.");
+
+  power = lb_throttle_ramp(LB_POWER_C(50), LB_POWER_C(0), LB_POWER_C(2));
+  fail_if(power != LB_POWER_C(48), "Ramped down by more than the limit.");
+
+  power = lb_throttle_ramp(LB_POWER_C(99), LB_POWER_C(100), LB_POWER_C(2));
+  fail_if(power != LB_POWER_C(100), "Didn't settle on the target.");
+}
+END_TEST
+
+Suite *
+suite_power_new()
+{
+  Suite *suite = suite_create("suite_power");
+
+  TCase *case_pp = tcase_create("test_power_parse");
+  tcase_add_test(case_pp, test_power_parse);
+  tcase_add_test(case_pp, test_power_ramp);
+
+  suite_add_tcase(suite, case_pp);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_power_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
@@ -0,0 +1,391 @@
+/*
+ * @file test_sim.c
+ * @brief
+ * @author Travis Lane
+ * @version 0.0.1
+ * @date 2026-10-19
+ */
+
+#include <check.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "errors.h"
+#include "sim.h"
+#include "throttle.h"
+#include "throttle_internal.h"
+
+/* Sets fail with test_fail_rc while test_fail_sets is above 0. */
+static const struct lb_pwm_ops_t *test_sim_ops;
+static int test_fail_sets;
+static int test_fail_rc;
+
+static int
+test_faulty_set(struct lb_throttle_t *throttle, int channel, lb_power_t duty)
+{
+  if (test_fail_sets > 0) {
+    test_fail_sets--;
+    return test_fail_rc;
+  }
+  return test_sim_ops->lbp_set_func(throttle, channel, duty);
+}
+
+static struct lb_pwm_ops_t test_faulty_ops;
+
+START_TEST(test_sim_ride)
+{
+  int rc, i;
+  lb_power_t power;
+  struct lb_sim_params_t params;
+  struct lb_sim_state_t state;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  fail_if(sim == NULL, "Failed to create sim.");
+  throttle = lb_throttle_sim_new(sim);
+  fail_if(throttle == NULL, "Failed to create sim throttle.");
+
+  rc = lb_throttle_start_pwms(throttle);
+  fail_if(rc != 0, "Failed to start sim pwms.");
+
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(50));
+  fail_if(rc != 0, "Failed to set requested power.");
+
+  /* Ten simulated seconds. */
+  for (i = 0; i < 100; i++) {
+    rc = lb_throttle_tick(throttle);
+    fail_if(rc != 0, "Failed to tick the throttle.");
+    lb_sim_step(sim, LB_THROTTLE_NSEC_SLEEP);
+  }
+
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0, "Failed to get current power.");
+  fail_if(power != LB_POWER_C(50), "Throttle didn't reach the target.");
+
+  lb_sim_state_get(sim, &state);
+  fail_if(state.lbss_time_ns != 10000000000ULL, "Simulated time is off.");
+  fail_if(state.lbss_speed <= 1.0, "Board didn't get moving.");
+  fail_if(state.lbss_peak_current <= 0.0, "Board didn't draw any current.");
+  fail_if(state.lbss_voltage >= params.lbsp_battery_voltage,
+          "Battery didn't sag under load.");
+
+  lb_throttle_stop_pwms(throttle);
+  lb_sim_step(sim, 1000000000ULL);
+  lb_sim_state_get(sim, &state);
+  fail_if(state.lbss_current != 0.0, "Stopped board still draws current.");
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_sim_disabled)
+{
+  int rc;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+
+  rc = lb_throttle_current_set(throttle, LB_POWER_C(10));
+  fail_if(rc == 0, "Set power on disabled pwms.");
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_sim_params)
+{
+  struct lb_sim_params_t params;
+
+  /* A step that isn't positive would never finish stepping. */
+  lb_sim_params_default(&params);
+  params.lbsp_step = 0.0;
+  fail_if(lb_sim_new(&params) != NULL, "Accepted a zero step.");
+  params.lbsp_step = -0.001;
+  fail_if(lb_sim_new(&params) != NULL, "Accepted a negative step.");
+  params.lbsp_step = NAN;
+  fail_if(lb_sim_new(&params) != NULL, "Accepted a NaN step.");
+
+  lb_sim_params_default(&params);
+  params.lbsp_mass = 0.0;
+  fail_if(lb_sim_new(&params) != NULL, "Accepted a massless board.");
+  lb_sim_params_default(&params);
+  params.lbsp_grade = INFINITY;
+  fail_if(lb_sim_new(&params) != NULL, "Accepted an infinite grade.");
+}
+END_TEST
+
+START_TEST(test_sim_config)
+{
+  int rc;
+  lb_power_t power;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_throttle_config_t config;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+  lb_throttle_start_pwms(throttle);
+
+  lb_throttle_request_set(throttle, LB_POWER_C(50));
+  lb_throttle_tick(throttle);
+  lb_throttle_current_get(throttle, &power);
+  fail_if(power != LB_POWER_C(2), "Default ramp is off.");
+
+  /* Retune mid ride, the next tick should use the new ramp. */
+  lb_throttle_config_get(throttle, &config);
+  config.lbtc_ramp_per_sec = LB_POWER_C(100);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc != 0, "Failed to set config.");
+  lb_throttle_tick(throttle);
+  lb_throttle_current_get(throttle, &power);
+  fail_if(power != LB_POWER_C(12), "New ramp wasn't picked up.");
+
+  config.lbtc_power_max = LB_POWER_C(20);
+  config.lbtc_trim[LB_THROTTLE_RIGHT] = LB_POWER_C(0.5);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc != 0, "Failed to set config.");
+  lb_throttle_tick(throttle);
+  lb_throttle_tick(throttle);
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0, "Trimmed channels failed readback.");
+  fail_if(power != LB_POWER_C(20), "Power max didn't clamp.");
+  fail_if(throttle->lbt_written[LB_THROTTLE_LEFT] != LB_POWER_C(20),
+          "Left channel is off.");
+  fail_if(throttle->lbt_written[LB_THROTTLE_RIGHT] != LB_POWER_C(10),
+          "Right channel trim wasn't applied.");
+
+  config.lbtc_power_max = LB_POWER_C(150);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc == 0, "Accepted an invalid config.");
+
+  /* A minimum lifts small requests, but 0 still turns the board off. */
+  config.lbtc_power_max = LB_POWER_C(100);
+  config.lbtc_power_min = LB_POWER_C(15);
+  config.lbtc_trim[LB_THROTTLE_RIGHT] = LB_POWER_C(1.0);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc != 0, "Failed to set a power min.");
+  lb_throttle_request_set(throttle, LB_POWER_C(5));
+  lb_throttle_tick(throttle);
+  lb_throttle_current_get(throttle, &power);
+  fail_if(power != LB_POWER_C(15), "Power min didn't clamp.");
+  lb_throttle_request_set(throttle, LB_POWER_C(0));
+  lb_throttle_tick(throttle);
+  lb_throttle_tick(throttle);
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0 || power != LB_POWER_C(0), "Power min kept the board on.");
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_sim_fault)
+{
+  int i;
+  lb_power_t power;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_throttle_fault_t fault;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+
+  test_sim_ops = throttle->lbt_pwm_ops;
+  test_faulty_ops = *test_sim_ops;
+  test_faulty_ops.lbp_set_func = test_faulty_set;
+  throttle->lbt_pwm_ops = &test_faulty_ops;
+
+  lb_throttle_start_pwms(throttle);
+  lb_throttle_request_set(throttle, LB_POWER_C(50));
+  for (i = 0; i < 5; i++)
+    lb_throttle_tick(throttle);
+
+  /* A transient fault keeps the power where it was. */
+  test_fail_rc = LB_RETRY;
+  test_fail_sets = 1;
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_RECOVERING,
+          "Transient fault wasn't noticed.");
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_OK ||
+          fault.lbtf_transient != 1 || fault.lbtf_recover_ticks != 1,
+          "Didn't recover from a transient fault.");
+  lb_throttle_current_get(throttle, &power);
+  fail_if(power != LB_POWER_C(10), "Transient fault lost power.");
+
+  /* A persistent fault turns the pwms off, then ramps up from 0. */
+  test_fail_rc = LB_PWM_ERROR;
+  test_fail_sets = 1;
+  lb_throttle_tick(throttle);
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_OK ||
+          fault.lbtf_persistent != 1, "Didn't re-enable the pwms.");
+  lb_throttle_tick(throttle);
+  lb_throttle_current_get(throttle, &power);
+  fail_if(power != LB_POWER_C(2), "Didn't ramp up after recovering.");
+
+  /* A dead pwm gives up after a bounded number of ticks. */
+  test_fail_sets = 1000;
+  for (i = 0; i <= LB_THROTTLE_RECOVER_TICKS; i++)
+    lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_FAILED,
+          "Recovery wasn't bounded.");
+
+  test_fail_sets = 0;
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_FAILED,
+          "Failed throttle recovered on its own.");
+  lb_throttle_fault_clear(throttle);
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_OK,
+          "Cleared throttle didn't recover.");
+
+  /* A runner whose pwms are off for a fault isn't live. */
+  fail_if(lb_throttle_start(throttle) != 0, "Failed to start throttle.");
+  fail_if(lb_throttle_wait_live(throttle, 2000) != LB_OK,
+          "Throttle never went live.");
+  test_fail_sets = 1000;
+  lb_throttle_request_set(throttle, LB_POWER_C(50));
+  for (i = 0; i < 300; i++) {
+    lb_throttle_fault_get(throttle, &fault);
+    if (fault.lbtf_state == LB_THROTTLE_FAULT_FAILED)
+      break;
+    usleep(10000);
+  }
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_FAILED,
+          "Runner didn't give up on a dead pwm.");
+  fail_if(lb_throttle_is_live(throttle), "Failed throttle is still live.");
+
+  test_fail_sets = 0;
+  lb_throttle_fault_clear(throttle);
+  fail_if(lb_throttle_wait_live(throttle, 2000) != LB_OK,
+          "Recovered throttle didn't go live again.");
+  lb_throttle_stop(throttle);
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+START_TEST(test_sim_fault_trim)
+{
+  int rc, i;
+  lb_power_t power;
+  struct lb_sim_params_t params;
+  struct lb_sim_t *sim;
+  struct lb_throttle_t *throttle;
+  struct lb_throttle_config_t config;
+  struct lb_throttle_fault_t fault;
+
+  lb_sim_params_default(&params);
+  sim = lb_sim_new(&params);
+  throttle = lb_throttle_sim_new(sim);
+
+  test_sim_ops = throttle->lbt_pwm_ops;
+  test_faulty_ops = *test_sim_ops;
+  test_faulty_ops.lbp_set_func = test_faulty_set;
+  throttle->lbt_pwm_ops = &test_faulty_ops;
+
+  lb_throttle_config_get(throttle, &config);
+  config.lbtc_ramp_per_sec = LB_POWER_C(100);
+  config.lbtc_trim[LB_THROTTLE_RIGHT] = LB_POWER_C(0.5);
+  rc = lb_throttle_config_set(throttle, &config);
+  fail_if(rc != 0, "Failed to set a trimmed config.");
+
+  lb_throttle_start_pwms(throttle);
+  lb_throttle_request_set(throttle, LB_POWER_C(40));
+  for (i = 0; i < 5; i++)
+    lb_throttle_tick(throttle);
+
+  /*
+   * The right pwm slips to 15, which is 30 once its trim is undone.
+   * Recovery should resume from there, not from the raw duty cycle.
+   */
+  test_sim_ops->lbp_set_func(throttle, LB_THROTTLE_RIGHT, LB_POWER_C(15));
+  lb_throttle_request_set(throttle, LB_POWER_C(50));
+  test_fail_rc = LB_RETRY;
+  test_fail_sets = 1;
+  lb_throttle_tick(throttle);
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_OK, "Didn't recover.");
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0 || power != LB_POWER_C(30),
+          "Recovery didn't undo the trim.");
+
+  /* Failures outside a tick are faults the runner recovers from too. */
+  test_sim_ops->lbp_set_func(throttle, LB_THROTTLE_LEFT, LB_POWER_C(5));
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc == 0, "Mismatched readback wasn't an error.");
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_RECOVERING,
+          "Mismatched readback wasn't raised as a fault.");
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_OK,
+          "Didn't recover from a mismatched readback.");
+
+  test_fail_rc = LB_PWM_ERROR;
+  test_fail_sets = 1;
+  rc = lb_throttle_current_set(throttle, LB_POWER_C(20));
+  fail_if(rc == 0, "Failed set wasn't an error.");
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_RECOVERING ||
+          !throttle->lbt_pwms_stopped,
+          "Failed set wasn't raised as a fault.");
+  lb_throttle_tick(throttle);
+  lb_throttle_fault_get(throttle, &fault);
+  fail_if(fault.lbtf_state != LB_THROTTLE_FAULT_OK,
+          "Didn't recover from a failed set.");
+
+  lb_throttle_delete(throttle);
+  lb_sim_delete(sim);
+}
+END_TEST
+
+Suite *
+suite_sim_new()
+{
+  Suite *suite = suite_create("suite_sim");
+
+  TCase *case_sr = tcase_create("test_sim_ride");
+  tcase_add_test(case_sr, test_sim_ride);
+  tcase_add_test(case_sr, test_sim_disabled);
+  tcase_add_test(case_sr, test_sim_params);
+  tcase_add_test(case_sr, test_sim_config);
+  tcase_add_test(case_sr, test_sim_fault);
+  tcase_add_test(case_sr, test_sim_fault_trim);
+
+  suite_add_tcase(suite, case_sr);
+  return suite;
+}
+
+int
+main()
+{
+  int failed;
+  Suite *suite = suite_sim_new();
+  SRunner *runner = srunner_create(suite);
+  srunner_run_all(runner, CK_NORMAL);
+  failed = srunner_ntests_failed(runner);
+  srunner_free(runner);
+  return failed;
+}
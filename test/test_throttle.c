@@ -7,10 +7,14 @@
  */
 
 #include <check.h>
+#include <stddef.h>
 #include <unistd.h>
 
+#include "errors.h"
+#include "profile.h"
 #include "throttle.h"
 #include "throttle_internal.h"
+#include "trace.h"
 
 START_TEST(test_throttle_std_start_stop)
 {
@@ -56,31 +60,78 @@ START_TEST(test_throttle_early_stop)
 }
 END_TEST
 
+START_TEST(test_throttle_init_storage)
+{
+  int rc;
+  static _Alignas(max_align_t) unsigned char arena[4096];
+  struct lb_throttle_t *throttle = (struct lb_throttle_t *)arena;
+
+  fail_if(lb_throttle_sizeof() > sizeof(arena),
+          "Throttle doesn't fit in the arena.");
+  fail_if(lb_throttle_alignof() > _Alignof(max_align_t),
+          "Throttle needs more than the arena's alignment.");
+
+  rc = lb_throttle_test_init(throttle);
+  fail_if(rc != 0, "Failed to init throttle.");
+
+  rc = lb_throttle_start(throttle);
+  fail_if(rc != 0, "Failed to start throttle.");
+
+  lb_throttle_deinit(throttle);
+}
+END_TEST
+
+START_TEST(test_throttle_wait_live)
+{
+  int rc;
+  struct lb_throttle_t *throttle = lb_throttle_test_new();
+
+  rc = lb_throttle_wait_live(throttle, 10);
+  fail_if(rc == 0, "Stopped throttle went live.");
+
+  rc = lb_throttle_start(throttle);
+  fail_if(rc != 0, "Failed to start throttle.");
+
+  rc = lb_throttle_wait_live(throttle, 1000);
+  fail_if(rc != 0, "Throttle didn't go live. %d", rc);
+  fail_if(!lb_throttle_is_live(throttle), "Throttle isn't live.");
+
+  rc = lb_throttle_stop(throttle);
+  fail_if(rc != 0, "Failed to stop throttle.");
+  fail_if(lb_throttle_is_live(throttle), "Stopped throttle is still live.");
+
+  lb_throttle_delete(throttle);
+}
+END_TEST
+
 START_TEST(test_throttle_set_get_request)
 {
   int rc;
-  float power;
+  lb_power_t power;
   struct lb_throttle_t *throttle = lb_throttle_test_new();
   rc = lb_throttle_start(throttle);
   fail_if(rc != 0, "Failed to start throttle.");
 
-  rc = lb_throttle_request_set(throttle, 0.0f);
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(0.0));
   fail_if(rc != 0, "Failed to set requested power ");
   rc = lb_throttle_request_get(throttle, &power);
   fail_if(rc != 0, "Failed to get requested power.");
-  fail_if(power != 0.0f, "Power requested was not the expected value.");
+  fail_if(power != LB_POWER_C(0.0),
+          "Power requested was not the expected value.");
 
-  rc = lb_throttle_request_set(throttle, 33.3f);
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(33.3));
   fail_if(rc != 0, "Failed to set requested power ");
   rc = lb_throttle_request_get(throttle, &power);
   fail_if(rc != 0, "Failed to get requested power.");
-  fail_if(power != 33.3f, "Requested power was not the expected value.");
+  fail_if(power != LB_POWER_C(33.3),
+          "Requested power was not the expected value.");
 
-  rc = lb_throttle_request_set(throttle, 100.0f);
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(100.0));
   fail_if(rc != 0, "Failed to set requested power ");
   rc = lb_throttle_request_get(throttle, &power);
   fail_if(rc != 0, "Failed to get requested power.");
-  fail_if(power != 100.0f, "Requested power was not the expected value.");
+  fail_if(power != LB_POWER_C(100.0),
+          "Requested power was not the expected value.");
 
   lb_throttle_delete(throttle);
 }
@@ -89,39 +140,143 @@ END_TEST
 START_TEST(test_throttle_set_get_request_timed)
 {
   int rc;
-  float power;
+  lb_power_t power;
   struct lb_throttle_t *throttle = lb_throttle_test_new();
   rc = lb_throttle_start(throttle);
   fail_if(rc != 0, "Failed to start throttle.");
 
-  rc = lb_throttle_request_set(throttle, 0.0f);
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(0.0));
   fail_if(rc != 0, "Failed to set requested power ");
   rc = lb_throttle_request_get(throttle, &power);
   fail_if(rc != 0, "Failed to get requested power.");
-  fail_if(power != 0.0f, "Requested power was not the expected value.");
+  fail_if(power != LB_POWER_C(0.0),
+          "Requested power was not the expected value.");
 
   rc = lb_throttle_current_get(throttle, &power);
   fail_if(rc != 0, "Failed to get current throttle power. %d", rc);
-  fail_if(power != 00.0f, "Power was not expected value. "
-                          "Power: %f Expected: %f\n", power, 00.0f);
+  fail_if(power != LB_POWER_C(00.0), "Power was not expected value. "
+          "Power: %f Expected: %f\n", LB_POWER_TO_FLOAT(power), 00.0f);
 
-  rc = lb_throttle_request_set(throttle, 100.0f);
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(100.0));
   fail_if(rc != 0, "Failed to set requested power ");
   rc = lb_throttle_request_get(throttle, &power);
   fail_if(rc != 0, "Failed to get requested power.");
-  fail_if(power != 100.0f, "Power was not the expected value.");
+  fail_if(power != LB_POWER_C(100.0),
+          "Power was not the expected value.");
 
   sleep(1);
 
   rc = lb_throttle_current_get(throttle, &power);
   fail_if(rc != 0, "Failed to get current power.");
-  fail_if(power != 20.0f, "Power was not expected value. "
-                          "Power: %f Expected: %f\n", power, 20.0f);
+  fail_if(power != LB_POWER_C(20.0), "Power was not expected value. "
+          "Power: %f Expected: %f\n", LB_POWER_TO_FLOAT(power), 20.0f);
 
   lb_throttle_delete(throttle);
 }
 END_TEST
 
+START_TEST(test_throttle_adaptive_tick)
+{
+  int rc;
+  lb_power_t power;
+  struct lb_throttle_tick_stats_t stats;
+  struct lb_throttle_t *throttle = lb_throttle_test_new();
+
+  rc = lb_throttle_tick_mode_set(throttle, LB_THROTTLE_TICK_ADAPTIVE);
+  fail_if(rc != 0, "Failed to set the tick mode.");
+
+  rc = lb_throttle_start(throttle);
+  fail_if(rc != 0, "Failed to start throttle.");
+  rc = lb_throttle_wait_live(throttle, 1000);
+  fail_if(rc != 0, "Throttle didn't go live.");
+
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(10.0));
+  fail_if(rc != 0, "Failed to set requested power ");
+
+  usleep(250000);
+
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0, "Failed to get current power.");
+  fail_if(power <= LB_POWER_C(0.0) || power >= LB_POWER_C(10.0),
+          "Power wasn't ramping. Power: %f", LB_POWER_TO_FLOAT(power));
+
+  rc = lb_throttle_tick_stats_get(throttle, &stats);
+  fail_if(rc != 0, "Failed to get tick stats.");
+  fail_if(stats.lbts_period_ns >= LB_THROTTLE_PERIOD_NSEC,
+          "Ramp ticked slowly. Period: %llu",
+          (unsigned long long)stats.lbts_period_ns);
+
+  usleep(750000);
+
+  rc = lb_throttle_current_get(throttle, &power);
+  fail_if(rc != 0, "Failed to get current power.");
+  fail_if(power != LB_POWER_C(10.0), "Power was not expected value. "
+          "Power: %f Expected: %f\n", LB_POWER_TO_FLOAT(power), 10.0f);
+
+  rc = lb_throttle_tick_stats_get(throttle, &stats);
+  fail_if(rc != 0, "Failed to get tick stats.");
+  fail_if(stats.lbts_period_ns <= LB_THROTTLE_ADAPTIVE_MIN_NSEC,
+          "Steady throttle didn't back off.");
+
+  lb_throttle_delete(throttle);
+}
+END_TEST
+
+START_TEST(test_throttle_profile)
+{
+  int rc;
+  FILE *file;
+  struct lb_profile_report_t report;
+  struct lb_throttle_t *throttle = lb_throttle_test_new();
+
+  rc = lb_throttle_profile_get(throttle, 0, &report);
+  fail_if(rc != LB_NOT_FOUND, "Got a profile before profiling.");
+
+  rc = lb_throttle_profile_enable(throttle, true);
+  fail_if(rc != 0, "Failed to enable the profiler.");
+  rc = lb_throttle_start(throttle);
+  fail_if(rc != 0, "Failed to start throttle.");
+  rc = lb_throttle_request_set(throttle, LB_POWER_C(100.0));
+  fail_if(rc != 0, "Failed to set requested power ");
+
+  usleep(1300000);
+
+  rc = lb_throttle_profile_get(throttle, 0, &report);
+  fail_if(rc != 0, "Failed to get the profile.");
+  fail_if(report.lbpr_ticks == 0, "Profile didn't count ticks.");
+  fail_if(report.lbpr_wall_ns < LB_PROFILE_WINDOW_NSEC,
+          "Profile window was too short.");
+  fail_if(report.lbpr_phases[LB_PROFILE_LOCK_WAIT].lbps_count == 0,
+          "Profile didn't time the lock.");
+  fail_if(report.lbpr_phases[LB_PROFILE_WRITE_RIGHT].lbps_count == 0,
+          "Profile didn't time the writes.");
+
+  rc = lb_throttle_profile_get(throttle, LB_PROFILE_WINDOWS, &report);
+  fail_if(rc != LB_NOT_FOUND, "Got a profile window that is too old.");
+
+  file = tmpfile();
+  fail_if(file == NULL, "Failed to open a temporary file.");
+  rc = lb_throttle_profile_dump(throttle, file);
+  fail_if(rc != 0, "Failed to dump the profile.");
+  fail_if(ftell(file) == 0, "Dumped an empty profile.");
+  fclose(file);
+
+  lb_throttle_delete(throttle);
+}
+END_TEST
+
+START_TEST(test_throttle_trace)
+{
+  int evaluated = 0;
+
+  /* Nothing is attached, so probe arguments must not be worked out. */
+  fail_if(LB_TRACE_ENABLED(tick__start), "A probe is attached.");
+  LB_TRACE1(tick__start, evaluated++);
+  LB_TRACE3(bt__connect, evaluated++, evaluated++, evaluated++);
+  fail_if(evaluated != 0, "Probe arguments were evaluated.");
+}
+END_TEST
+
 Suite *
 suite_throttle_new()
 {
@@ -131,11 +286,16 @@ suite_throttle_new()
   tcase_add_test(case_tss, test_throttle_std_start_stop);
   tcase_add_test(case_tss, test_throttle_double_start);
   tcase_add_test(case_tss, test_throttle_early_stop);
+  tcase_add_test(case_tss, test_throttle_init_storage);
+  tcase_add_test(case_tss, test_throttle_wait_live);
 
   TCase *case_ts = tcase_create("test_throttle_set");
   tcase_set_timeout(case_ts, 10);
   tcase_add_test(case_ts, test_throttle_set_get_request);
   tcase_add_test(case_ts, test_throttle_set_get_request_timed);
+  tcase_add_test(case_ts, test_throttle_adaptive_tick);
+  tcase_add_test(case_ts, test_throttle_profile);
+  tcase_add_test(case_ts, test_throttle_trace);
 
   suite_add_tcase(suite, case_tss);
   suite_add_tcase(suite, case_ts);